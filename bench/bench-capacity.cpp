@@ -0,0 +1,116 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * bench/bench-capacity.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/bench is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Micro-benchmark of record slot management: appends and index lookups on
+ * memory tables managed by the state machine, versus power of two capacity.
+ *
+ * Usage: bench-capacity [capacity [rounds]]
+ * Capacity shall be a power of two, tables are filled rounds times over.
+ */
+
+#include "libstore.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+namespace
+{
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+ * Print the time per operation of a run.
+ * @param name Name of the run.
+ * @param start Time of the beginning of the run.
+ * @param count Number of operations of the run.
+ */
+void report(const char* name, bench_clock::time_point start, uint64_t count)
+{
+    double ns = std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10)
+            << std::fixed << std::setprecision(2) << ns / (double) count << " ns/op" << std::endl;
+}
+
+/**
+ * Run appends then lookups on a table.
+ * @param label Label of the table.
+ * @param table Table to run.
+ * @param rounds Number of times the table is filled.
+ */
+void run(const std::string& label, cyclic::table& table, uint64_t rounds)
+{
+    uint64_t appends = rounds * table.record_capacity();
+    bench_clock::time_point start = bench_clock::now();
+    for(uint64_t n = 0; n < appends; ++n)
+    {
+        table.append_record();
+    }
+    report((label + " append").c_str(), start, appends);
+
+    // Lookups walk the whole split range, so both sides of the wrap are hit.
+    uint64_t sum = 0;
+    start = bench_clock::now();
+    for(uint64_t round = 0; round < rounds; ++round)
+    {
+        for(cyclic::record_index_t idx = table.min_index(); idx <= table.max_index(); ++idx)
+        {
+            sum += table.get_record_view(idx).has(0);
+        }
+    }
+    report((label + " lookup").c_str(), start, rounds * table.record_count());
+    if(sum != 0)
+    {
+        // Appended records are empty, keep the lookups from being optimized out.
+        std::cerr << "Unexpected stored value" << std::endl;
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    cyclic::record_index_t capacity = argc > 1 ? (cyclic::record_index_t) std::strtoul(argv[1], nullptr, 10) : 65536;
+    uint64_t rounds = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 16;
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+    try
+    {
+        // Start the tables at index 0 so appends follow the same path in both modes.
+        std::unique_ptr<cyclic::table> states = cyclic::store::memory::create(fields, capacity);
+        states->append_record((cyclic::record_index_t)0);
+        run("state machine", *states, rounds);
+
+        std::unique_ptr<cyclic::table> pow2 = cyclic::store::memory::create(fields, capacity, 0, 0,
+                cyclic::store::TABLE_POW2_CAPACITY);
+        pow2->append_record((cyclic::record_index_t)0);
+        run("power of two", *pow2, rounds);
+    }
+    catch(std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,481 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-aggregate.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-aggregate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CYCLIC_AGGREGATE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace cyclic
+{
+
+//
+// aggregate_result
+//
+
+std::string aggregate_op_name(aggregate_op op)
+{
+    switch(op)
+    {
+    case AGGREGATE_COUNT: return "count";
+    case AGGREGATE_SUM: return "sum";
+    case AGGREGATE_MIN: return "min";
+    case AGGREGATE_MAX: return "max";
+    case AGGREGATE_AVG: return "avg";
+    case AGGREGATE_STDDEV: return "stddev";
+    case AGGREGATE_INCREASE: return "increase";
+    case AGGREGATE_RATE: return "rate";
+    default: return "";
+    }
+}
+
+void aggregate_result::add(double value)
+{
+    // Welford's online algorithm
+    ++count;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+void aggregate_result::merge(const aggregate_result& other)
+{
+    if(other.count == 0)
+    {
+        return;
+    }
+    if(count == 0)
+    {
+        *this = other;
+        return;
+    }
+    // Chan's parallel algorithm
+    double n = (double) count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / n;
+    m2 += other.m2 + delta * delta * count * other.count / n;
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+void aggregate_result::remove(double value)
+{
+    if(count <= 1)
+    {
+        double min_value = min, max_value = max;
+        reset();
+        min = min_value;
+        max = max_value;
+        return;
+    }
+    // Welford's online algorithm, reversed
+    double delta = value - mean;
+    mean -= delta / (count - 1);
+    m2 = std::max(0.0, m2 - delta * (value - mean));
+    --count;
+    sum -= value;
+}
+
+double aggregate_result::avg()const
+{
+    return count > 0 ? mean : std::nan("");
+}
+
+double aggregate_result::variance()const
+{
+    return count > 0 ? m2 / count : std::nan("");
+}
+
+double aggregate_result::stddev()const
+{
+    return std::sqrt(variance());
+}
+
+double aggregate_result::value(aggregate_op op)const
+{
+    switch(op)
+    {
+    case AGGREGATE_COUNT: return (double) count;
+    case AGGREGATE_SUM: return count > 0 ? sum : std::nan("");
+    case AGGREGATE_MIN: return count > 0 ? min : std::nan("");
+    case AGGREGATE_MAX: return count > 0 ? max : std::nan("");
+    case AGGREGATE_AVG: return avg();
+    case AGGREGATE_STDDEV: return stddev();
+    default: return std::nan("");
+    }
+}
+
+//
+// Aggregation kernels
+//
+// Kernels accumulate, for valid values, the sum and the sum of squares of
+// values shifted by a reference value (for accuracy), and the min and max.
+//
+
+namespace
+{
+
+struct partial_aggregate
+{
+    double sum = 0;
+    double sumsq = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+typedef void (*aggregate_kernel_t)(const double* values, const uint8_t* validity, size_t count,
+        double shift, partial_aggregate& res);
+
+inline bool is_valid(const uint8_t* validity, size_t n)
+{
+    return validity == nullptr || (validity[n / 8] & (1 << (n % 8))) != 0;
+}
+
+void aggregate_range_scalar(const double* values, const uint8_t* validity, size_t from, size_t count,
+        double shift, partial_aggregate& res)
+{
+    for(size_t n = from; n < count; ++n)
+    {
+        if(is_valid(validity, n))
+        {
+            double value = values[n];
+            double delta = value - shift;
+            res.sum += delta;
+            res.sumsq += delta * delta;
+            res.min = std::min(res.min, value);
+            res.max = std::max(res.max, value);
+        }
+    }
+}
+
+void aggregate_kernel_scalar(const double* values, const uint8_t* validity, size_t count,
+        double shift, partial_aggregate& res)
+{
+    aggregate_range_scalar(values, validity, 0, count, shift, res);
+}
+
+#ifdef CYCLIC_AGGREGATE_X86
+
+#ifdef __SSE2__
+void aggregate_kernel_sse2(const double* values, const uint8_t* validity, size_t count,
+        double shift, partial_aggregate& res)
+{
+    alignas(16) static const uint64_t masks[4][2] = {
+        {0, 0}, {~0ull, 0}, {0, ~0ull}, {~0ull, ~0ull}
+    };
+
+    const __m128d shifts = _mm_set1_pd(shift);
+    const __m128d pinf = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    const __m128d ninf = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    __m128d sum = _mm_setzero_pd(), sumsq = _mm_setzero_pd(), min = pinf, max = ninf;
+
+    size_t n = 0;
+    for(; n + 2 <= count; n += 2)
+    {
+        unsigned bits = validity ? (validity[n / 8] >> (n % 8)) & 0x3 : 0x3;
+        __m128d mask = _mm_load_pd((const double*) masks[bits]);
+        __m128d value = _mm_loadu_pd(values + n);
+        __m128d delta = _mm_and_pd(_mm_sub_pd(value, shifts), mask);
+        sum = _mm_add_pd(sum, delta);
+        sumsq = _mm_add_pd(sumsq, _mm_mul_pd(delta, delta));
+        min = _mm_min_pd(min, _mm_or_pd(_mm_and_pd(mask, value), _mm_andnot_pd(mask, pinf)));
+        max = _mm_max_pd(max, _mm_or_pd(_mm_and_pd(mask, value), _mm_andnot_pd(mask, ninf)));
+    }
+
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, sum);
+    res.sum += lanes[0] + lanes[1];
+    _mm_store_pd(lanes, sumsq);
+    res.sumsq += lanes[0] + lanes[1];
+    _mm_store_pd(lanes, min);
+    res.min = std::min(res.min, std::min(lanes[0], lanes[1]));
+    _mm_store_pd(lanes, max);
+    res.max = std::max(res.max, std::max(lanes[0], lanes[1]));
+
+    aggregate_range_scalar(values, validity, n, count, shift, res);
+}
+#endif // __SSE2__
+
+__attribute__((target("avx2")))
+void aggregate_kernel_avx2(const double* values, const uint8_t* validity, size_t count,
+        double shift, partial_aggregate& res)
+{
+    const __m256i lanes_bits = _mm256_setr_epi64x(1, 2, 4, 8);
+    const __m256d shifts = _mm256_set1_pd(shift);
+    const __m256d pinf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d ninf = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    __m256d sum = _mm256_setzero_pd(), sumsq = _mm256_setzero_pd(), min = pinf, max = ninf;
+
+    size_t n = 0;
+    for(; n + 4 <= count; n += 4)
+    {
+        long long bits = validity ? (validity[n / 8] >> (n % 8)) & 0xF : 0xF;
+        __m256i selected = _mm256_and_si256(_mm256_set1_epi64x(bits), lanes_bits);
+        __m256d mask = _mm256_castsi256_pd(_mm256_cmpeq_epi64(selected, lanes_bits));
+        __m256d value = _mm256_loadu_pd(values + n);
+        __m256d delta = _mm256_and_pd(_mm256_sub_pd(value, shifts), mask);
+        sum = _mm256_add_pd(sum, delta);
+        sumsq = _mm256_add_pd(sumsq, _mm256_mul_pd(delta, delta));
+        min = _mm256_min_pd(min, _mm256_blendv_pd(pinf, value, mask));
+        max = _mm256_max_pd(max, _mm256_blendv_pd(ninf, value, mask));
+    }
+
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, sum);
+    res.sum += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_store_pd(lanes, sumsq);
+    res.sumsq += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm256_store_pd(lanes, min);
+    res.min = std::min(res.min, std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3])));
+    _mm256_store_pd(lanes, max);
+    res.max = std::max(res.max, std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3])));
+
+    aggregate_range_scalar(values, validity, n, count, shift, res);
+}
+
+#endif // CYCLIC_AGGREGATE_X86
+
+struct aggregate_kernel_desc
+{
+    aggregate_kernel_t kernel;
+    const char* name;
+};
+
+aggregate_kernel_desc select_aggregate_kernel()
+{
+#ifdef CYCLIC_AGGREGATE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+    {
+        return {aggregate_kernel_avx2, "avx2"};
+    }
+#ifdef __SSE2__
+    return {aggregate_kernel_sse2, "sse2"};
+#endif
+#endif
+    return {aggregate_kernel_scalar, "scalar"};
+}
+
+const aggregate_kernel_desc& get_aggregate_kernel()
+{
+    static const aggregate_kernel_desc kernel = select_aggregate_kernel();
+    return kernel;
+}
+
+uint64_t count_valid(const uint8_t* validity, size_t count)
+{
+    if(validity == nullptr)
+    {
+        return count;
+    }
+    uint64_t res = 0;
+    size_t bytes = count / 8;
+    for(size_t n = 0; n < bytes; ++n)
+    {
+        res += __builtin_popcount(validity[n]);
+    }
+    if(count % 8)
+    {
+        res += __builtin_popcount(validity[bytes] & ((1 << (count % 8)) - 1));
+    }
+    return res;
+}
+
+} // anonymous namespace
+
+const char* aggregate_kernel()
+{
+    return get_aggregate_kernel().name;
+}
+
+void aggregate_values(const double* values, const uint8_t* validity, size_t count,
+        aggregate_ops ops, aggregate_result& result)
+{
+    aggregate_result chunk;
+    chunk.count = count_valid(validity, count);
+    if(chunk.count == 0)
+    {
+        return;
+    }
+
+    if(ops & ~AGGREGATE_COUNT)
+    {
+        // Shift values by the first valid one for accuracy.
+        size_t first = 0;
+        while(!is_valid(validity, first))
+        {
+            ++first;
+        }
+        double shift = values[first];
+
+        partial_aggregate partial;
+        get_aggregate_kernel().kernel(values, validity, count, shift, partial);
+
+        chunk.sum = partial.sum + shift * chunk.count;
+        chunk.mean = shift + partial.sum / chunk.count;
+        chunk.m2 = std::max(0.0, partial.sumsq - partial.sum * partial.sum / chunk.count);
+        chunk.min = partial.min;
+        chunk.max = partial.max;
+    }
+
+    result.merge(chunk);
+}
+
+//
+// rolling_aggregate
+//
+
+rolling_aggregate::rolling_aggregate(size_t window, aggregate_ops ops):
+_ops(ops),
+_values(window, 0),
+_valid(window, false)
+{
+    if(window == 0)
+    {
+        throw std::invalid_argument{"Rolling aggregate window cannot be empty."};
+    }
+}
+
+void rolling_aggregate::set(uint64_t seq, bool valid, double value)
+{
+    uint64_t window = _values.size();
+    if(seq < _next)
+    {
+        if(_next - seq > window)
+        {
+            // Before the window.
+            return;
+        }
+        // Replace a value in the window.
+        size_t slot = seq % window;
+        if(_valid[slot])
+        {
+            _result.remove(_values[slot]);
+        }
+        _values[slot] = value;
+        _valid[slot] = valid;
+        if(valid)
+        {
+            _result.add(value);
+        }
+        rebuild_extrema();
+        return;
+    }
+
+    if(seq - _next >= window)
+    {
+        // The whole window slides out.
+        clear();
+    }
+    else
+    {
+        // Subtract values leaving the window, up to the new one.
+        for(uint64_t s = _next; s <= seq; ++s)
+        {
+            size_t slot = s % window;
+            if(_valid[slot])
+            {
+                _result.remove(_values[slot]);
+                _valid[slot] = false;
+            }
+        }
+    }
+    _next = seq + 1;
+
+    size_t slot = seq % window;
+    _values[slot] = value;
+    _valid[slot] = valid;
+    if(valid)
+    {
+        _result.add(value);
+        if(_ops & AGGREGATE_MIN)
+        {
+            while(!_min.empty() && _min.back().second >= value) _min.pop_back();
+            _min.emplace_back(seq, value);
+        }
+        if(_ops & AGGREGATE_MAX)
+        {
+            while(!_max.empty() && _max.back().second <= value) _max.pop_back();
+            _max.emplace_back(seq, value);
+        }
+    }
+    while(!_min.empty() && _min.front().first + window <= seq) _min.pop_front();
+    while(!_max.empty() && _max.front().first + window <= seq) _max.pop_front();
+}
+
+void rolling_aggregate::clear()
+{
+    std::fill(_valid.begin(), _valid.end(), false);
+    _result.reset();
+    _min.clear();
+    _max.clear();
+}
+
+void rolling_aggregate::rebuild_extrema()
+{
+    _min.clear();
+    _max.clear();
+    uint64_t window = _values.size();
+    for(uint64_t s = _next > window ? _next - window : 0; s < _next; ++s)
+    {
+        size_t slot = s % window;
+        if(!_valid[slot])
+        {
+            continue;
+        }
+        double value = _values[slot];
+        if(_ops & AGGREGATE_MIN)
+        {
+            while(!_min.empty() && _min.back().second >= value) _min.pop_back();
+            _min.emplace_back(s, value);
+        }
+        if(_ops & AGGREGATE_MAX)
+        {
+            while(!_max.empty() && _max.back().second <= value) _max.pop_back();
+            _max.emplace_back(s, value);
+        }
+    }
+}
+
+aggregate_result rolling_aggregate::result()const
+{
+    aggregate_result res = _result;
+    res.min = _min.empty() ? std::numeric_limits<double>::infinity() : _min.front().second;
+    res.max = _max.empty() ? -std::numeric_limits<double>::infinity() : _max.front().second;
+    if(res.count == 0)
+    {
+        // Drop accumulated rounding errors.
+        res.reset();
+    }
+    return res;
+}
+
+} // namespace cyclic
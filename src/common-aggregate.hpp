@@ -0,0 +1,225 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-aggregate.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CYCLIC_COMMON_AGGREGATE_HPP_
+#define _CYCLIC_COMMON_AGGREGATE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cyclic
+{
+    /**
+     * Aggregation operations.
+     * Values are flags, to be combined in aggregate_ops.
+     */
+    enum aggregate_op : uint32_t
+    {
+        AGGREGATE_COUNT  = 0x01, ///< Number of values (not null).
+        AGGREGATE_SUM    = 0x02, ///< Sum of values.
+        AGGREGATE_MIN    = 0x04, ///< Minimum value.
+        AGGREGATE_MAX    = 0x08, ///< Maximum value.
+        AGGREGATE_AVG    = 0x10, ///< Arithmetic mean of values.
+        AGGREGATE_STDDEV = 0x20, ///< Population standard deviation of values.
+
+        AGGREGATE_ALL    = 0x3F, ///< All operations on values.
+
+        AGGREGATE_INCREASE = 0x40, ///< Increase of a counter, computed by table::counter() and not by aggregate_values().
+        AGGREGATE_RATE     = 0x80  ///< Increase of a counter per time unit, computed by table::counter() and not by aggregate_values().
+    };
+
+    /**
+     * Combination of aggregation operations flags.
+     */
+    typedef uint32_t aggregate_ops;
+
+    /**
+     * Retrieve the name of an aggregation operation.
+     * @param op Aggregation operation.
+     * @return Lower case name of the operation ("count", "sum", "min", "max", "avg", "stddev",
+     * "increase", "rate"), empty if unknown.
+     */
+    std::string aggregate_op_name(aggregate_op op);
+
+    /**
+     * Aggregated values of a field.
+     * Aggregates can be built incrementally and merged together.
+     * Variance is maintained as a sum of squared differences to the mean,
+     * to stay accurate for values with large offsets (like timestamps).
+     */
+    struct aggregate_result
+    {
+        /** Number of aggregated values. */
+        uint64_t count = 0;
+        /** Sum of aggregated values. */
+        double sum = 0;
+        /** Minimum of aggregated values, +infinity if none. */
+        double min = std::numeric_limits<double>::infinity();
+        /** Maximum of aggregated values, -infinity if none. */
+        double max = -std::numeric_limits<double>::infinity();
+        /** Mean of aggregated values. */
+        double mean = 0;
+        /** Sum of squared differences to the mean. */
+        double m2 = 0;
+
+        /** Forget all aggregated values. */
+        void reset() {*this = aggregate_result{};}
+
+        /**
+         * Aggregate one value.
+         * @param value Value to aggregate.
+         */
+        void add(double value);
+
+        /**
+         * Aggregate values already aggregated in another result.
+         * @param other Other aggregated values.
+         */
+        void merge(const aggregate_result& other);
+
+        /**
+         * Remove a value previously aggregated.
+         * Minimum and maximum are left unchanged, they cannot be maintained on removal.
+         * @param value Value to remove.
+         */
+        void remove(double value);
+
+        /**
+         * Arithmetic mean of aggregated values.
+         * @return Mean, NaN if no value.
+         */
+        double avg()const;
+        /**
+         * Population variance of aggregated values.
+         * @return Variance, NaN if no value.
+         */
+        double variance()const;
+        /**
+         * Population standard deviation of aggregated values.
+         * @return Standard deviation, NaN if no value.
+         */
+        double stddev()const;
+
+        /**
+         * Retrieve the result of an aggregation operation.
+         * @param op Aggregation operation.
+         * @return Result, NaN if no value (except for count).
+         */
+        double value(aggregate_op op)const;
+    };
+
+    /**
+     * Aggregate maintained incrementally over a sliding window of sequential values.
+     * Values are identified by increasing sequence numbers (typically record indexes),
+     * the window holds the values of the last `window` sequence numbers.
+     * Values leaving the window are subtracted from the aggregate, minimum and maximum
+     * are maintained with monotonic queues, so the aggregate is always available in O(1).
+     */
+    class rolling_aggregate
+    {
+    public:
+        /**
+         * Create an empty rolling aggregate.
+         * @param window Number of sequence numbers in the window.
+         * @param ops Requested operations, other ones may not be computed.
+         * @throw std::invalid_argument If the window is empty.
+         */
+        rolling_aggregate(size_t window, aggregate_ops ops = AGGREGATE_ALL);
+
+        /**
+         * Set the value of a sequence number.
+         * Setting a sequence number after the window slides it, sequence numbers skipped
+         * are considered null. Setting one in the window replaces its value.
+         * Setting one before the window does nothing.
+         * @param seq Sequence number of the value.
+         * @param valid False if the value is null.
+         * @param value Value, ignored if null.
+         */
+        void set(uint64_t seq, bool valid, double value = 0);
+
+        /** Forget all values. */
+        void clear();
+
+        /**
+         * Retrieve the aggregate of the values in the window.
+         * @return Aggregate of values.
+         */
+        aggregate_result result()const;
+
+        /**
+         * Retrieve the number of sequence numbers in the window.
+         * @return Size of the window.
+         */
+        size_t window()const {return _values.size();}
+        /**
+         * Retrieve the requested operations.
+         * @return Requested operations.
+         */
+        aggregate_ops ops()const {return _ops;}
+        /**
+         * Retrieve the sequence number following the last one of the window.
+         * @return Next sequence number, 0 if no value has been set.
+         */
+        uint64_t next()const {return _next;}
+
+    protected:
+        /** Rebuild minimum and maximum queues from the window values. */
+        void rebuild_extrema();
+
+        aggregate_ops _ops;
+        /** Window values, sequence number seq is at seq % window. */
+        std::vector<double> _values;
+        /** Window validities, sequence number seq is at seq % window. */
+        std::vector<bool> _valid;
+        /** Sequence number following the last one of the window. */
+        uint64_t _next = 0;
+        /** Aggregate of window values (without minimum and maximum). */
+        aggregate_result _result;
+        /** Candidates for minimum, increasing values, in sequence order. */
+        std::deque<std::pair<uint64_t, double>> _min;
+        /** Candidates for maximum, decreasing values, in sequence order. */
+        std::deque<std::pair<uint64_t, double>> _max;
+    };
+
+    /**
+     * Aggregate a buffer of values.
+     * Uses SIMD kernels selected at runtime for the running processor.
+     * @param values Values to aggregate.
+     * @param validity Validity bitmap, bit (i % 8) of byte (i / 8) is set if values[i] shall be aggregated.
+     * Can be nullptr if all values are valid.
+     * @param count Number of values.
+     * @param ops Requested operations, other ones may not be computed.
+     * @param result Aggregate to which add values.
+     */
+    void aggregate_values(const double* values, const uint8_t* validity, size_t count,
+            aggregate_ops ops, aggregate_result& result);
+
+    /**
+     * Name of the aggregation kernel selected for the running processor.
+     * @return Kernel name ("avx2", "sse2" or "scalar").
+     */
+    const char* aggregate_kernel();
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_AGGREGATE_HPP_
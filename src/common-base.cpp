@@ -19,6 +19,10 @@
  */
 
 #include "common-base.hpp"
+#include "common-predicate.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 namespace cyclic
 {
@@ -341,4 +345,696 @@ void raw_record::fill(std::initializer_list<cyclic::value_t> init)
     // TODO Add more integrity check ?
 }
 
-} // namespace cyclic
\ No newline at end of file
+//
+// recordset
+//
+
+field_handle recordset::resolve(const std::string& field_name)const
+{
+    field_index_t index = field_index(field_name);
+    if(index == field::invalid_index())
+    {
+        throw unknown_field{"Unknown field '" + field_name + "'."};
+    }
+    return field_handle{index, field(index).type()};
+}
+
+aggregate_result recordset::aggregate(field_index_t field, record_index_t first, record_index_t last,
+        aggregate_ops /*ops*/)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+
+    aggregate_result res;
+    if(record_count() == 0)
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+    for(record_index_t index = from; index <= to; ++index)
+    {
+        std::unique_ptr<record> rec = get_record(index);
+        if(rec && rec->has(field))
+        {
+            res.add(rec->get<double>(field));
+        }
+    }
+    return res;
+}
+
+std::vector<aggregate_bucket> recordset::group_by(field_index_t field, record_index_t first, record_index_t last,
+        record_index_t bucket_size, aggregate_ops ops)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(bucket_size == 0)
+    {
+        throw std::invalid_argument{"Bucket size cannot be null."};
+    }
+
+    std::vector<aggregate_bucket> res;
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+    for(uint64_t index = from; index <= to; )
+    {
+        record_index_t bucket_last = (record_index_t) std::min<uint64_t>(to, index - index % bucket_size + bucket_size - 1);
+        res.push_back(aggregate_bucket{(record_index_t) index, bucket_last,
+                aggregate(field, (record_index_t) index, bucket_last, ops)});
+        index = (uint64_t) bucket_last + 1;
+    }
+    return res;
+}
+
+std::vector<sketch_bucket> recordset::sketch_by(field_index_t field, record_index_t first, record_index_t last,
+        record_index_t bucket_size, double relative_accuracy)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(bucket_size == 0)
+    {
+        throw std::invalid_argument{"Bucket size cannot be null."};
+    }
+
+    std::vector<sketch_bucket> res;
+    quantile_sketch empty(relative_accuracy);
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+    for(uint64_t index = from; index <= to; )
+    {
+        record_index_t bucket_last = (record_index_t) std::min<uint64_t>(to, index - index % bucket_size + bucket_size - 1);
+        res.push_back(sketch_bucket{(record_index_t) index, bucket_last, empty});
+        for(; index <= bucket_last; ++index)
+        {
+            std::unique_ptr<record> rec = get_record((record_index_t) index);
+            if(rec && rec->has(field))
+            {
+                res.back().sketch.add(rec->get<double>(field));
+            }
+        }
+    }
+    return res;
+}
+
+std::vector<record_index_t> recordset::filter(const predicate& where, record_index_t first, record_index_t last)const
+{
+    for(field_index_t field : where.fields())
+    {
+        if(field >= field_count())
+        {
+            throw std::out_of_range{"Out of range field id."};
+        }
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+
+    std::vector<record_index_t> res;
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+    for(uint64_t index = from; index <= to; ++index)
+    {
+        std::unique_ptr<record> rec = get_record((record_index_t) index);
+        if(rec && where.matches(*rec))
+        {
+            res.push_back((record_index_t) index);
+        }
+    }
+    return res;
+}
+
+//
+// table
+//
+
+aggregate_result table::aggregate(field_index_t field, record_time_t start, record_time_t end,
+        aggregate_ops ops)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    return aggregate(field, record_index(start), record_index(end), ops);
+}
+
+table::continuous_aggregate_t table::add_continuous_aggregate(field_index_t field, record_time_t window,
+        aggregate_ops ops)
+{
+    record_time_t duration = record_duration();
+    if(duration == 0)
+    {
+        throw time_not_supported{"Time is not supported by the table."};
+    }
+    if(window <= 0 || window % duration != 0)
+    {
+        throw std::invalid_argument{"Window must be a positive multiple of the record duration."};
+    }
+    return add_continuous_aggregate(field, (record_index_t) (window / duration), ops);
+}
+
+std::vector<aggregate_bucket> table::group_by(field_index_t field, record_time_t start, record_time_t end,
+        record_time_t interval, aggregate_ops ops)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    record_time_t duration = record_duration();
+    if(duration == 0)
+    {
+        throw time_not_supported{"Time is not supported by the table."};
+    }
+    if(interval <= 0 || interval % duration != 0)
+    {
+        throw std::invalid_argument{"Interval must be a positive multiple of the record duration."};
+    }
+    return group_by(field, record_index(start), record_index(end), (record_index_t) (interval / duration), ops);
+}
+
+std::vector<sketch_bucket> table::sketch_by(field_index_t field, record_time_t start, record_time_t end,
+        record_time_t interval, double relative_accuracy)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    record_time_t duration = record_duration();
+    if(duration == 0)
+    {
+        throw time_not_supported{"Time is not supported by the table."};
+    }
+    if(interval <= 0 || interval % duration != 0)
+    {
+        throw std::invalid_argument{"Interval must be a positive multiple of the record duration."};
+    }
+    return sketch_by(field, record_index(start), record_index(end), (record_index_t) (interval / duration),
+            relative_accuracy);
+}
+
+void table::resample(field_index_t field, record_time_t start, record_time_t end, record_time_t duration,
+        resample_method method, const std::function<void(const column_chunk&)>& fn)const
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(record_duration() == 0 && !timestamped())
+    {
+        throw time_not_supported{"Time is not supported by the table."};
+    }
+    resampler sampler(start, end, duration, method, record_duration());
+    bool stamped = timestamped();
+    std::vector<double> values(chunk_size);
+    std::vector<uint8_t> validity(chunk_size / 8);
+    std::vector<record_time_t> times(chunk_size);
+
+    if(record_count() != 0)
+    {
+        // Begin with the record covering the start or, when a previous value is needed,
+        // with the last one having a value at or before the start.
+        record_index_t first = min_index();
+        if(start > record_time(first))
+        {
+            first = std::min(max_index(), record_index(start));
+            for(record_index_t last = first; method != resample_method::none && last >= min_index(); )
+            {
+                record_index_t from = last - std::min<record_index_t>(last - min_index(), chunk_size - 1);
+                read_column(field, from, last, CDB_DT_FLOAT_8, values.data(), validity.data());
+                record_index_t n = last - from + 1;
+                while(n > 0 && !(validity[(n - 1) / 8] & (1 << ((n - 1) % 8))))
+                {
+                    --n;
+                }
+                if(n > 0 || from == min_index())
+                {
+                    first = n > 0 ? from + n - 1 : first;
+                    break;
+                }
+                last = from - 1;
+            }
+        }
+
+        for(uint64_t index = first; index <= max_index() && !sampler.done(); index += chunk_size)
+        {
+            record_index_t last = (record_index_t) std::min<uint64_t>(max_index(), index + chunk_size - 1);
+            record_index_t count = last - (record_index_t) index + 1;
+            read_column(field, (record_index_t) index, last, CDB_DT_FLOAT_8, values.data(), validity.data());
+            for(record_index_t n = 0; n < count; ++n)
+            {
+                times[n] = stamped ? record_time((record_index_t) index + n)
+                        : record_origin() + (record_time_t) (index + n) * record_duration();
+            }
+            sampler.push(times.data(), values.data(), validity.data(), count, fn);
+        }
+    }
+    sampler.finish(fn);
+}
+
+std::vector<ranked_value> table::top_k(field_index_t field, record_index_t first, record_index_t last,
+        size_t k, bool largest)const
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+
+    std::vector<ranked_value> heap;
+    if(k == 0 || record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return heap;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+
+    // Values are negated when looking for the smallest ones, so the best value is always the greatest.
+    // The heap top is the worst kept value: the lowest, the latest for equal values.
+    double sign = largest ? 1 : -1;
+    auto better = [](const ranked_value& a, const ranked_value& b) {
+        return a.value > b.value || (a.value == b.value && a.index < b.index);
+    };
+    heap.reserve(k);
+
+    std::vector<double> values(std::min<size_t>(chunk_size, (size_t) to - from + 1));
+    std::vector<uint8_t> validity((values.size() - 1) / 8 + 1);
+    for(uint64_t index = from; index <= to; index += chunk_size)
+    {
+        record_index_t count = (record_index_t) std::min<uint64_t>(to - index + 1, chunk_size);
+        read_column(field, (record_index_t) index, (record_index_t) index + count - 1, CDB_DT_FLOAT_8, values.data(), validity.data());
+        if(heap.size() == k)
+        {
+            // Skip the chunk if its best value cannot enter the heap.
+            aggregate_result summary;
+            aggregate_values(values.data(), validity.data(), count, largest ? AGGREGATE_MAX : AGGREGATE_MIN, summary);
+            if(summary.count == 0 || sign * (largest ? summary.max : summary.min) <= heap.front().value)
+            {
+                continue;
+            }
+        }
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            if(!(validity[n / 8] & (1 << (n % 8))) || std::isnan(values[n]))
+            {
+                continue;
+            }
+            ranked_value val{(record_index_t) index + n, sign * values[n]};
+            if(heap.size() < k)
+            {
+                heap.push_back(val);
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+            else if(better(val, heap.front()))
+            {
+                std::pop_heap(heap.begin(), heap.end(), better);
+                heap.back() = val;
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), better);
+    for(ranked_value& val : heap)
+    {
+        val.value *= sign;
+    }
+    return heap;
+}
+
+std::vector<ranked_value> table::top_k(field_index_t field, record_time_t start, record_time_t end,
+        size_t k, bool largest)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    return top_k(field, record_index(start), record_index(end), k, largest);
+}
+
+std::vector<threshold_crossing> table::crossings(field_index_t field, record_index_t first, record_index_t last,
+        double threshold)const
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+
+    std::vector<threshold_crossing> res;
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+
+    std::vector<double> values(std::min<size_t>(chunk_size, (size_t) to - from + 1));
+    std::vector<uint8_t> validity((values.size() - 1) / 8 + 1);
+    std::vector<uint8_t> above(values.size());
+    // Side of the previous value: -1 if none yet, 1 if above the threshold, 0 otherwise.
+    int side = -1;
+    for(uint64_t index = from; index <= to; index += chunk_size)
+    {
+        record_index_t count = (record_index_t) std::min<uint64_t>(to - index + 1, chunk_size);
+        read_column(field, (record_index_t) index, (record_index_t) index + count - 1, CDB_DT_FLOAT_8, values.data(), validity.data());
+
+        // Skip the chunk if all its values stay on the current side.
+        aggregate_result summary;
+        aggregate_values(values.data(), validity.data(), count, AGGREGATE_MIN | AGGREGATE_MAX, summary);
+        if(summary.count == 0 || (side == 1 && summary.min > threshold) || (side == 0 && summary.max <= threshold))
+        {
+            continue;
+        }
+
+        // Branch-free side computation, vectorized by the compiler, then a pass over valid values.
+        const double* vals = values.data();
+        uint8_t* sides = above.data();
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            sides[n] = vals[n] > threshold;
+        }
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            if(!(validity[n / 8] & (1 << (n % 8))) || std::isnan(vals[n]))
+            {
+                continue;
+            }
+            if(side != -1 && sides[n] != side)
+            {
+                res.push_back(threshold_crossing{(record_index_t) index + n, vals[n], sides[n] == 1});
+            }
+            side = sides[n];
+        }
+    }
+    return res;
+}
+
+std::vector<threshold_crossing> table::crossings(field_index_t field, record_time_t start, record_time_t end,
+        double threshold)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    return crossings(field, record_index(start), record_index(end), threshold);
+}
+
+//
+// Counters
+//
+
+/**
+ * Retrieve the width of a counter field.
+ * @param type Type of the field.
+ * @return Width in bits.
+ * @throw std::invalid_argument if the field is not an unsigned integer.
+ */
+static unsigned counter_width(data_type type)
+{
+    switch(type)
+    {
+    case CDB_DT_UNSIGNED_8: return 8;
+    case CDB_DT_UNSIGNED_16: return 16;
+    case CDB_DT_UNSIGNED_32: return 32;
+    case CDB_DT_UNSIGNED_64: return 64;
+    default:
+        throw std::invalid_argument{"Counter field must be of an unsigned integer type."};
+    }
+}
+
+/**
+ * Function receiving increases of a counter for a chunk of records.
+ * Parameters are the index of the first record of the chunk, the number of records of the chunk,
+ * the number of values in the chunk and, for each value: its record index, its increase from
+ * the previous value, the number of records since it (0 for the first value of the scan) and
+ * 1 if the counter has been reset.
+ */
+typedef std::function<void(record_index_t, record_index_t, size_t, const record_index_t*,
+        const uint64_t*, const record_index_t*, const uint8_t*)> counter_chunk_fn;
+
+/**
+ * Stream increases between consecutive values of a counter field over a range of stored records.
+ * @param tbl Table to read.
+ * @param field Index of the counter field.
+ * @param from Index of the first record, shall be stored.
+ * @param to Index of the last record (inclusive), shall be stored.
+ * @param fn Function called for each chunk of decoded records.
+ */
+static void scan_counter(const table& tbl, field_index_t field, record_index_t from, record_index_t to,
+        const counter_chunk_fn& fn)
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    unsigned width = counter_width(tbl.field(field).type());
+    std::vector<uint64_t> values(chunk_size), samples(chunk_size), deltas(chunk_size);
+    std::vector<uint8_t> validity(chunk_size / 8), resets(chunk_size);
+    std::vector<record_index_t> indexes(chunk_size), gaps(chunk_size);
+    bool has_previous = false;
+    uint64_t previous = 0;
+    record_index_t previous_index = 0;
+    for(uint64_t index = from; index <= to; index += chunk_size)
+    {
+        record_index_t count = (record_index_t) std::min<uint64_t>(to - index + 1, chunk_size);
+        tbl.read_column(field, (record_index_t) index, (record_index_t) index + count - 1, CDB_DT_UNSIGNED_64,
+                values.data(), validity.data());
+
+        // Compact values, then compute their increases in one vectorized pass.
+        size_t n = 0;
+        for(record_index_t i = 0; i < count; ++i)
+        {
+            if(validity[i / 8] & (1 << (i % 8)))
+            {
+                samples[n] = values[i];
+                indexes[n] = (record_index_t) index + i;
+                ++n;
+            }
+        }
+        if(n > 0)
+        {
+            counter_deltas(samples.data(), n, has_previous ? previous : samples[0], width, deltas.data(), resets.data());
+            gaps[0] = has_previous ? indexes[0] - previous_index : 0;
+            for(size_t k = 1; k < n; ++k)
+            {
+                gaps[k] = indexes[k] - indexes[k - 1];
+            }
+            has_previous = true;
+            previous = samples[n - 1];
+            previous_index = indexes[n - 1];
+        }
+        fn((record_index_t) index, count, n, indexes.data(), deltas.data(), gaps.data(), resets.data());
+    }
+}
+
+counter_result table::counter(field_index_t field, record_index_t first, record_index_t last)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    counter_width(this->field(field).type());
+
+    counter_result res;
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_time_t duration = record_duration();
+    scan_counter(*this, field, std::max(first, min_index()), std::min(last, max_index()),
+            [&](record_index_t, record_index_t, size_t count, const record_index_t*,
+                const uint64_t* deltas, const record_index_t* gaps, const uint8_t* resets) {
+        uint64_t increase = 0, records = 0, reset = 0;
+        for(size_t n = 0; n < count; ++n)
+        {
+            increase += deltas[n];
+            records += gaps[n];
+            reset += resets[n];
+        }
+        res.count += count;
+        res.increase += increase;
+        res.elapsed += (record_time_t) records * duration;
+        res.resets += reset;
+    });
+    return res;
+}
+
+counter_result table::counter(field_index_t field, record_time_t start, record_time_t end)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    return counter(field, record_index(start), record_index(end));
+}
+
+std::vector<counter_bucket> table::counter_by(field_index_t field, record_index_t first, record_index_t last,
+        record_index_t bucket_size)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(bucket_size == 0)
+    {
+        throw std::invalid_argument{"Bucket size cannot be null."};
+    }
+    counter_width(this->field(field).type());
+
+    std::vector<counter_bucket> res;
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, min_index());
+    record_index_t to = std::min(last, max_index());
+    for(uint64_t index = from; index <= to; )
+    {
+        record_index_t bucket_last = (record_index_t) std::min<uint64_t>(to, index - index % bucket_size + bucket_size - 1);
+        res.push_back(counter_bucket{(record_index_t) index, bucket_last, counter_result{}});
+        index = (uint64_t) bucket_last + 1;
+    }
+
+    record_time_t duration = record_duration();
+    record_index_t origin = from / bucket_size;
+    scan_counter(*this, field, from, to,
+            [&](record_index_t, record_index_t, size_t count, const record_index_t* indexes,
+                const uint64_t* deltas, const record_index_t* gaps, const uint8_t* resets) {
+        for(size_t n = 0; n < count; ++n)
+        {
+            counter_result& bucket = res[indexes[n] / bucket_size - origin].result;
+            bucket.count++;
+            bucket.increase += deltas[n];
+            bucket.elapsed += (record_time_t) gaps[n] * duration;
+            bucket.resets += resets[n];
+        }
+    });
+    return res;
+}
+
+std::vector<counter_bucket> table::counter_by(field_index_t field, record_time_t start, record_time_t end,
+        record_time_t interval)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    record_time_t duration = record_duration();
+    if(duration == 0)
+    {
+        throw time_not_supported{"Time is not supported by the table."};
+    }
+    if(interval <= 0 || interval % duration != 0)
+    {
+        throw std::invalid_argument{"Interval must be a positive multiple of the record duration."};
+    }
+    return counter_by(field, record_index(start), record_index(end), (record_index_t) (interval / duration));
+}
+
+void table::derivative(field_index_t field, record_index_t first, record_index_t last,
+        const std::function<void(const column_chunk&)>& fn)const
+{
+    if(field >= field_count())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    counter_width(this->field(field).type());
+    record_time_t duration = record_duration();
+    if(duration == 0)
+    {
+        throw time_not_supported{"Derivative needs a record duration."};
+    }
+    if(record_count() == 0 || last < min_index() || first > max_index())
+    {
+        return;
+    }
+
+    column_chunk out;
+    scan_counter(*this, field, std::max(first, min_index()), std::min(last, max_index()),
+            [&](record_index_t index, record_index_t records, size_t count, const record_index_t* indexes,
+                const uint64_t* deltas, const record_index_t* gaps, const uint8_t*) {
+        out.clear(record_time(index), duration);
+        size_t n = 0;
+        for(record_index_t i = 0; i < records; ++i)
+        {
+            if(n < count && indexes[n] == index + i)
+            {
+                out.push_back(gaps[n] != 0, (double) deltas[n] / (double) (gaps[n] * duration));
+                ++n;
+            }
+            else
+            {
+                out.push_back(false);
+            }
+        }
+        fn(out);
+    });
+}
+
+void table::derivative(field_index_t field, record_time_t start, record_time_t end,
+        const std::function<void(const column_chunk&)>& fn)const
+{
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    derivative(field, record_index(start), record_index(end), fn);
+}
+
+} // namespace cyclic
@@ -20,13 +20,24 @@
 #ifndef _CYCLIC_COMMON_BASE_HPP_
 #define _CYCLIC_COMMON_BASE_HPP_
 
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <initializer_list>
+#include <iterator>
 #include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "common-type.hpp"
+#include "common-aggregate.hpp"
+#include "common-counter.hpp"
+#include "common-resample.hpp"
+#include "common-sketch.hpp"
 
 /**
  * Base CyclicDB namespace.
@@ -37,6 +48,8 @@ namespace cyclic
     class recordset;
     class const_recordset_iterator;
     class table;
+    class predicate;
+    class record_range;
 
     /**
      * Report the record is not attached to a recordset.
@@ -88,6 +101,19 @@ namespace cyclic
         ~table_is_full(){}
     };
 
+    /**
+     * Report asynchronous append queue is full.
+     * The record has not been (and will not be) appended.
+     */
+    class queue_is_full : public std::overflow_error
+    {
+    public:
+        queue_is_full():std::overflow_error(nullptr){}
+        explicit queue_is_full(const std::string& what_arg):std::overflow_error(what_arg){}
+        explicit queue_is_full(const char* what_arg):std::overflow_error(what_arg){}
+        ~queue_is_full(){}
+    };
+
     /**
     * Base read-only field descriptor facade.
     * Used to describe field.
@@ -147,6 +173,48 @@ namespace cyclic
         data_type type;
     };
 
+    /**
+     * Pre-resolved field of a recordset.
+     * Resolving a field name once with recordset::resolve() and accessing values
+     * through the handle avoids looking the name up on every access.
+     * It converts to the field index, so it can be used with any index-based accessor.
+     */
+    class field_handle
+    {
+    protected:
+        field_index_t _index = field::invalid_index();
+        data_type _type = CDB_DT_UNSPECIFIED;
+    public:
+        /** Invalid handle. */
+        field_handle() = default;
+
+        /**
+         * Handle of a resolved field.
+         * @param index Index of the field.
+         * @param type Data type of the field.
+         */
+        field_handle(field_index_t index, data_type type):_index(index),_type(type){}
+
+        /**
+         * Test if the handle designates a field.
+         * @return True if the handle is valid.
+         */
+        bool valid()const {return _index != field::invalid_index();}
+        /**
+         * Index of the field.
+         * @return Index of the field, field::invalid_index() if the handle is invalid.
+         */
+        field_index_t index()const {return _index;}
+        /**
+         * Data type of the field.
+         * @return Data type of the field, CDB_DT_UNSPECIFIED if the handle is invalid.
+         */
+        data_type type()const {return _type;}
+
+        /** Convert to the field index. */
+        operator field_index_t()const {return _index;}
+    };
+
     /**
      * Read-only record structure.
      * It allow to retrieve data from a recordset (like a table).
@@ -162,8 +230,9 @@ namespace cyclic
         /**
          * Type of record index.
          * Index is the 0-based index to which the record is stored in a table.
+         * Stored tables limit their indexes to 32 bits unless created with wide indexes.
          */
-        typedef uint32_t index_t;
+        typedef uint64_t index_t;
 
         /**
          * Special record index value designating an invalid record index.
@@ -555,6 +624,352 @@ namespace cyclic
         const cyclic::field& field(const std::string& field_name)const;
     };
 
+    /**
+     * Description of the binary encoding of records in storage slots.
+     * A slot begins with a header bitmap (one bit per field, set if the field has a value)
+     * followed by packed field values in native byte order.
+     */
+    struct record_layout
+    {
+        /** Encoding of a field in a slot. */
+        struct field_layout
+        {
+            /** Type of the encoded value. */
+            data_type type;
+            /** Offset of the encoded value from the begining of the slot. */
+            uint32_t offset;
+        };
+
+        /** Size of the header (bitmap and timestamp, if any), in bytes. */
+        uint32_t header_size = 0;
+        /** Size of a slot, in bytes. */
+        uint32_t record_size = 0;
+        /** Offset of the record timestamp, following the bitmap in the header, 0 if records do not carry their time. */
+        uint32_t time_offset = 0;
+        /** Encoding of each field. */
+        std::vector<field_layout> fields;
+    };
+
+    /**
+     * Lightweight read-only view of a record stored in a table.
+     * It points directly to the encoded slot bytes and decodes a field only
+     * when it is accessed, without any allocation nor virtual call.
+     * A view is only valid as long as its table is alive and its slot is not
+     * overwritten (i.e. until the record is evicted from the table).
+     */
+    class record_view
+    {
+    protected:
+        const record_layout* _layout = nullptr;
+        const uint8_t* _data = nullptr;
+        record::index_t _index = record::invalid_index();
+        record::time_t _time = 0;
+        /** Owned copy of the slot, when the storage cannot be referenced directly. */
+        std::shared_ptr<const std::vector<uint8_t>> _buffer;
+
+        /**
+         * Check the field index.
+         * @param field Field index to check.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        void check(field_index_t field)const
+        {
+            if(field >= size())
+            {
+                throw std::out_of_range{"Out of range field id."};
+            }
+        }
+
+        /**
+         * Decode a value.
+         * @tparam T Requested type.
+         * @param type Encoded type.
+         * @param ptr Pointer to the encoded value.
+         * @return Decoded value, converted to requested type.
+         */
+        template<typename T> static T decode(data_type type, const uint8_t* ptr)
+        {
+            switch(type)
+            {
+            case CDB_DT_BOOLEAN: return static_cast<T>(*ptr != 0);
+            case CDB_DT_SIGNED_8: return static_cast<T>(load<int8_t>(ptr));
+            case CDB_DT_UNSIGNED_8: return static_cast<T>(load<uint8_t>(ptr));
+            case CDB_DT_SIGNED_16: return static_cast<T>(load<int16_t>(ptr));
+            case CDB_DT_UNSIGNED_16: return static_cast<T>(load<uint16_t>(ptr));
+            case CDB_DT_SIGNED_32: return static_cast<T>(load<int32_t>(ptr));
+            case CDB_DT_UNSIGNED_32: return static_cast<T>(load<uint32_t>(ptr));
+            case CDB_DT_SIGNED_64: return static_cast<T>(load<int64_t>(ptr));
+            case CDB_DT_UNSIGNED_64: return static_cast<T>(load<uint64_t>(ptr));
+            case CDB_DT_FLOAT_4: return static_cast<T>(load<float>(ptr));
+            case CDB_DT_FLOAT_8: return static_cast<T>(load<double>(ptr));
+            default: throw type_exception{};
+            }
+        }
+
+    public:
+        /** Invalid view. */
+        record_view() = default;
+
+        /**
+         * View a record encoded in memory.
+         * @param layout Layout of the encoded record, shall outlive the view.
+         * @param data Encoded record, shall outlive the view.
+         * @param index Index of the record.
+         * @param time Time of the record.
+         */
+        record_view(const record_layout* layout, const uint8_t* data,
+                record::index_t index = record::invalid_index(), record::time_t time = 0):
+            _layout(layout), _data(data), _index(index), _time(time) {}
+
+        /**
+         * View a record encoded in a buffer owned by the view.
+         * @param layout Layout of the encoded record, shall outlive the view.
+         * @param buffer Encoded record.
+         * @param index Index of the record.
+         * @param time Time of the record.
+         */
+        record_view(const record_layout* layout, std::shared_ptr<const std::vector<uint8_t>> buffer,
+                record::index_t index = record::invalid_index(), record::time_t time = 0):
+            _layout(layout), _data(buffer ? buffer->data() : nullptr), _index(index), _time(time), _buffer(std::move(buffer)) {}
+
+        /**
+         * View a record encoded in a buffer shared by several views.
+         * @param layout Layout of the encoded record, shall outlive the view.
+         * @param data Encoded record, inside the buffer.
+         * @param buffer Buffer holding the encoded record.
+         * @param index Index of the record.
+         * @param time Time of the record.
+         */
+        record_view(const record_layout* layout, const uint8_t* data, std::shared_ptr<const std::vector<uint8_t>> buffer,
+                record::index_t index = record::invalid_index(), record::time_t time = 0):
+            _layout(layout), _data(data), _index(index), _time(time), _buffer(std::move(buffer)) {}
+
+        /**
+         * Load a native value from a possibly unaligned address.
+         * @tparam T Type of value.
+         * @param ptr Address of the value.
+         * @return Loaded value.
+         */
+        template<typename T> static T load(const uint8_t* ptr)
+        {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+
+        /**
+         * Test if the view points to a record.
+         * @return True if the view is valid.
+         */
+        bool ok()const {return _data != nullptr;}
+        /**
+         * Test if the view points to a record.
+         * @return True if the view is valid.
+         */
+        explicit operator bool()const {return ok();}
+
+        /**
+         * Retrieve the index of the viewed record.
+         * @return Index of the record, invalid_index() if not known.
+         */
+        record::index_t index()const {return _index;}
+        /**
+         * Retrieve the time of the viewed record.
+         * @return Time of record, if available, 0 otherwise.
+         */
+        record::time_t time()const {return _time;}
+        /**
+         * Retrieve the number of fields of the viewed record.
+         * @return Number of fields.
+         */
+        field_index_t size()const {return _layout ? (field_index_t) _layout->fields.size() : 0;}
+        /**
+         * Retrieve the encoded record bytes.
+         * @return Pointer to the encoded record, nullptr if the view is invalid.
+         */
+        const uint8_t* data()const {return _data;}
+        /**
+         * Retrieve the layout of the encoded record.
+         * @return Layout of the record, nullptr if the view is invalid.
+         */
+        const record_layout* layout()const {return _layout;}
+
+        /**
+         * Retrieve the stored type of a field.
+         * @param field Field index.
+         * @return Type of the field.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        data_type type(field_index_t field)const {check(field); return _layout->fields[field].type;}
+
+        /**
+         * Test if the record has a value (not null) for the specified field index.
+         * @param field Field index.
+         * @return True if the record have a value for the field, false otherwise.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        bool has(field_index_t field)const
+        {
+            check(field);
+            return (_data[field / 8] & (1 << (field % 8))) != 0;
+        }
+
+        /**
+         * Get the value of a specified field, converted to the requested type.
+         * @tparam T Requested type.
+         * @param field Field index to look for.
+         * @return Value of the specified field.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw cyclic::no_value_exception if the field has no value.
+         */
+        template<typename T> T get(field_index_t field)const
+        {
+            if(!has(field))
+            {
+                throw no_value_exception{};
+            }
+            const record_layout::field_layout& fld = _layout->fields[field];
+            return decode<T>(fld.type, _data + fld.offset);
+        }
+
+        /**
+         * Get the value of a specified field, converted to the requested type, or a default value if null.
+         * @tparam T Requested type.
+         * @param field Field index to look for.
+         * @param default_value Value returned if the field has no value.
+         * @return Value of the specified field or default value.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        template<typename T> T get_or(field_index_t field, T default_value)const
+        {
+            if(!has(field))
+            {
+                return default_value;
+            }
+            const record_layout::field_layout& fld = _layout->fields[field];
+            return decode<T>(fld.type, _data + fld.offset);
+        }
+
+        /**
+         * Get the value of a specified field as a variant value.
+         * @param field Field index to look for.
+         * @return Value of the specified field, null if not set.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        value_t get(field_index_t field)const
+        {
+            if(!has(field))
+            {
+                return value_t{};
+            }
+            const record_layout::field_layout& fld = _layout->fields[field];
+            const uint8_t* ptr = _data + fld.offset;
+            switch(fld.type)
+            {
+            case CDB_DT_BOOLEAN: return value_t{*ptr != 0};
+            case CDB_DT_SIGNED_8: return value_t{load<int8_t>(ptr)};
+            case CDB_DT_UNSIGNED_8: return value_t{load<uint8_t>(ptr)};
+            case CDB_DT_SIGNED_16: return value_t{load<int16_t>(ptr)};
+            case CDB_DT_UNSIGNED_16: return value_t{load<uint16_t>(ptr)};
+            case CDB_DT_SIGNED_32: return value_t{load<int32_t>(ptr)};
+            case CDB_DT_UNSIGNED_32: return value_t{load<uint32_t>(ptr)};
+            case CDB_DT_SIGNED_64: return value_t{load<int64_t>(ptr)};
+            case CDB_DT_UNSIGNED_64: return value_t{load<uint64_t>(ptr)};
+            case CDB_DT_FLOAT_4: return value_t{load<float>(ptr)};
+            case CDB_DT_FLOAT_8: return value_t{load<double>(ptr)};
+            default: return value_t{};
+            }
+        }
+
+        /**
+         * Get the value of a specified field as a variant value.
+         * @param field Field index to look for.
+         * @return Value of the specified field, null if not set.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        value_t operator[](field_index_t field)const {return get(field);}
+    };
+
+    /**
+     * Aggregated values of a field over a bucket of consecutive records.
+     * @see recordset::group_by
+     */
+    struct aggregate_bucket
+    {
+        /** Index of the first record of the bucket. */
+        record_index_t first;
+        /** Index of the last record of the bucket (inclusive). */
+        record_index_t last;
+        /** Aggregated values of the bucket records. */
+        aggregate_result result;
+    };
+
+    /**
+     * Quantile sketch of a field over a bucket of consecutive records.
+     * @see recordset::sketch_by
+     */
+    struct sketch_bucket
+    {
+        /** Index of the first record of the bucket. */
+        record_index_t first;
+        /** Index of the last record of the bucket (inclusive). */
+        record_index_t last;
+        /** Sketch of the bucket record values. */
+        quantile_sketch sketch;
+    };
+
+    /**
+     * Value of a field in a record, as ranked by table::top_k().
+     */
+    struct ranked_value
+    {
+        /** Index of the record. */
+        record_index_t index;
+        /** Value of the field. */
+        double value;
+    };
+
+    /**
+     * Crossing of a threshold by the values of a field.
+     * @see table::crossings
+     */
+    struct threshold_crossing
+    {
+        /** Index of the first record on the other side of the threshold. */
+        record_index_t index;
+        /** Value of the field in this record. */
+        double value;
+        /** True if the value rose above the threshold, false if it fell back to or below it. */
+        bool rising;
+    };
+
+    /**
+     * Increase of a counter field over a bucket of consecutive records.
+     * @see table::counter_by
+     */
+    struct counter_bucket
+    {
+        /** Index of the first record of the bucket. */
+        record_index_t first;
+        /** Index of the last record of the bucket (inclusive). */
+        record_index_t last;
+        /** Increase of the counter up to the bucket values. */
+        counter_result result;
+    };
+
+    /**
+     * Operations accumulating values in a field of a record.
+     * @see table::accumulate
+     */
+    enum accumulate_op
+    {
+        ACCUMULATE_ADD,   ///< Add the value to the field, a null field counting as 0.
+        ACCUMULATE_MIN,   ///< Keep the minimum of the field and the value.
+        ACCUMULATE_MAX,   ///< Keep the maximum of the field and the value.
+        ACCUMULATE_LAST,  ///< Replace the field by the value.
+        ACCUMULATE_COUNT  ///< Add 1 to the field, a null field counting as 0, the value is ignored.
+    };
+
     /**
      * Inteface for recordset.
      * A recordset is a group of records.
@@ -563,6 +978,9 @@ namespace cyclic
     /* abstract */ class recordset
     {
     public:
+        /** Destructor. */
+        virtual ~recordset() = default;
+
         /**
          * Retrieve the field count of the table.
          * @return Field count.
@@ -585,6 +1003,21 @@ namespace cyclic
          */
         virtual const cyclic::field& field(const std::string& field_name)const =0;
 
+        /**
+         * Look for the index of a field from its name.
+         * @param field_name Name of field to look for.
+         * @return Index of the field, field::invalid_index() if the field is not present in the recordset.
+         */
+        virtual field_index_t field_index(const std::string& field_name)const =0;
+
+        /**
+         * Resolve a field from its name, once for all subsequent accesses.
+         * @param field_name Name of field to look for.
+         * @return Handle of the field.
+         * @throw cyclic::unknown_field if the field is not present in the recordset.
+         */
+        field_handle resolve(const std::string& field_name)const;
+
         /**
          * Return the number of records currently stored in the recordset.
          * @return The number of records stored in the recordset.
@@ -611,6 +1044,75 @@ namespace cyclic
          */
         virtual std::unique_ptr<record> get_record(record_index_t index)const =0;
 
+        /**
+         * Aggregate values of a field over a range of records.
+         * Records which are not stored, or have no value for the field, are ignored.
+         * Default implementation retrieves records one by one,
+         * implementations should override it with a faster one.
+         * @param field Index of the field to aggregate.
+         * @param first Index of the first record to aggregate.
+         * @param last Index of the last record to aggregate (inclusive).
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Aggregated values.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first.
+         */
+        virtual aggregate_result aggregate(field_index_t field, record_index_t first, record_index_t last,
+                aggregate_ops ops = AGGREGATE_ALL)const;
+
+        /**
+         * Aggregate values of a field over a range of records, per bucket of records.
+         * Buckets are aligned on multiples of bucket_size (i.e. bucket of record n begins at
+         * n - n % bucket_size), only the first and the last buckets can be partial.
+         * All buckets between the first and the last stored records of the range are returned,
+         * including the ones without any value.
+         * Default implementation aggregates buckets one by one,
+         * implementations should override it with a faster one.
+         * @param field Index of the field to aggregate.
+         * @param first Index of the first record to aggregate.
+         * @param last Index of the last record to aggregate (inclusive).
+         * @param bucket_size Number of records per bucket.
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Aggregated values for each bucket, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first or bucket_size is 0.
+         */
+        virtual std::vector<aggregate_bucket> group_by(field_index_t field, record_index_t first, record_index_t last,
+                record_index_t bucket_size, aggregate_ops ops = AGGREGATE_ALL)const;
+
+        /**
+         * Build quantile sketches of a field over a range of records, per bucket of records.
+         * Buckets are the same as group_by() ones. Sketches of adjacent buckets can be merged
+         * to answer quantiles over larger ranges without scanning records again.
+         * Default implementation retrieves records one by one,
+         * implementations should override it with a faster one.
+         * @param field Index of the field to sketch.
+         * @param first Index of the first record to sketch.
+         * @param last Index of the last record to sketch (inclusive).
+         * @param bucket_size Number of records per bucket.
+         * @param relative_accuracy Maximal relative error of sketch quantile estimations.
+         * @return Sketch of values for each bucket, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first, bucket_size is 0 or accuracy is invalid.
+         * @see quantile_sketch
+         */
+        virtual std::vector<sketch_bucket> sketch_by(field_index_t field, record_index_t first, record_index_t last,
+                record_index_t bucket_size, double relative_accuracy = 0.01)const;
+
+        /**
+         * Find records matching a predicate over a range of records.
+         * Records which are not stored are ignored.
+         * Default implementation retrieves and tests records one by one,
+         * implementations should override it with a faster one.
+         * @param where Predicate records shall match.
+         * @param first Index of the first record to test.
+         * @param last Index of the last record to test (inclusive).
+         * @return Indexes of matching records, in increasing order.
+         * @throw std::out_of_range if the predicate references a field out of held field range.
+         * @throw std::invalid_argument if last is lower than first.
+         */
+        virtual std::vector<record_index_t> filter(const predicate& where, record_index_t first, record_index_t last)const;
+
         /**
          * Returns a const iterator to the first record of the recordset.
          * If the recordset is empty, the returned iterator will be equal to cend().
@@ -735,6 +1237,15 @@ namespace cyclic
     /* abstract */ class table : public recordset
     {
     public:
+        /**
+         * Policy applied when appending asynchronously to a full append queue.
+         */
+        enum append_policy {
+            APPEND_BLOCK = 0,       ///< Block the producer until the queue has room.
+            APPEND_DROP_OLDEST,     ///< Drop the oldest queued record to make room.
+            APPEND_FAIL             ///< Reject the new record.
+        };
+
         /**
          * Return the capacity of table, in number of records.
          * The capacity is the maximum number of records a table can store at the same time.
@@ -757,23 +1268,34 @@ namespace cyclic
          */
         virtual record_time_t record_duration()const =0;
 
+        /**
+         * Test if records carry their own time point.
+         * Records of timestamped tables are stored densely, in time order, at irregular
+         * time points; their duration is 0 and time lookups search the stored records.
+         * @return True if the table is timestamped.
+         */
+        virtual bool timestamped()const =0;
+
         /**
          * Return the record index corresponding to the time point.
-         * The table must support time points (having a record duration != 0).
+         * The table must support time points (having a record duration != 0 or being timestamped).
+         * For timestamped tables, it is the last stored record whose time is not after the time point.
          * @param time Time point to compute.
          * @return The corresponding record index.
          * @throw cyclic::time_not_supported When time is not supported by the table.
-         * @throw std::out_of_range When input time is before the time origin.
+         * @throw std::out_of_range When input time is before the time origin
+         * (or before the first stored record for timestamped tables).
          * @throw std::out_of_range When computed index is out of valid index range.
          */
         virtual record_index_t record_index(record_time_t time)const =0;
 
         /**
          * Return the time of the begining of the specified record.
-         * The table must support time points (having a record duration != 0).
+         * The table must support time points (having a record duration != 0 or being timestamped).
          * @param index Index of record to look for.
          * @return The time point of the begining of the record.
          * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @throw std::out_of_range When the record is not stored in a timestamped table.
          */
         virtual record_time_t record_time(record_index_t index)const =0;
 
@@ -797,6 +1319,380 @@ namespace cyclic
          */
         virtual std::unique_ptr<record> get_record(record_time_t time) const =0;
 
+        /**
+         * Get a lightweight view of the record stored at specified index.
+         * The view points directly to the stored record when possible and decodes
+         * fields only when accessed.
+         * @param index Record index to look for.
+         * @return View of the record, invalid view if no record is stored at this index.
+         */
+        virtual record_view get_record_view(record_index_t index) const =0;
+
+        /**
+         * Get a lightweight view of the record stored at specified time point.
+         * @param time Time point to which look for.
+         * @return View of the record, invalid view if no record is stored at this time.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         */
+        virtual record_view get_record_view(record_time_t time) const =0;
+
+        /**
+         * Get views of the most recent records, newest first.
+         * Records are read backward from the last one, in at most two contiguous
+         * runs of storage (on both sides of the storage wrap), with the table locked once.
+         * Views point directly to the stored records when the storage allows it.
+         * @param n Maximum number of records to view.
+         * @param out Views of the records, from the last record backward. Cleared first.
+         * @return Number of views, lower than n if fewer records are stored.
+         */
+        virtual record_index_t latest(record_index_t n, std::vector<record_view>& out) const =0;
+
+        /**
+         * Retrieve the binary encoding of the records of the table.
+         * @return Layout of encoded records, valid as long as the table is alive.
+         */
+        virtual const record_layout& layout() const =0;
+
+        /**
+         * Get a random-access range over the records currently stored in the table.
+         * Records appended after the call are not part of the range.
+         * @return Range of records from min_index() to max_index().
+         */
+        record_range records() const;
+
+        /**
+         * Get a random-access range over a part of the records stored in the table.
+         * The range is clipped to the stored records.
+         * @param first Index of the first record of the range.
+         * @param last Index of the last record of the range (inclusive).
+         * @return Range of records, empty if no stored record is in [first;last].
+         */
+        record_range records(record_index_t first, record_index_t last) const;
+
+        using recordset::aggregate;
+
+        /**
+         * Aggregate values of a field over a time range.
+         * The table must support time points (having a record duration != 0).
+         * @param field Index of the field to aggregate.
+         * @param start Time of the first record to aggregate.
+         * @param end Time of the last record to aggregate (inclusive).
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Aggregated values.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         */
+        aggregate_result aggregate(field_index_t field, record_time_t start, record_time_t end,
+                aggregate_ops ops = AGGREGATE_ALL)const;
+
+        using recordset::group_by;
+
+        /**
+         * Aggregate values of a field over a time range, per time interval.
+         * The table must support time points (having a record duration != 0).
+         * Buckets are aligned on multiples of the interval since the table origin.
+         * @param field Index of the field to aggregate.
+         * @param start Time of the first record to aggregate.
+         * @param end Time of the last record to aggregate (inclusive).
+         * @param interval Duration of buckets, shall be a multiple of the record duration.
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Aggregated values for each bucket, in time order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start or interval is not a positive multiple of the record duration.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see recordset::group_by
+         */
+        std::vector<aggregate_bucket> group_by(field_index_t field, record_time_t start, record_time_t end,
+                record_time_t interval, aggregate_ops ops = AGGREGATE_ALL)const;
+
+        using recordset::sketch_by;
+
+        /**
+         * Build quantile sketches of a field over a time range, per time interval.
+         * The table must support time points (having a record duration != 0).
+         * Buckets are aligned on multiples of the interval since the table origin.
+         * @param field Index of the field to sketch.
+         * @param start Time of the first record to sketch.
+         * @param end Time of the last record to sketch (inclusive).
+         * @param interval Duration of buckets, shall be a multiple of the record duration.
+         * @param relative_accuracy Maximal relative error of sketch quantile estimations.
+         * @return Sketch of values for each bucket, in time order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start or interval is not a positive multiple of the record duration.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see recordset::sketch_by
+         */
+        std::vector<sketch_bucket> sketch_by(field_index_t field, record_time_t start, record_time_t end,
+                record_time_t interval, double relative_accuracy = 0.01)const;
+
+        /**
+         * Find the records holding the largest (or smallest) values of a field over a range of records.
+         * Values are kept in a bounded heap, decoded chunks whose extremum cannot enter it are skipped.
+         * Records without value for the field are ignored.
+         * @param field Index of the field to rank.
+         * @param first Index of the first record to rank.
+         * @param last Index of the last record to rank (inclusive).
+         * @param k Maximal number of values to retrieve.
+         * @param largest True for the largest values, false for the smallest ones.
+         * @return Up to k values, best first, in index order for equal values.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first.
+         */
+        std::vector<ranked_value> top_k(field_index_t field, record_index_t first, record_index_t last,
+                size_t k, bool largest = true)const;
+
+        /**
+         * Find the records holding the largest (or smallest) values of a field over a time range.
+         * @param field Index of the field to rank.
+         * @param start Time of the first record to rank.
+         * @param end Time of the last record to rank (inclusive).
+         * @param k Maximal number of values to retrieve.
+         * @param largest True for the largest values, false for the smallest ones.
+         * @return Up to k values, best first, in index order for equal values.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see top_k(field_index_t, record_index_t, record_index_t, size_t, bool)
+         */
+        std::vector<ranked_value> top_k(field_index_t field, record_time_t start, record_time_t end,
+                size_t k, bool largest = true)const;
+
+        /**
+         * Find where values of a field cross a threshold over a range of records.
+         * A value crosses the threshold when it is not on the same side as the previous value
+         * of the range (values above the threshold on one side, other ones on the other side).
+         * Records without value for the field are ignored. Decoded chunks whose values all stay
+         * on the current side, as told by their minimum and maximum, are skipped.
+         * @param field Index of the field to check.
+         * @param first Index of the first record to check.
+         * @param last Index of the last record to check (inclusive).
+         * @param threshold Threshold value.
+         * @return Crossings, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first.
+         */
+        std::vector<threshold_crossing> crossings(field_index_t field, record_index_t first, record_index_t last,
+                double threshold)const;
+
+        /**
+         * Find where values of a field cross a threshold over a time range.
+         * @param field Index of the field to check.
+         * @param start Time of the first record to check.
+         * @param end Time of the last record to check (inclusive).
+         * @param threshold Threshold value.
+         * @return Crossings, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see crossings(field_index_t, record_index_t, record_index_t, double)
+         */
+        std::vector<threshold_crossing> crossings(field_index_t field, record_time_t start, record_time_t end,
+                double threshold)const;
+
+        /**
+         * Compute the increase of a counter field over a range of records.
+         * The field must be of an unsigned integer type, its width being the counter one.
+         * Increases are computed between consecutive values of the range, handling counter
+         * wraps and resets (see counter_deltas()), and are timed with the record duration:
+         * values n records apart are n record durations apart. Elapsed time, and then rate,
+         * is null for tables without record duration.
+         * Records without value for the field are ignored.
+         * @param field Index of the counter field.
+         * @param first Index of the first record.
+         * @param last Index of the last record (inclusive).
+         * @return Increase of the counter.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first or the field is not an unsigned integer.
+         */
+        counter_result counter(field_index_t field, record_index_t first, record_index_t last)const;
+
+        /**
+         * Compute the increase of a counter field over a time range.
+         * @param field Index of the counter field.
+         * @param start Time of the first record.
+         * @param end Time of the last record (inclusive).
+         * @return Increase of the counter.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start or the field is not an unsigned integer.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see counter(field_index_t, record_index_t, record_index_t)
+         */
+        counter_result counter(field_index_t field, record_time_t start, record_time_t end)const;
+
+        /**
+         * Compute the increase of a counter field over a range of records, per bucket of records.
+         * Buckets are the same as recordset::group_by() ones. The increase from a value to the
+         * following one is attributed to the bucket of the latter, so increases of adjacent
+         * buckets add up to the increase over them.
+         * @param field Index of the counter field.
+         * @param first Index of the first record.
+         * @param last Index of the last record (inclusive).
+         * @param bucket_size Number of records per bucket.
+         * @return Increase of the counter for each bucket, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first, bucket_size is 0
+         * or the field is not an unsigned integer.
+         * @see counter(field_index_t, record_index_t, record_index_t)
+         */
+        std::vector<counter_bucket> counter_by(field_index_t field, record_index_t first, record_index_t last,
+                record_index_t bucket_size)const;
+
+        /**
+         * Compute the increase of a counter field over a time range, per time interval.
+         * @param field Index of the counter field.
+         * @param start Time of the first record.
+         * @param end Time of the last record (inclusive).
+         * @param interval Duration of buckets, shall be a multiple of the record duration.
+         * @return Increase of the counter for each bucket, in index order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start, interval is not a positive
+         * multiple of the record duration or the field is not an unsigned integer.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see counter_by(field_index_t, record_index_t, record_index_t, record_index_t)
+         */
+        std::vector<counter_bucket> counter_by(field_index_t field, record_time_t start, record_time_t end,
+                record_time_t interval)const;
+
+        /**
+         * Compute the derivative of a counter field over a range of records.
+         * The table must have a record duration. Each value is the increase from the previous
+         * value of the range, divided by the time between them, so it is the instant rate of the
+         * counter. The first value of the range and records without value have null derivatives.
+         * @param field Index of the counter field.
+         * @param first Index of the first record.
+         * @param last Index of the last record (inclusive).
+         * @param fn Function called with each chunk of derivatives, one per record, in time order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first or the field is not an unsigned integer.
+         * @throw cyclic::time_not_supported When the table has no record duration.
+         * @see counter(field_index_t, record_index_t, record_index_t)
+         */
+        void derivative(field_index_t field, record_index_t first, record_index_t last,
+                const std::function<void(const column_chunk&)>& fn)const;
+
+        /**
+         * Compute the derivative of a counter field over a time range.
+         * @param field Index of the counter field.
+         * @param start Time of the first record.
+         * @param end Time of the last record (inclusive).
+         * @param fn Function called with each chunk of derivatives, one per record, in time order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start or the field is not an unsigned integer.
+         * @throw cyclic::time_not_supported When the table has no record duration.
+         * @see derivative(field_index_t, record_index_t, record_index_t, const std::function<void(const column_chunk&)>&)
+         */
+        void derivative(field_index_t field, record_time_t start, record_time_t end,
+                const std::function<void(const column_chunk&)>& fn)const;
+
+        /**
+         * Resample values of a field at regular time points.
+         * The table must support time points (having a record duration != 0 or being timestamped).
+         * The field is read by chunks of decoded values streamed through a resampler, with
+         * the record duration as sample duration. Resampled chunks are passed on as soon as
+         * they are computed, so they can be chained with aggregations without materializing records.
+         * Chunks hold at most resampler::default_chunk_size points, whatever the resampled range.
+         * @param field Index of the field to resample.
+         * @param start Time of the first resampled point.
+         * @param end Upper bound of resampled points (inclusive).
+         * @param duration Time between resampled points.
+         * @param method Method computing resampled values.
+         * @param fn Function called with each chunk of resampled values, in time order.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if end is lower than start or duration is not positive.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see resampler
+         */
+        void resample(field_index_t field, record_time_t start, record_time_t end, record_time_t duration,
+                resample_method method, const std::function<void(const column_chunk&)>& fn)const;
+
+        /**
+         * Type of continuous aggregate identifier.
+         */
+        typedef size_t continuous_aggregate_t;
+
+        /**
+         * Register a continuous aggregate of a field over the last records.
+         * The aggregate is maintained incrementally when records are appended, set or updated:
+         * values of records leaving the window, or evicted from the table, are subtracted.
+         * Its current value is then available in constant time with continuous_aggregate().
+         * @param field Index of the field to aggregate.
+         * @param window Number of last records to aggregate, limited to the table capacity.
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Continuous aggregate identifier.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if the window is 0.
+         */
+        virtual continuous_aggregate_t add_continuous_aggregate(field_index_t field, record_index_t window,
+                aggregate_ops ops = AGGREGATE_ALL) =0;
+
+        /**
+         * Register a continuous aggregate of a field over the last records of a time window.
+         * The table must support time points (having a record duration != 0).
+         * @param field Index of the field to aggregate.
+         * @param window Duration of the window, shall be a multiple of the record duration.
+         * @param ops Requested operations, other ones may not be computed.
+         * @return Continuous aggregate identifier.
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if window is not a positive multiple of the record duration.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         */
+        continuous_aggregate_t add_continuous_aggregate(field_index_t field, record_time_t window,
+                aggregate_ops ops = AGGREGATE_ALL);
+
+        /**
+         * Retrieve the current value of a continuous aggregate.
+         * @param id Continuous aggregate identifier.
+         * @return Aggregated values of the window ending at the last record.
+         * @throw std::invalid_argument if the continuous aggregate is unknown.
+         */
+        virtual aggregate_result continuous_aggregate(continuous_aggregate_t id) const =0;
+
+        /**
+         * Unregister a continuous aggregate.
+         * Do nothing if the continuous aggregate is unknown.
+         * @param id Continuous aggregate identifier.
+         */
+        virtual void remove_continuous_aggregate(continuous_aggregate_t id) =0;
+
+        /**
+         * Read values of a field for a range of records into a caller-provided array.
+         * Values are converted to the requested type directly from storage.
+         * Records which are not stored, or have no value for the field, are
+         * filled with 0 and their bit is cleared in the validity bitmap.
+         * @param field Index of the field to read.
+         * @param first Index of the first record to read.
+         * @param last Index of the last record to read (inclusive).
+         * @param type Type of values to write, shall not be void nor unspecified.
+         * @param out Array of (last - first + 1) values of requested type.
+         * @param null_bitmap Optional validity bitmap of ((last - first) / 8 + 1) bytes,
+         * bit (i % 8) of byte (i / 8) is set if the record (first + i) has a value. Can be nullptr.
+         * @return Number of values read (i.e. not null).
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first or the type is not supported.
+         */
+        virtual record_index_t read_column(field_index_t field, record_index_t first, record_index_t last,
+                data_type type, void* out, uint8_t* null_bitmap = nullptr) const =0;
+
+        /**
+         * Read values of a field for a range of records into a caller-provided array.
+         * @tparam T Type of values to write.
+         * @param field Index of the field to read.
+         * @param first Index of the first record to read.
+         * @param last Index of the last record to read (inclusive).
+         * @param out Array of (last - first + 1) values.
+         * @param null_bitmap Optional validity bitmap of ((last - first) / 8 + 1) bytes. Can be nullptr.
+         * @return Number of values read (i.e. not null).
+         * @throw std::out_of_range if the field index is out of held field range.
+         * @throw std::invalid_argument if last is lower than first.
+         * @see read_column(field_index_t, record_index_t, record_index_t, data_type, void*, uint8_t*)
+         */
+        template<typename T> record_index_t read_column(field_index_t field, record_index_t first, record_index_t last,
+                T* out, uint8_t* null_bitmap = nullptr) const
+        {
+            return read_column(field, first, last, data_type_of<T>::value, (void*) out, null_bitmap);
+        }
+
         /**
          * Set record values at record index.
          * The record index must be valid.
@@ -875,6 +1771,108 @@ namespace cyclic
          */
         virtual void update_record(record_time_t time, const record& rec) =0;
 
+        /**
+         * Set the value of a field of an existing record.
+         * Only the field value and its null flag are written, other fields of the record
+         * are neither read nor rewritten.
+         * @param index Index of record to update. Must be valid.
+         * @param field Index of the field to set.
+         * @param value Value to set, converted to the field type. A null value resets the field.
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error update a record in an empty table.
+         * @throw std::out_of_range update a record at an index out of current table range,
+         * or field index out of held field range.
+         * @throw std::range_error internal index computation error.
+         */
+        virtual void set_field(record_index_t index, field_index_t field, const value_t& value) =0;
+
+        /**
+         * Set the value of a field of an existing record.
+         * @param time Time point of the record to update. Must be valid.
+         * @param field Index of the field to set.
+         * @param value Value to set, converted to the field type. A null value resets the field.
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error update a record in an empty table.
+         * @throw std::out_of_range update a record at an index out of current table range,
+         * or field index out of held field range.
+         * @throw std::range_error internal index computation error.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see set_field(record_index_t, field_index_t, const value_t&)
+         */
+        virtual void set_field(record_time_t time, field_index_t field, const value_t& value) =0;
+
+        /**
+         * Reset a field of an existing record to null.
+         * Only the field value and its null flag are written.
+         * @param index Index of record to update. Must be valid.
+         * @param field Index of the field to reset.
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error update a record in an empty table.
+         * @throw std::out_of_range update a record at an index out of current table range,
+         * or field index out of held field range.
+         * @throw std::range_error internal index computation error.
+         */
+        virtual void reset_field(record_index_t index, field_index_t field) =0;
+
+        /**
+         * Reset a field of an existing record to null.
+         * @param time Time point of the record to update. Must be valid.
+         * @param field Index of the field to reset.
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error update a record in an empty table.
+         * @throw std::out_of_range update a record at an index out of current table range,
+         * or field index out of held field range.
+         * @throw std::range_error internal index computation error.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see reset_field(record_index_t, field_index_t)
+         */
+        virtual void reset_field(record_time_t time, field_index_t field) =0;
+
+        /**
+         * Accumulate a value in a field of a record.
+         * The record is appended (empty) if it follows the last one.
+         * Accumulated records are combined in a cache, only written to storage when another
+         * record is accumulated, when the flush interval is elapsed (by a background thread),
+         * before any other modification of the table, or on flush(). Until then, readers
+         * see the record as it was before its accumulations.
+         * Values are converted to the field type before being accumulated.
+         * @param index Index of record in which accumulate. Must be valid.
+         * @param field Index of the field in which accumulate.
+         * @param op Accumulation operation.
+         * @param value Value to accumulate, ignored if null (except for ACCUMULATE_COUNT).
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error accumulate in a timestamped table.
+         * @throw std::out_of_range accumulate in a record before the first one, or field index
+         * out of held field range.
+         * @throw cyclic::table_is_full no more record can be appended.
+         */
+        virtual void accumulate(record_index_t index, field_index_t field, accumulate_op op,
+                const value_t& value = value_t{}) =0;
+
+        /**
+         * Accumulate a value in a field of the record covering a time point.
+         * @param time Time point of the record in which accumulate. Must be valid.
+         * @param field Index of the field in which accumulate.
+         * @param op Accumulation operation.
+         * @param value Value to accumulate, ignored if null (except for ACCUMULATE_COUNT).
+         * @throw std::invalid_argument index is invalid.
+         * @throw std::logic_error accumulate in a timestamped table.
+         * @throw std::out_of_range accumulate in a record before the first one, or field index
+         * out of held field range.
+         * @throw cyclic::table_is_full no more record can be appended.
+         * @throw cyclic::time_not_supported When time is not supported by the table.
+         * @see accumulate(record_index_t, field_index_t, accumulate_op, const value_t&)
+         */
+        virtual void accumulate(record_time_t time, field_index_t field, accumulate_op op,
+                const value_t& value = value_t{}) =0;
+
+        /**
+         * Configure the maximal time accumulations are kept in cache.
+         * @param interval Time after which accumulated records are flushed,
+         * 0 to write each accumulation immediately.
+         */
+        virtual void configure_accumulate(std::chrono::milliseconds interval) =0;
+
         /**
          * Append an empty record at the index just following the highest record.
          * The table must not be full (max_index() == record_index_max).
@@ -951,6 +1949,16 @@ namespace cyclic
          */
         virtual void append_record(record_time_t time, const record& rec) =0;
 
+        /**
+         * Append a record given in its encoded form at the specified index.
+         * The encoded record is stored as is, without decoding nor value conversion.
+         * @param data Encoded record, following the table layout (see layout()).
+         * @param index Index of record to append, invalid_index() to append after the last record.
+         * @throw std::out_of_range Append a record before end of table.
+         * @throw cyclic::table_is_full Table is full, no more record can be append.
+         */
+        virtual void append_encoded(const uint8_t* data, record_index_t index = record::invalid_index()) =0;
+
         /**
          * Insert an empty record (set or append) to the specified index.
          * The index must be in the range [min_index;record_index_max].
@@ -1000,7 +2008,244 @@ namespace cyclic
          * @throw cyclic::time_not_supported When time is not supported by the table.
          */
         virtual void insert_record(record_time_t time, const record& rec) =0;
+
+        /**
+         * Append a record asynchronously.
+         * The record is copied into a bounded queue and returns immediately.
+         * A flusher thread dedicated to the table drains the queue and appends
+         * queued records by batches, updating the table index only once per batch.
+         * Append rules are the same than append_record(const record&):
+         * if the record index is invalid, it is appended just after the last record.
+         * @param rec Record to append.
+         * The time of the record is ignored.
+         * @return Future resolved with the index of the appended record when written,
+         * or with the exception raised while appending it.
+         * A record dropped by APPEND_DROP_OLDEST policy resolves with cyclic::queue_is_full.
+         * @throw cyclic::queue_is_full The queue is full and the policy is APPEND_FAIL.
+         */
+        virtual std::future<record_index_t> append_async(const record& rec) =0;
+
+        /**
+         * Configure the asynchronous append queue.
+         * @param capacity Maximum number of queued records, shall not be 0.
+         * @param policy Policy to apply when the queue is full.
+         * @throw std::invalid_argument Queue capacity of 0.
+         */
+        virtual void configure_append_queue(size_t capacity, append_policy policy = APPEND_BLOCK) =0;
+
+        /**
+         * Wait for all asynchronously appended records to be written,
+         * and write accumulated records.
+         */
+        virtual void flush() =0;
+
+        /**
+         * Type of subscription identifier.
+         */
+        typedef size_t subscription_t;
+
+        /**
+         * Type of subscription callback.
+         * Called with the (inclusive) range of indexes of newly appended records.
+         */
+        typedef std::function<void(record_index_t first, record_index_t last)> subscription_callback_t;
+
+        /**
+         * Subscribe to newly appended records.
+         * The callback is called, from the appending thread and with the table locked,
+         * each time appending or inserting records advance max_index().
+         * It is immediately called with already stored records if from_index is not upper than max_index().
+         * It shall be short and shall not append records to the table.
+         * @param callback Callback to call.
+         * @param from_index Index of the first record to be notified for,
+         * invalid_index() to be notified only for records appended from now.
+         * @return Subscription identifier, to use to unsubscribe.
+         */
+        virtual subscription_t subscribe(subscription_callback_t callback, record_index_t from_index = record::invalid_index()) =0;
+
+        /**
+         * Cancel a subscription.
+         * Do nothing if the subscription is unknown.
+         * @param subscription Subscription identifier.
+         */
+        virtual void unsubscribe(subscription_t subscription) =0;
+
+        /**
+         * Wait for a record to be appended.
+         * Return immediately if max_index() is already not lower than the index.
+         * @param index Index of the record to wait for.
+         * @param timeout Maximum duration to wait.
+         * @return True if the record has been appended, false on timeout.
+         */
+        virtual bool wait_for_index(record_index_t index, std::chrono::milliseconds timeout) =0;
+
+        /**
+         * Refresh the table view from its storage.
+         * Only relevant for tables whose storage can be modified by another
+         * process (typically a file table opened while another process writes it).
+         * Cheap when nothing changed. Subscribers are notified if new records are found.
+         * @return True if the table has been modified since last refresh.
+         */
+        virtual bool refresh() =0;
+    };
+
+    /**
+     * Random-access iterator over the records of a table.
+     * It is a plain value (a table and a record index): copying, comparing and
+     * moving it never allocate nor lock, and it dereferences to record views
+     * pointing directly to the stored records when the storage allows it.
+     * Missing records are seen as invalid views.
+     * It is invalidated when the pointed records are evicted from the table.
+     */
+    class table_iterator
+    {
+    public:
+        /** Iterator category. */
+        typedef std::random_access_iterator_tag iterator_category;
+        /** Type of value pointed by iterator. */
+        typedef record_view value_type;
+        /** Type of distance between iterators. */
+        typedef std::ptrdiff_t difference_type;
+        /** Type of reference to value pointed by iterator, views are returned by value. */
+        typedef record_view reference;
+        /** Type of this. */
+        typedef table_iterator self;
+
+        /**
+         * Proxy returned by operator->(), holding the pointed view.
+         */
+        class pointer
+        {
+            record_view _view;
+        public:
+            pointer(record_view view):_view(std::move(view)){}
+            const record_view* operator->()const{return &_view;}
+        };
+
+        /** Singular iterator. */
+        table_iterator() = default;
+
+        /**
+         * Iterator pointing to a record of a table.
+         * @param tbl Table to iterate on, shall outlive the iterator.
+         * @param index Index of the pointed record, may be one past the last record.
+         */
+        table_iterator(const table* tbl, difference_type index):_table(tbl),_index(index){}
+
+        /**
+         * Retrieve the index of the pointed record.
+         * @return Index of the pointed record.
+         */
+        record_index_t index()const{return static_cast<record_index_t>(_index);}
+
+        /**
+         * Dereference the iterator.
+         * @return View of the pointed record, invalid view if the record is not stored.
+         */
+        reference operator*()const{return _table->get_record_view(index());}
+        /**
+         * Dereference the iterator.
+         * @return Proxy to the view of the pointed record.
+         */
+        pointer operator->()const{return pointer{**this};}
+        /**
+         * Dereference the iterator at an offset.
+         * @param n Offset of the record to view.
+         * @return View of the record.
+         */
+        reference operator[](difference_type n)const{return *(*this + n);}
+
+        self& operator++(){++_index; return *this;}
+        self operator++(int){self it{*this}; ++_index; return it;}
+        self& operator--(){--_index; return *this;}
+        self operator--(int){self it{*this}; --_index; return it;}
+        self& operator+=(difference_type n){_index += n; return *this;}
+        self& operator-=(difference_type n){_index -= n; return *this;}
+        self operator+(difference_type n)const{return self{_table, _index + n};}
+        self operator-(difference_type n)const{return self{_table, _index - n};}
+        friend self operator+(difference_type n, const self& it){return it + n;}
+        difference_type operator-(const self& other)const{return _index - other._index;}
+
+        bool operator==(const self& other)const{return _index == other._index && _table == other._table;}
+        bool operator!=(const self& other)const{return !(*this == other);}
+        bool operator<(const self& other)const{return _index < other._index;}
+        bool operator>(const self& other)const{return _index > other._index;}
+        bool operator<=(const self& other)const{return _index <= other._index;}
+        bool operator>=(const self& other)const{return _index >= other._index;}
+
+    protected:
+        /** Iterated table. */
+        const table* _table = nullptr;
+        /** Pointed index, signed and wide enough to go one past any valid index. */
+        difference_type _index = 0;
     };
 
+    /**
+     * Random-access range of records of a table, as returned by table::records().
+     * Usable with range-based for loops and standard algorithms.
+     */
+    class record_range
+    {
+    public:
+        typedef table_iterator iterator;
+        typedef table_iterator const_iterator;
+        typedef std::reverse_iterator<table_iterator> reverse_iterator;
+        typedef std::reverse_iterator<table_iterator> const_reverse_iterator;
+        typedef table_iterator::difference_type difference_type;
+
+        /** Empty range. */
+        record_range() = default;
+
+        /**
+         * Range of records of a table.
+         * @param tbl Table to iterate on, shall outlive the range.
+         * @param first Index of the first record.
+         * @param end Index following the last record.
+         */
+        record_range(const table* tbl, difference_type first, difference_type end):
+            _table(tbl), _first(first), _end(end < first ? first : end) {}
+
+        iterator begin()const{return iterator{_table, _first};}
+        iterator end()const{return iterator{_table, _end};}
+        reverse_iterator rbegin()const{return reverse_iterator{end()};}
+        reverse_iterator rend()const{return reverse_iterator{begin()};}
+
+        /**
+         * Retrieve the number of records in the range.
+         * @return Number of records.
+         */
+        size_t size()const{return static_cast<size_t>(_end - _first);}
+        /**
+         * Test if the range is empty.
+         * @return True if the range has no record.
+         */
+        bool empty()const{return _end == _first;}
+        /**
+         * View a record of the range.
+         * @param n Position of the record in the range.
+         * @return View of the record.
+         */
+        record_view operator[](size_t n)const{return begin()[static_cast<difference_type>(n)];}
+
+    protected:
+        const table* _table = nullptr;
+        difference_type _first = 0;
+        difference_type _end = 0;
+    };
+
+    inline record_range table::records() const
+    {
+        return record_count() == 0 ? record_range{} : record_range{this, static_cast<record_range::difference_type>(min_index()), static_cast<record_range::difference_type>(max_index()) + 1};
+    }
+
+    inline record_range table::records(record_index_t first, record_index_t last) const
+    {
+        if(record_count() == 0 || last < min_index() || first > max_index() || first > last)
+        {
+            return record_range{};
+        }
+        return record_range{this, static_cast<record_range::difference_type>(std::max(first, min_index())), static_cast<record_range::difference_type>(std::min(last, max_index())) + 1};
+    }
+
 } // namespace cyclic
 #endif // _CYCLIC_COMMON_BASE_HPP_
\ No newline at end of file
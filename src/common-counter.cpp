@@ -0,0 +1,84 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-counter.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-counter.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+namespace cyclic
+{
+
+//
+// counter_result
+//
+
+void counter_result::merge(const counter_result& other)
+{
+    count += other.count;
+    resets += other.resets;
+    increase += other.increase;
+    elapsed += other.elapsed;
+}
+
+double counter_result::rate()const
+{
+    return elapsed > 0 ? (double) increase / (double) elapsed : std::nan("");
+}
+
+//
+// Counter kernel
+//
+
+uint64_t counter_deltas(const uint64_t* values, size_t count, uint64_t previous, unsigned width,
+        uint64_t* deltas, uint8_t* resets)
+{
+    if(width == 0 || width > 64)
+    {
+        throw std::invalid_argument{"Counter width must be between 1 and 64 bits."};
+    }
+    const uint64_t mask = width == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << width) - 1;
+    const uint64_t half = mask / 2;
+
+    if(count == 0)
+    {
+        return 0;
+    }
+    // First sample is compared to the previous one, others to their predecessor in the buffer.
+    uint64_t diff = (values[0] - previous) & mask;
+    uint8_t reset = values[0] < previous && diff > half;
+    deltas[0] = reset ? values[0] : diff;
+    resets[0] = reset;
+    uint64_t total = reset;
+    for(size_t n = 1; n < count; ++n)
+    {
+        uint64_t cur = values[n];
+        uint64_t prev = values[n - 1];
+        uint64_t d = (cur - prev) & mask;
+        // All ones when the counter has been reset, all zeros otherwise.
+        uint64_t r = (uint64_t) 0 - (uint64_t) ((cur < prev) & (d > half));
+        deltas[n] = (cur & r) | (d & ~r);
+        resets[n] = (uint8_t) (r & 1);
+        total += r & 1;
+    }
+    return total;
+}
+
+} // namespace cyclic
@@ -0,0 +1,77 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-counter.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CYCLIC_COMMON_COUNTER_HPP_
+#define _CYCLIC_COMMON_COUNTER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cyclic
+{
+    /**
+     * Increase of a monotonically increasing counter over a series of samples.
+     * Increases are computed between consecutive samples, handling counter wraps and resets.
+     * Results of adjacent series can be merged, increases between them being attributed
+     * to the later one.
+     */
+    struct counter_result
+    {
+        /** Number of samples. */
+        uint64_t count = 0;
+        /** Number of detected counter resets. */
+        uint64_t resets = 0;
+        /** Sum of increases between consecutive samples. */
+        uint64_t increase = 0;
+        /** Time covered by these increases. */
+        int64_t elapsed = 0;
+
+        /**
+         * Aggregate increases of an adjacent following series.
+         * @param other Other counter result.
+         */
+        void merge(const counter_result& other);
+
+        /**
+         * Average increase per time unit.
+         * @return Increase divided by elapsed time, NaN if no time elapsed.
+         */
+        double rate()const;
+    };
+
+    /**
+     * Compute increases of a counter between consecutive samples.
+     * A sample lower than its previous one is a wrap if the implied increase,
+     * modulo the counter range, is lower than half of this range. Otherwise the
+     * counter has been reset and the increase is the sample value itself.
+     * The computation is branch-free, so it is vectorized by the compiler.
+     * @param values Samples, in time order.
+     * @param count Number of samples.
+     * @param previous Sample preceding the first one.
+     * @param width Width of the counter in bits, from 1 to 64.
+     * @param deltas Increases from the previous sample to each sample.
+     * @param resets Set to 1 where a reset is detected, 0 otherwise.
+     * @return Number of detected resets.
+     * @throw std::invalid_argument if width is not between 1 and 64.
+     */
+    uint64_t counter_deltas(const uint64_t* values, size_t count, uint64_t previous, unsigned width,
+            uint64_t* deltas, uint8_t* resets);
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_COUNTER_HPP_
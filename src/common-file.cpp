@@ -20,8 +20,10 @@
 
 #include "common-file.hpp"
 
+#include <algorithm>
 #include <iostream>
 
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -31,11 +33,70 @@
 #include <sstream>
 #include <vector>
 
+// Open file description locks are used when available, unless process locks
+// are requested (defining CYCLIC_PROCESS_LOCKS), to exercise them where both exist.
+#if defined(F_OFD_SETLK) && !defined(CYCLIC_PROCESS_LOCKS)
+#define CYCLIC_OFD_LOCKS
+#endif
+
+#ifndef CYCLIC_OFD_LOCKS
+#include <map>
+#include <mutex>
+#endif
+
 namespace cyclic
 {
 namespace io
 {
 
+#ifndef CYCLIC_OFD_LOCKS
+//
+// Process lock registry
+//
+
+namespace
+{
+/** Try-lock taken by this process on a file byte range. */
+struct process_lock
+{
+    int fd;
+    size_t offset;
+    size_t size;
+    bool exclusive;
+};
+
+/** Identity of a file, whatever the descriptor used to access it. */
+typedef std::pair<dev_t, ino_t> file_key;
+
+/**
+ * Try-locks held by this process, by file.
+ * Process-associated locks never conflict within a process, so two descriptors
+ * of the same file would both get them: they are checked here instead.
+ */
+std::map<file_key, std::vector<process_lock>> process_locks;
+std::mutex process_locks_mutex;
+
+file_key key_of(int fd)
+{
+    struct stat st;
+    if(::fstat(fd, &st) == -1)
+    {
+        throw io_exception(errno);
+    }
+    return file_key{st.st_dev, st.st_ino};
+}
+
+/**
+ * Test if two byte ranges overlap, a size of 0 extending to the end of file.
+ */
+bool overlap(size_t offset1, size_t size1, size_t offset2, size_t size2)
+{
+    return (size2 == 0 || offset1 < offset2 + size2) && (size1 == 0 || offset2 < offset1 + size1);
+}
+} // namespace
+#endif
+
+
 //
 // file
 //
@@ -53,14 +114,22 @@ _fd(file._fd)
 
 file& file::operator=(const file& file)
 {
-    _fd = ::dup(file._fd);
+    if(this != &file)
+    {
+        close();
+        _fd = ::dup(file._fd);
+    }
     return *this;
 }
 
 file& file::operator=(file&& file)
 {
-    _fd = file._fd;
-    file._fd = -1;
+    if(this != &file)
+    {
+        close();
+        _fd = file._fd;
+        file._fd = -1;
+    }
     return *this;
 }
 
@@ -69,9 +138,9 @@ file::~file() /* throw (io_exception) */
     close();
 }
 
-void file::open(const std::string& path)/*throw (io_exception)*/
+void file::open(const std::string& path, bool read_only)/*throw (io_exception)*/
 {
-    int fd = ::open(path.c_str(), O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP);
+    int fd = ::open(path.c_str(), read_only ? O_RDONLY : O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP);
     if(fd != -1)
     {
         _fd = fd;
@@ -84,7 +153,8 @@ void file::open(const std::string& path)/*throw (io_exception)*/
 
 void file::create(const std::string& path)/*throw (io_exception)*/
 {
-    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP);
+    // Not truncated here, the file may be in use: see truncate().
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP);
     if(fd != -1)
     {
         _fd = fd;
@@ -203,6 +273,15 @@ file& file::seek(size_t offset) /*throw (io_exception)*/
     return *this;
 }
 
+file& file::truncate(size_t size) /*throw (io_exception)*/
+{
+    if(::ftruncate(_fd, (off_t) size) == -1)
+    {
+        throw io_exception(errno);
+    }
+    return *this;
+}
+
 file& file::sync() /*throw (io_exception)*/
 {
     int res = ::fsync(_fd);
@@ -213,10 +292,116 @@ file& file::sync() /*throw (io_exception)*/
     return *this;
 }
 
+bool file::lock(size_t offset, size_t size, bool exclusive, bool wait) /*throw (io_exception)*/
+{
+    struct flock fl;
+    ::memset(&fl, 0, sizeof(fl));
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = (off_t) offset;
+    fl.l_len = (off_t) size;
+#ifdef CYCLIC_OFD_LOCKS
+    // Open file description locks: not released when closing a dup'ed descriptor.
+    int cmd = wait ? F_OFD_SETLKW : F_OFD_SETLK;
+#else
+    int cmd = wait ? F_SETLKW : F_SETLK;
+    std::unique_lock<std::mutex> registry_lock{process_locks_mutex, std::defer_lock};
+    file_key key;
+    if(!wait)
+    {
+        // Try-locks are checked against the ones held through other descriptors of this process.
+        registry_lock.lock();
+        key = key_of(_fd);
+        auto it = process_locks.find(key);
+        if(it != process_locks.end())
+        {
+            for(const process_lock& held : it->second)
+            {
+                if(held.fd != _fd && (exclusive || held.exclusive) && overlap(offset, size, held.offset, held.size))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+#endif
+    while(::fcntl(_fd, cmd, &fl) == -1)
+    {
+        if(errno == EINTR && wait)
+        {
+            continue;
+        }
+        if(!wait && (errno == EACCES || errno == EAGAIN))
+        {
+            return false;
+        }
+        throw io_exception(errno);
+    }
+#ifndef CYCLIC_OFD_LOCKS
+    if(!wait)
+    {
+        process_locks[key].push_back(process_lock{_fd, offset, size, exclusive});
+    }
+#endif
+    return true;
+}
+
+#ifndef CYCLIC_OFD_LOCKS
+/**
+ * Forget try-locks held through a descriptor.
+ * @param fd Descriptor.
+ * @param all True to forget all its locks, false for the one of the range only.
+ * @param offset Offset of the range.
+ * @param size Size of the range.
+ */
+static void release_process_locks(int fd, bool all, size_t offset = 0, size_t size = 0)
+{
+    std::lock_guard<std::mutex> lock{process_locks_mutex};
+    auto it = process_locks.find(key_of(fd));
+    if(it == process_locks.end())
+    {
+        return;
+    }
+    std::vector<process_lock>& locks = it->second;
+    locks.erase(std::remove_if(locks.begin(), locks.end(), [&](const process_lock& held)
+            {
+                return held.fd == fd && (all || (held.offset == offset && held.size == size));
+            }), locks.end());
+    if(locks.empty())
+    {
+        process_locks.erase(it);
+    }
+}
+#endif
+
+file& file::unlock(size_t offset, size_t size) /*throw (io_exception)*/
+{
+    struct flock fl;
+    ::memset(&fl, 0, sizeof(fl));
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = (off_t) offset;
+    fl.l_len = (off_t) size;
+#ifdef CYCLIC_OFD_LOCKS
+    int res = ::fcntl(_fd, F_OFD_SETLK, &fl);
+#else
+    release_process_locks(_fd, false, offset, size);
+    int res = ::fcntl(_fd, F_SETLK, &fl);
+#endif
+    if(res == -1)
+    {
+        throw io_exception(errno);
+    }
+    return *this;
+}
+
 void file::close() /*throw (io_exception)*/
 {
     if(_fd != -1)
     {
+#ifndef CYCLIC_OFD_LOCKS
+        release_process_locks(_fd, true);
+#endif
         int res = ::close(_fd);
         if(res == -1)
         {
@@ -244,5 +429,73 @@ void file::remove(const std::string& path)/*throw (io_exception)*/
     }
 }
 
+
+//
+// mapping
+//
+
+mapping::mapping(const file& f, size_t offset, size_t size) /*throw (io_exception)*/
+{
+    // Mapping offset shall be aligned on page size.
+    size_t page = (size_t) ::sysconf(_SC_PAGESIZE);
+    size_t delta = offset % page;
+    size_t length = size + delta;
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, f._fd, (off_t) (offset - delta));
+    if(addr == MAP_FAILED)
+    {
+        throw io_exception(errno);
+    }
+    _addr = addr;
+    _length = length;
+    _data = (const uint8_t*) addr + delta;
+    _size = size;
+}
+
+mapping::mapping(mapping&& other):
+_addr(other._addr),
+_length(other._length),
+_data(other._data),
+_size(other._size)
+{
+    other._addr = nullptr;
+    other._length = 0;
+    other._data = nullptr;
+    other._size = 0;
+}
+
+mapping& mapping::operator=(mapping&& other)
+{
+    if(this != &other)
+    {
+        unmap();
+        _addr = other._addr;
+        _length = other._length;
+        _data = other._data;
+        _size = other._size;
+        other._addr = nullptr;
+        other._length = 0;
+        other._data = nullptr;
+        other._size = 0;
+    }
+    return *this;
+}
+
+mapping::~mapping()
+{
+    unmap();
+}
+
+void mapping::unmap()
+{
+    if(_addr != nullptr)
+    {
+        ::munmap(_addr, _length);
+        _addr = nullptr;
+        _length = 0;
+        _data = nullptr;
+        _size = 0;
+    }
+}
+
 }
 } // namespace cyclic::io
\ No newline at end of file
@@ -21,6 +21,7 @@
 #ifndef _CYCLIC_COMMON_FILE_HPP_
 #define _CYCLIC_COMMON_FILE_HPP_
 
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <system_error>
@@ -77,7 +78,17 @@ public:
     file& operator=(file&& file);
     virtual ~file() /* throw(io_exception) */;
 
-    void open(const std::string& path) /*throw (io_exception)*/;
+    /**
+     * Open an existing file.
+     * @param path Path of the file to open.
+     * @param read_only True to open the file for reading only.
+     */
+    void open(const std::string& path, bool read_only = false) /*throw (io_exception)*/;
+    /**
+     * Open a file for reading and writing, creating it if it does not exist.
+     * An existing file is not truncated, so that it can be locked first.
+     * @param path Path of the file to create.
+     */
     void create(const std::string& path) /*throw (io_exception)*/;
 
     file& write(const void* buff, size_t size) /*throw (io_exception)*/;
@@ -88,6 +99,31 @@ public:
     file& read_at(void* buff, size_t size, size_t offset) /*throw (io_exception)*/;
     file& seek(size_t offset) /*throw (io_exception)*/;
     file& sync() /*throw (io_exception)*/;
+    /**
+     * Change the size of the file.
+     * @param size New size of the file, in bytes.
+     */
+    file& truncate(size_t size) /*throw (io_exception)*/;
+
+    /**
+     * Lock a byte range of the file.
+     * Locks are advisory and associated to the open file description when
+     * the system supports it (shared by copies of this file object).
+     * Otherwise they are associated to the process, and try-locks (not waiting)
+     * are also checked against the ones held through other descriptors of the process.
+     * @param offset Offset of the first byte to lock.
+     * @param size Number of bytes to lock.
+     * @param exclusive True for an exclusive (write) lock, false for a shared (read) lock.
+     * @param wait True to wait for the lock to be available.
+     * @return True if the lock is acquired, false if not waiting and it is held by another.
+     */
+    bool lock(size_t offset, size_t size, bool exclusive, bool wait = true) /*throw (io_exception)*/;
+    /**
+     * Unlock a byte range of the file.
+     * @param offset Offset of the first byte to unlock.
+     * @param size Number of bytes to unlock.
+     */
+    file& unlock(size_t offset, size_t size) /*throw (io_exception)*/;
 
     void close() /*throw (io_exception)*/;
 
@@ -106,6 +142,8 @@ public:
     static void remove(const std::string& path)/*throw (io_exception)*/;
 
 protected:
+    friend class mapping;
+
     int _fd = -1;
 
     file(int fd) : _fd(fd)
@@ -114,6 +152,79 @@ protected:
 
 };
 
+/**
+ * Read-only shared memory mapping of a file region.
+ * Mapped content follows modifications done to the file by any process.
+ */
+class mapping
+{
+public:
+    mapping() = default;
+    /**
+     * Map a region of a file.
+     * @param f File to map, shall be opened.
+     * @param offset Offset of the region to map, no alignment is required.
+     * @param size Size of the region to map.
+     */
+    mapping(const file& f, size_t offset, size_t size) /*throw (io_exception)*/;
+    mapping(mapping&& other);
+    mapping& operator=(mapping&& other);
+    ~mapping();
+
+    mapping(const mapping&) = delete;
+    mapping& operator=(const mapping&) = delete;
+
+    /** Unmap the region, if mapped. */
+    void unmap();
+
+    /** Pointer to the first byte of the mapped region. */
+    const uint8_t* data()const {return _data;}
+    /** Size of the mapped region. */
+    size_t size()const {return _size;}
+
+    bool ok()const {return _data != nullptr;}
+    operator bool()const {return ok();}
+
+protected:
+    void*          _addr = nullptr;
+    size_t         _length = 0;
+    const uint8_t* _data = nullptr;
+    size_t         _size = 0;
+};
+
+/**
+ * Scoped byte range lock of a file.
+ * Wait for the lock on construction, release it on destruction.
+ */
+class range_lock
+{
+public:
+    range_lock(file& f, size_t offset, size_t size, bool exclusive):
+        _file(f), _offset(offset), _size(size)
+    {
+        _file.lock(_offset, _size, exclusive, true);
+    }
+
+    ~range_lock()
+    {
+        try
+        {
+            _file.unlock(_offset, _size);
+        }
+        catch(io_exception&)
+        {
+            // Lock is released on close anyway.
+        }
+    }
+
+    range_lock(const range_lock&) = delete;
+    range_lock& operator=(const range_lock&) = delete;
+
+protected:
+    file& _file;
+    size_t _offset, _size;
+};
+
 template<typename T>
 file& file::write(const T& value) /*throw (io_exception)*/
 {
@@ -123,7 +234,7 @@ file& file::write(const T& value) /*throw (io_exception)*/
 template<typename T>
 file& file::write_at(const T&value, size_t offset) /*throw (io_exception)*/
 {
-    return write(&value, sizeof (T), offset);
+    return write_at(&value, sizeof (T), offset);
 }
 
 template<typename T>
@@ -135,7 +246,7 @@ file& file::read(T&value) /*throw (io_exception)*/
 template<typename T>
 file& file::read_at(T&value, size_t offset) /*throw (io_exception)*/
 {
-    return read(&value, sizeof (T), offset);
+    return read_at(&value, sizeof (T), offset);
 }
 
 template<size_t sz>
@@ -0,0 +1,658 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-join.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-join.hpp"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace cyclic
+{
+
+//
+// time_join
+//
+
+time_join::time_join(const std::vector<source>& sources):
+_sources(sources)
+{
+    if(_sources.empty())
+    {
+        throw std::invalid_argument{"At least one table is needed to join."};
+    }
+    for(size_t src = 0; src < _sources.size(); ++src)
+    {
+        const std::shared_ptr<const cyclic::table>& tbl = _sources[src].table;
+        if(!tbl)
+        {
+            throw std::invalid_argument{"Cannot join a null table."};
+        }
+        if(tbl->record_duration() == 0 && !tbl->timestamped())
+        {
+            throw time_not_supported{"Time is not supported by a joined table."};
+        }
+        if(tbl->record_duration() > _duration)
+        {
+            _duration = tbl->record_duration();
+            _origin = tbl->record_origin();
+        }
+
+        if((size_t) _fields.size() + tbl->field_count() > field::absolute_max_index())
+        {
+            throw std::invalid_argument{"Too many fields to join."};
+        }
+        for(field_index_t f = 0; f < tbl->field_count(); ++f)
+        {
+            field_index_t index = (field_index_t) _fields.size();
+            const cyclic::field& fld = tbl->field(f);
+            _fields.emplace_back(index, _sources[src].prefix + fld.name(), fld.type());
+            _source_fields.emplace_back(src, f);
+            _names.emplace(_fields.back().name(), index);
+        }
+    }
+    if(_duration == 0)
+    {
+        throw time_not_supported{"At least one joined table must have a record duration."};
+    }
+}
+
+field_index_t time_join::field_count() const
+{
+    return (field_index_t) _fields.size();
+}
+
+const cyclic::field& time_join::field(field_index_t field)const
+{
+    if(field >= _fields.size())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    return _fields[field];
+}
+
+const cyclic::field& time_join::field(const std::string& field_name)const
+{
+    field_index_t index = field_index(field_name);
+    if(index == field::invalid_index())
+    {
+        throw unknown_field{"Unknown field '" + field_name + "'."};
+    }
+    return _fields[index];
+}
+
+field_index_t time_join::field_index(const std::string& field_name)const
+{
+    auto it = _names.find(field_name);
+    return it != _names.end() ? it->second : field::invalid_index();
+}
+
+std::pair<size_t, field_index_t> time_join::source_field(field_index_t field)const
+{
+    if(field >= _source_fields.size())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    return _source_fields[field];
+}
+
+record_index_t time_join::record_index(record_time_t time)const
+{
+    if(time < _origin)
+    {
+        throw std::out_of_range{"Time is before the join origin."};
+    }
+    uint64_t index = (uint64_t) ((time - _origin) / _duration);
+    if(index > record::absolute_max_index())
+    {
+        throw std::out_of_range{"Time is out of the join index range."};
+    }
+    return (record_index_t) index;
+}
+
+record_time_t time_join::record_time(record_index_t index)const
+{
+    return _origin + (record_time_t) index * _duration;
+}
+
+record_index_t time_join::min_index()const
+{
+    record_index_t res = record::invalid_index();
+    for(const source& src : _sources)
+    {
+        if(src.table->record_count() == 0)
+        {
+            continue;
+        }
+        record_time_t first = src.table->record_time(src.table->min_index());
+        record_time_t last = src.table->record_time(src.table->max_index());
+        if(last < _origin)
+        {
+            continue;
+        }
+        record_index_t index = first < _origin ? 0 : record_index(first);
+        if(res == record::invalid_index() || index < res)
+        {
+            res = index;
+        }
+    }
+    return res;
+}
+
+record_index_t time_join::max_index()const
+{
+    record_index_t res = record::invalid_index();
+    for(const source& src : _sources)
+    {
+        if(src.table->record_count() == 0)
+        {
+            continue;
+        }
+        record_time_t last = src.table->record_time(src.table->max_index());
+        if(last < _origin)
+        {
+            continue;
+        }
+        record_index_t index = record_index(last);
+        if(res == record::invalid_index() || index > res)
+        {
+            res = index;
+        }
+    }
+    return res;
+}
+
+record_index_t time_join::record_count() const
+{
+    record_index_t min = min_index();
+    return min == record::invalid_index() ? 0 : max_index() - min + 1;
+}
+
+record_index_t time_join::source_index(size_t src, record_time_t time)const
+{
+    const cyclic::table& tbl = *_sources[src].table;
+    if(tbl.record_count() == 0)
+    {
+        return record::invalid_index();
+    }
+    if(tbl.timestamped())
+    {
+        if(time < tbl.record_time(tbl.min_index()))
+        {
+            return record::invalid_index();
+        }
+        record_index_t index = tbl.record_index(time);
+        return tbl.record_time(index) > time - _duration ? index : record::invalid_index();
+    }
+    if(time < tbl.record_origin())
+    {
+        return record::invalid_index();
+    }
+    uint64_t index = (uint64_t) ((time - tbl.record_origin()) / tbl.record_duration());
+    return index >= tbl.min_index() && index <= tbl.max_index() ? (record_index_t) index : record::invalid_index();
+}
+
+std::unique_ptr<record> time_join::get_record(record_index_t index)const
+{
+    record_index_t min = min_index();
+    if(min == record::invalid_index() || index < min || index > max_index())
+    {
+        throw std::out_of_range{"Out of range record index."};
+    }
+
+    record_time_t time = record_time(index);
+    std::unique_ptr<raw_record> rec{new raw_record(this, index, time)};
+    if(!_fields.empty())
+    {
+        rec->reset((field_index_t) (_fields.size() - 1)); // Hold all joined fields
+    }
+    field_index_t offset = 0;
+    for(size_t src = 0; src < _sources.size(); ++src)
+    {
+        const cyclic::table& tbl = *_sources[src].table;
+        record_index_t idx = source_index(src, time);
+        if(idx != record::invalid_index())
+        {
+            record_view view = tbl.get_record_view(idx);
+            for(field_index_t f = 0; f < view.size(); ++f)
+            {
+                if(view.has(f))
+                {
+                    rec->set(offset + f, view.get(f));
+                }
+            }
+        }
+        offset += tbl.field_count();
+    }
+    return rec;
+}
+
+const_recordset_iterator time_join::begin()const
+{
+    return const_recordset_iterator{std::make_shared<iterator>(this, min_index())};
+}
+
+const_recordset_iterator time_join::end()const
+{
+    return const_recordset_iterator{std::make_shared<iterator>(this)};
+}
+
+//
+// time_join::source_block
+//
+
+struct time_join::source_block
+{
+    /** Marker of joined records without table record. */
+    static constexpr size_t none = (size_t) -1;
+
+    /** Offset of the table record of each joined record in columns, none if not stored. */
+    std::vector<size_t> rows;
+    /** Values of each table field, packed as the field type. */
+    std::vector<std::vector<uint64_t>> columns;
+    /** Validity bitmap of each table field. */
+    std::vector<std::vector<uint8_t>> validity;
+
+    /**
+     * Retrieve a value.
+     * @param field Table field index.
+     * @param type Table field type.
+     * @param row Offset of the table record in columns.
+     * @return Value, null if not set.
+     */
+    value_t get(field_index_t field, data_type type, size_t row)const
+    {
+        if(!(validity[field][row / 8] & (1 << (row % 8))))
+        {
+            return value_t{};
+        }
+        const void* data = columns[field].data();
+        switch(type)
+        {
+        case CDB_DT_BOOLEAN: return value_t{static_cast<const bool*>(data)[row]};
+        case CDB_DT_SIGNED_8: return value_t{static_cast<const int8_t*>(data)[row]};
+        case CDB_DT_UNSIGNED_8: return value_t{static_cast<const uint8_t*>(data)[row]};
+        case CDB_DT_SIGNED_16: return value_t{static_cast<const int16_t*>(data)[row]};
+        case CDB_DT_UNSIGNED_16: return value_t{static_cast<const uint16_t*>(data)[row]};
+        case CDB_DT_SIGNED_32: return value_t{static_cast<const int32_t*>(data)[row]};
+        case CDB_DT_UNSIGNED_32: return value_t{static_cast<const uint32_t*>(data)[row]};
+        case CDB_DT_SIGNED_64: return value_t{static_cast<const int64_t*>(data)[row]};
+        case CDB_DT_UNSIGNED_64: return value_t{static_cast<const uint64_t*>(data)[row]};
+        case CDB_DT_FLOAT_4: return value_t{static_cast<const float*>(data)[row]};
+        case CDB_DT_FLOAT_8: return value_t{static_cast<const double*>(data)[row]};
+        default: return value_t{};
+        }
+    }
+};
+
+namespace
+{
+/**
+ * Size of values of a type in column arrays.
+ * @param type Data type.
+ * @return Size of a value in bytes, 0 for types without value.
+ */
+size_t value_size(data_type type)
+{
+    switch(type)
+    {
+    case CDB_DT_BOOLEAN: return sizeof(bool);
+    case CDB_DT_SIGNED_8:
+    case CDB_DT_UNSIGNED_8: return 1;
+    case CDB_DT_SIGNED_16:
+    case CDB_DT_UNSIGNED_16: return 2;
+    case CDB_DT_SIGNED_32:
+    case CDB_DT_UNSIGNED_32:
+    case CDB_DT_FLOAT_4: return 4;
+    case CDB_DT_SIGNED_64:
+    case CDB_DT_UNSIGNED_64:
+    case CDB_DT_FLOAT_8: return 8;
+    default: return 0;
+    }
+}
+
+/**
+ * Bounded queue of blocks read ahead by a table reader.
+ * The reader stops when the consumer closes the queue.
+ */
+template<typename T>
+class block_queue
+{
+public:
+    explicit block_queue(size_t capacity): _capacity(capacity) {}
+
+    /**
+     * Queue a block, waiting for room.
+     * @param block Block to queue.
+     * @return False if the queue is closed.
+     */
+    bool push(T&& block)
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _not_full.wait(lock, [this]{return _closed || _blocks.size() < _capacity;});
+        if(_closed)
+        {
+            return false;
+        }
+        _blocks.push_back(std::move(block));
+        _not_empty.notify_one();
+        return true;
+    }
+
+    /**
+     * Report a reader failure, rethrown by pop().
+     * @param error Failure.
+     */
+    void fail(std::exception_ptr error)
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _error = error;
+        _not_empty.notify_one();
+    }
+
+    /**
+     * Take the next block, waiting for it.
+     * @return Next block.
+     */
+    T pop()
+    {
+        std::unique_lock<std::mutex> lock{_mutex};
+        _not_empty.wait(lock, [this]{return _error || !_blocks.empty();});
+        if(_blocks.empty())
+        {
+            std::rethrow_exception(_error);
+        }
+        T block = std::move(_blocks.front());
+        _blocks.pop_front();
+        _not_full.notify_one();
+        return block;
+    }
+
+    /** Stop the reader. */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _closed = true;
+        _not_full.notify_one();
+    }
+
+protected:
+    size_t _capacity;
+    std::deque<T> _blocks;
+    std::exception_ptr _error;
+    bool _closed = false;
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+};
+} // namespace
+
+void time_join::read_block(size_t src, record_index_t first, record_index_t count, source_block& out)const
+{
+    // Records closer than this are read in the same range, skipping unused ones.
+    static constexpr record_index_t max_range_gap = 64;
+
+    const cyclic::table& tbl = *_sources[src].table;
+    out.rows.assign(count, source_block::none);
+
+    // Table records of joined records, in increasing order.
+    std::vector<record_index_t> indexes(count, record::invalid_index());
+    if(tbl.timestamped())
+    {
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            indexes[n] = source_index(src, record_time(first + n));
+        }
+    }
+    else if(tbl.record_count() != 0)
+    {
+        record_index_t min = tbl.min_index(), max = tbl.max_index();
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            record_time_t time = record_time(first + n);
+            if(time >= tbl.record_origin())
+            {
+                uint64_t index = (uint64_t) ((time - tbl.record_origin()) / tbl.record_duration());
+                indexes[n] = index >= min && index <= max ? index : record::invalid_index();
+            }
+        }
+    }
+
+    // Group close records in ranges and place them in columns.
+    std::vector<std::pair<record_index_t, record_index_t>> ranges;
+    size_t size = 0;
+    for(record_index_t n = 0; n < count; ++n)
+    {
+        record_index_t index = indexes[n];
+        if(index == record::invalid_index())
+        {
+            continue;
+        }
+        if(ranges.empty() || index > ranges.back().second + max_range_gap)
+        {
+            ranges.emplace_back(index, index);
+            ++size;
+        }
+        else if(index > ranges.back().second)
+        {
+            size += index - ranges.back().second;
+            ranges.back().second = index;
+        }
+        out.rows[n] = size - 1 - (ranges.back().second - index);
+    }
+
+    field_index_t fields = tbl.field_count();
+    out.columns.resize(fields);
+    out.validity.resize(fields);
+    for(field_index_t f = 0; f < fields; ++f)
+    {
+        data_type type = tbl.field(f).type();
+        // Enough 8 bytes words for values of any type.
+        out.columns[f].assign(size, 0);
+        out.validity[f].assign(size / 8 + 1, 0);
+        if(value_size(type) == 0)
+        {
+            continue; // No value to read, all null.
+        }
+        size_t offset = 0;
+        for(const std::pair<record_index_t, record_index_t>& range : ranges)
+        {
+            size_t length = range.second - range.first + 1;
+            if(offset % 8 == 0)
+            {
+                tbl.read_column(f, range.first, range.second, type,
+                        (uint8_t*) out.columns[f].data() + offset * value_size(type), out.validity[f].data() + offset / 8);
+            }
+            else
+            {
+                // Validity bits are not byte aligned, read the bitmap aside.
+                std::vector<uint8_t> bits(length / 8 + 1);
+                tbl.read_column(f, range.first, range.second, type,
+                        (uint8_t*) out.columns[f].data() + offset * value_size(type), bits.data());
+                for(size_t n = 0; n < length; ++n)
+                {
+                    if(bits[n / 8] & (1 << (n % 8)))
+                    {
+                        out.validity[f][(offset + n) / 8] |= (uint8_t) (1 << ((offset + n) % 8));
+                    }
+                }
+            }
+            offset += length;
+        }
+    }
+}
+
+void time_join::scan(record_index_t first, record_index_t last, const std::function<void(const record&)>& fn)const
+{
+    // Number of records joined at once.
+    static constexpr record_index_t block_size = 1024;
+    // Number of blocks a table reader can read ahead.
+    static constexpr size_t read_ahead = 2;
+
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    record_index_t min = min_index();
+    if(min == record::invalid_index())
+    {
+        return;
+    }
+    record_index_t from = std::max(first, min);
+    record_index_t to = std::min(last, max_index());
+
+    // One reader per table, each reading its blocks in order.
+    std::vector<std::unique_ptr<block_queue<source_block>>> queues;
+    std::vector<std::thread> readers;
+    for(size_t src = 0; src < _sources.size(); ++src)
+    {
+        queues.emplace_back(new block_queue<source_block>{read_ahead});
+        block_queue<source_block>* queue = queues.back().get();
+        readers.emplace_back([this, src, from, to, queue]()
+        {
+            try
+            {
+                for(uint64_t block = from; block <= to; block += block_size)
+                {
+                    source_block values;
+                    read_block(src, (record_index_t) block, (record_index_t) std::min<uint64_t>(to - block + 1, block_size), values);
+                    if(!queue->push(std::move(values)))
+                    {
+                        return;
+                    }
+                }
+            }
+            catch(...)
+            {
+                queue->fail(std::current_exception());
+            }
+        });
+    }
+    // Readers are stopped, and waited for, whatever happens while joining.
+    struct reader_guard
+    {
+        std::vector<std::unique_ptr<block_queue<source_block>>>& queues;
+        std::vector<std::thread>& readers;
+        ~reader_guard()
+        {
+            for(size_t src = 0; src < readers.size(); ++src)
+            {
+                queues[src]->close();
+                readers[src].join();
+            }
+        }
+    } guard{queues, readers};
+
+    std::vector<source_block> values(_sources.size());
+    raw_record rec(this);
+    if(!_fields.empty())
+    {
+        rec.reset((field_index_t) (_fields.size() - 1)); // Hold all joined fields
+    }
+    for(uint64_t block = from; block <= to; block += block_size)
+    {
+        record_index_t count = (record_index_t) std::min<uint64_t>(to - block + 1, block_size);
+        for(size_t src = 0; src < _sources.size(); ++src)
+        {
+            values[src] = queues[src]->pop();
+        }
+
+        for(record_index_t n = 0; n < count; ++n)
+        {
+            bool stored = false;
+            rec.reset();
+            rec.index((record_index_t) block + n);
+            rec.time(record_time((record_index_t) block + n));
+            field_index_t offset = 0;
+            for(size_t src = 0; src < _sources.size(); ++src)
+            {
+                const cyclic::table& tbl = *_sources[src].table;
+                size_t row = values[src].rows[n];
+                if(row != source_block::none)
+                {
+                    stored = true;
+                    for(field_index_t f = 0; f < tbl.field_count(); ++f)
+                    {
+                        const value_t val = values[src].get(f, tbl.field(f).type(), row);
+                        if(val)
+                        {
+                            rec.set(offset + f, val);
+                        }
+                    }
+                }
+                offset += tbl.field_count();
+            }
+            if(stored)
+            {
+                fn(rec);
+            }
+        }
+    }
+}
+
+//
+// time_join::iterator
+//
+
+time_join::iterator::iterator(const time_join* join, record_index_t index):
+_join(join),
+_index(index)
+{
+}
+
+bool time_join::iterator::ok()const
+{
+    return _index != record::invalid_index() && _index <= _join->max_index();
+}
+
+void time_join::iterator::increment()
+{
+    if(_index != record::invalid_index())
+    {
+        _index++;
+        _rec.reset();
+    }
+}
+
+bool time_join::iterator::equals(const cyclic::recordset::const_iterator_interface* other)const
+{
+    const time_join::iterator* it = dynamic_cast<const time_join::iterator*>(other);
+    if(it == nullptr || _join != it->_join)
+    {
+        return false;
+    }
+    // All iterators past the last joined record are equal.
+    return ok() || it->ok() ? _index == it->_index : true;
+}
+
+const record& time_join::iterator::dereference()
+{
+    if(!_rec)
+    {
+        _rec = _join->get_record(_index);
+    }
+    return *_rec;
+}
+
+} // namespace cyclic
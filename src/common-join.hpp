@@ -0,0 +1,201 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-join.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CYCLIC_COMMON_JOIN_HPP_
+#define _CYCLIC_COMMON_JOIN_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common-base.hpp"
+
+namespace cyclic
+{
+    /**
+     * Recordset joining several tables on time.
+     * Records of the join are aligned on the coarsest record duration of the joined tables:
+     * joined record n covers [origin + n * duration, origin + (n + 1) * duration), origin
+     * being the one of the coarsest table. It holds the fields of all tables, in table order,
+     * valued with the table records at the beginning of its time interval (or the last ones
+     * before it for timestamped tables, if not older than one joined record duration).
+     * The joined range is the union of the table ranges, fields of tables without a record
+     * at a time point are null.
+     * Tables are read when accessed, so the join follows their evolution.
+     */
+    class time_join : public recordset
+    {
+    public:
+        /**
+         * Table to join.
+         */
+        struct source
+        {
+            /** Joined table, shall support time. */
+            std::shared_ptr<const cyclic::table> table;
+            /** Prefix of the joined field names, to distinguish fields of the same name. */
+            std::string prefix;
+        };
+
+        /**
+         * Join tables.
+         * @param sources Tables to join.
+         * @throw std::invalid_argument If no table is specified.
+         * @throw cyclic::time_not_supported If a table does not support time,
+         * or if no table has a record duration (only timestamped tables).
+         */
+        explicit time_join(const std::vector<source>& sources);
+
+        field_index_t field_count() const override;
+        const cyclic::field& field(field_index_t field)const override;
+        const cyclic::field& field(const std::string& field_name)const override;
+        field_index_t field_index(const std::string& field_name)const override;
+
+        record_index_t record_count() const override;
+        record_index_t min_index()const override;
+        record_index_t max_index()const override;
+        std::unique_ptr<record> get_record(record_index_t index)const override;
+        const_recordset_iterator begin()const override;
+        const_recordset_iterator end()const override;
+
+        /**
+         * Retrieve the joined tables.
+         * @return Joined tables, in join order.
+         */
+        const std::vector<source>& sources()const {return _sources;}
+
+        /**
+         * Retrieve the table holding a joined field.
+         * @param field Joined field index.
+         * @return Index of the table in sources(), and index of the field in this table.
+         * @throw std::out_of_range if the field index is out of held field range.
+         */
+        std::pair<size_t, field_index_t> source_field(field_index_t field)const;
+
+        /**
+         * Return the origin time point of joined records.
+         * @return Origin of the coarsest table.
+         */
+        record_time_t record_origin()const {return _origin;}
+
+        /**
+         * Return the duration of joined records.
+         * @return Coarsest record duration of joined tables.
+         */
+        record_time_t record_duration()const {return _duration;}
+
+        /**
+         * Return the joined record index corresponding to a time point.
+         * @param time Time point to compute.
+         * @return The corresponding record index.
+         * @throw std::out_of_range When time is before the time origin or index is out of valid index range.
+         */
+        record_index_t record_index(record_time_t time)const;
+
+        /**
+         * Return the time of the beginning of a joined record.
+         * @param index Index of record to look for.
+         * @return The time point of the beginning of the record.
+         */
+        record_time_t record_time(record_index_t index)const;
+
+        /**
+         * Stream joined records over a range.
+         * Records are joined by blocks. Each table has its own reader thread, reading
+         * its blocks ahead with column range reads while previous ones are joined.
+         * Records which are not stored in any table are skipped.
+         * @param first Index of the first joined record.
+         * @param last Index of the last joined record (inclusive).
+         * @param fn Function called with each joined record, in index order.
+         * @throw std::invalid_argument if last is lower than first.
+         */
+        void scan(record_index_t first, record_index_t last, const std::function<void(const record&)>& fn)const;
+
+    protected:
+        /**
+         * Field of a join.
+         */
+        class joined_field : public cyclic::field
+        {
+        protected:
+            field_index_t _index;
+            std::string _name;
+            data_type _type;
+        public:
+            joined_field(field_index_t index, const std::string& name, data_type type):
+                _index(index), _name(name), _type(type) {}
+
+            index_t index() const override {return _index;}
+            std::string name() const override {return _name;}
+            data_type type() const override {return _type;}
+        };
+
+        /**
+         * Retrieve the record of a table to join at a time point.
+         * @param src Index of the table.
+         * @param time Time of the joined record.
+         * @return Index of the table record, record::invalid_index() if none.
+         */
+        record_index_t source_index(size_t src, record_time_t time)const;
+
+        /** Values of a table for a block of joined records. */
+        struct source_block;
+
+        /**
+         * Read the table records to join to a block of joined records.
+         * Needed table records are read by ranges, one column at a time.
+         * @param src Index of the table.
+         * @param first Index of the first joined record.
+         * @param count Number of joined records.
+         * @param out Values of the table records.
+         */
+        void read_block(size_t src, record_index_t first, record_index_t count, source_block& out)const;
+
+        /**
+         * Implementation of joined record iterator.
+         */
+        class iterator : public cyclic::recordset::const_iterator_interface
+        {
+        public:
+            iterator(const time_join* join, record_index_t index = record::invalid_index());
+            bool ok()const override;
+            void increment() override;
+            bool equals(const cyclic::recordset::const_iterator_interface* other)const override;
+            const record& dereference() override;
+
+        protected:
+            std::unique_ptr<record> _rec;
+            const time_join* _join;
+            record_index_t _index;
+        };
+
+        std::vector<source> _sources;
+        std::vector<joined_field> _fields;
+        /** Table and table field of each joined field. */
+        std::vector<std::pair<size_t, field_index_t>> _source_fields;
+        /** Joined field indexes by name, first field wins on duplicated names. */
+        std::unordered_map<std::string, field_index_t> _names;
+        record_time_t _origin = 0;
+        record_time_t _duration = 0;
+    };
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_JOIN_HPP_
@@ -0,0 +1,601 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-predicate.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-predicate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+
+namespace cyclic
+{
+
+//
+// predicate node
+//
+
+struct predicate::node
+{
+    kind type;
+    field_index_t field = 0;
+    comparison op = EQUAL;
+    double value = 0;
+    std::shared_ptr<const node> left, right;
+
+    /** Compiled form for block evaluation, built on first use. */
+    mutable std::once_flag compiled_once;
+    mutable std::unique_ptr<compiled_predicate> compiled;
+};
+
+//
+// predicate
+//
+
+predicate predicate::compare(field_index_t field, comparison op, double value)
+{
+    std::shared_ptr<node> n = std::make_shared<node>();
+    n->type = COMPARE;
+    n->field = field;
+    n->op = op;
+    n->value = value;
+    return predicate{n};
+}
+
+predicate predicate::is_null(field_index_t field)
+{
+    std::shared_ptr<node> n = std::make_shared<node>();
+    n->type = IS_NULL;
+    n->field = field;
+    return predicate{n};
+}
+
+predicate predicate::is_not_null(field_index_t field)
+{
+    std::shared_ptr<node> n = std::make_shared<node>();
+    n->type = IS_NOT_NULL;
+    n->field = field;
+    return predicate{n};
+}
+
+predicate predicate::operator&&(const predicate& other)const
+{
+    std::shared_ptr<node> n = std::make_shared<node>();
+    n->type = AND;
+    n->left = _node;
+    n->right = other._node;
+    return predicate{n};
+}
+
+predicate predicate::operator||(const predicate& other)const
+{
+    std::shared_ptr<node> n = std::make_shared<node>();
+    n->type = OR;
+    n->left = _node;
+    n->right = other._node;
+    return predicate{n};
+}
+
+predicate::kind predicate::type()const
+{
+    return _node->type;
+}
+
+field_index_t predicate::field()const
+{
+    return _node->field;
+}
+
+predicate::comparison predicate::op()const
+{
+    return _node->op;
+}
+
+double predicate::value()const
+{
+    return _node->value;
+}
+
+predicate predicate::left()const
+{
+    return predicate{_node->left};
+}
+
+predicate predicate::right()const
+{
+    return predicate{_node->right};
+}
+
+std::vector<field_index_t> predicate::fields()const
+{
+    std::vector<field_index_t> res;
+    if(type() == AND || type() == OR)
+    {
+        for(field_index_t f : left().fields())
+        {
+            if(std::find(res.begin(), res.end(), f) == res.end())
+            {
+                res.push_back(f);
+            }
+        }
+        for(field_index_t f : right().fields())
+        {
+            if(std::find(res.begin(), res.end(), f) == res.end())
+            {
+                res.push_back(f);
+            }
+        }
+    }
+    else
+    {
+        res.push_back(field());
+    }
+    return res;
+}
+
+//
+// compiled_predicate
+//
+
+struct compiled_predicate::block
+{
+    /** Number of records in the block. */
+    size_t count;
+    /** Number of bytes of bitmaps. */
+    size_t bytes;
+    /** Values of each referenced column. */
+    std::vector<const void*> values;
+    /** Validity bitmap of each referenced column. */
+    std::vector<const uint8_t*> validity;
+};
+
+struct compiled_predicate::op
+{
+    virtual ~op() = default;
+    /**
+     * Evaluate the operator on a block.
+     * @param columns Columns of the block.
+     * @param selection Bitmap of matching records.
+     */
+    virtual void evaluate(const block& columns, uint8_t* selection)const =0;
+};
+
+namespace
+{
+    typedef compiled_predicate::op op;
+    typedef compiled_predicate::block block;
+
+    /*
+     * Compare values to a constant, 8 values per output byte.
+     * Written branch-free so that compilers vectorize the inner loop.
+     */
+    template<typename T, typename U, typename Cmp>
+    void compare_block(const T* values, const uint8_t* validity, size_t count, U value, uint8_t* selection)
+    {
+        Cmp cmp;
+        size_t bytes = count / 8;
+        for(size_t b = 0; b < bytes; ++b)
+        {
+            const T* v = values + b * 8;
+            uint8_t bits = 0;
+            for(unsigned i = 0; i < 8; ++i)
+            {
+                bits |= (uint8_t) (cmp((U) v[i], value) << i);
+            }
+            selection[b] = bits & validity[b];
+        }
+        if(count % 8 != 0)
+        {
+            uint8_t bits = 0;
+            for(unsigned i = 0; i < count % 8; ++i)
+            {
+                bits |= (uint8_t) (cmp((U) values[bytes * 8 + i], value) << i);
+            }
+            selection[bytes] = bits & validity[bytes];
+        }
+    }
+
+    /*
+     * Comparison of a column of T values to a constant of type U.
+     */
+    template<typename T, typename U, typename Cmp>
+    struct compare_op : public op
+    {
+        size_t column;
+        U value;
+
+        compare_op(size_t column, U value):column(column),value(value){}
+
+        void evaluate(const block& columns, uint8_t* selection)const override
+        {
+            compare_block<T, U, Cmp>((const T*) columns.values[column], columns.validity[column],
+                    columns.count, value, selection);
+        }
+    };
+
+    /*
+     * Comparison whose result does not depend on the value (but only on its presence).
+     */
+    struct constant_op : public op
+    {
+        size_t column;
+        bool result;
+
+        constant_op(size_t column, bool result):column(column),result(result){}
+
+        void evaluate(const block& columns, uint8_t* selection)const override
+        {
+            if(result)
+            {
+                std::memcpy(selection, columns.validity[column], columns.bytes);
+            }
+            else
+            {
+                std::memset(selection, 0, columns.bytes);
+            }
+        }
+    };
+
+    /*
+     * Test of presence or absence of value.
+     */
+    struct null_op : public op
+    {
+        size_t column;
+        bool is_null;
+
+        null_op(size_t column, bool is_null):column(column),is_null(is_null){}
+
+        void evaluate(const block& columns, uint8_t* selection)const override
+        {
+            const uint8_t* validity = columns.validity[column];
+            for(size_t b = 0; b < columns.bytes; ++b)
+            {
+                selection[b] = is_null ? (uint8_t) ~validity[b] : validity[b];
+            }
+        }
+    };
+
+    /*
+     * Conjunction or disjunction of two operators.
+     * The second operator is skipped when the first one decides for the whole block.
+     */
+    struct combine_op : public op
+    {
+        bool conjunction;
+        std::unique_ptr<op> left, right;
+
+        combine_op(bool conjunction, std::unique_ptr<op>&& left, std::unique_ptr<op>&& right):
+            conjunction(conjunction), left(std::move(left)), right(std::move(right)){}
+
+        void evaluate(const block& columns, uint8_t* selection)const override
+        {
+            left->evaluate(columns, selection);
+            uint8_t decided = conjunction ? 0x00 : 0xFF;
+            size_t b = 0;
+            while(b < columns.bytes && selection[b] == decided)
+            {
+                ++b;
+            }
+            if(b == columns.bytes)
+            {
+                return;
+            }
+            std::vector<uint8_t> other(columns.bytes);
+            right->evaluate(columns, other.data());
+            for(b = 0; b < columns.bytes; ++b)
+            {
+                selection[b] = conjunction ? selection[b] & other[b] : selection[b] | other[b];
+            }
+        }
+    };
+
+    template<typename T, typename U>
+    std::unique_ptr<op> make_compare_op(size_t column, predicate::comparison cmp, U value)
+    {
+        switch(cmp)
+        {
+        case predicate::EQUAL:
+            return std::unique_ptr<op>(new compare_op<T, U, std::equal_to<U>>(column, value));
+        case predicate::NOT_EQUAL:
+            return std::unique_ptr<op>(new compare_op<T, U, std::not_equal_to<U>>(column, value));
+        case predicate::LESS:
+            return std::unique_ptr<op>(new compare_op<T, U, std::less<U>>(column, value));
+        case predicate::LESS_EQUAL:
+            return std::unique_ptr<op>(new compare_op<T, U, std::less_equal<U>>(column, value));
+        case predicate::GREATER:
+            return std::unique_ptr<op>(new compare_op<T, U, std::greater<U>>(column, value));
+        case predicate::GREATER_EQUAL:
+        default:
+            return std::unique_ptr<op>(new compare_op<T, U, std::greater_equal<U>>(column, value));
+        }
+    }
+
+    /*
+     * Constant converted to the type T of compared values.
+     * For integer values, the constant is converted to the value type,
+     * rounding it in the direction preserving the comparison result
+     * (i.e. 'x < 12.5' becomes 'x < 13'), and out-of-range constants are folded.
+     */
+    template<typename T>
+    struct typed_constant
+    {
+        /** Type of the converted constant, floating point and boolean values are exactly represented as double. */
+        typedef typename std::conditional<std::is_integral<T>::value && !std::is_same<T, bool>::value, T, double>::type type;
+
+        /** The comparison result does not depend on the value (but only on its presence). */
+        bool folded = false;
+        /** Comparison result, if folded. */
+        bool result = false;
+        /** Converted constant, if not folded. */
+        type value = 0;
+
+        typed_constant(predicate::comparison cmp, double constant)
+        {
+            if constexpr (std::is_same<type, double>::value)
+            {
+                value = constant;
+            }
+            else
+            {
+                // Values are in [lower, upper)
+                const double lower = (double) std::numeric_limits<T>::lowest();
+                const double upper = std::ldexp(1.0, std::numeric_limits<T>::digits);
+
+                if(std::isnan(constant))
+                {
+                    fold(cmp == predicate::NOT_EQUAL);
+                    return;
+                }
+                switch(cmp)
+                {
+                case predicate::EQUAL:
+                case predicate::NOT_EQUAL:
+                    if(constant != std::floor(constant) || constant < lower || constant >= upper)
+                    {
+                        fold(cmp == predicate::NOT_EQUAL);
+                        return;
+                    }
+                    value = (T) constant;
+                    return;
+                case predicate::LESS:
+                case predicate::GREATER_EQUAL:
+                {
+                    double bound = std::ceil(constant);
+                    if(bound <= lower)
+                    {
+                        fold(cmp == predicate::GREATER_EQUAL);
+                    }
+                    else if(bound >= upper)
+                    {
+                        fold(cmp == predicate::LESS);
+                    }
+                    else
+                    {
+                        value = (T) bound;
+                    }
+                    return;
+                }
+                case predicate::LESS_EQUAL:
+                case predicate::GREATER:
+                default:
+                {
+                    double bound = std::floor(constant);
+                    if(bound < lower)
+                    {
+                        fold(cmp == predicate::GREATER);
+                    }
+                    else if(bound >= upper)
+                    {
+                        fold(cmp == predicate::LESS_EQUAL);
+                    }
+                    else
+                    {
+                        value = (T) bound;
+                    }
+                    return;
+                }
+                }
+            }
+        }
+
+        void fold(bool res)
+        {
+            folded = true;
+            result = res;
+        }
+    };
+
+    /*
+     * Compile the comparison of a column of type T to a constant.
+     */
+    template<typename T>
+    std::unique_ptr<op> compile_compare(size_t column, predicate::comparison cmp, double value)
+    {
+        typed_constant<T> constant(cmp, value);
+        if(constant.folded)
+        {
+            return std::unique_ptr<op>(new constant_op(column, constant.result));
+        }
+        return make_compare_op<T, typename typed_constant<T>::type>(column, cmp, constant.value);
+    }
+
+    /*
+     * Compare a single value of type T to a constant, as compiled comparisons do.
+     */
+    template<typename T>
+    bool compare_value(T val, predicate::comparison cmp, double value)
+    {
+        typedef typename typed_constant<T>::type U;
+        typed_constant<T> constant(cmp, value);
+        if(constant.folded)
+        {
+            return constant.result;
+        }
+        switch(cmp)
+        {
+        case predicate::EQUAL: return (U) val == constant.value;
+        case predicate::NOT_EQUAL: return (U) val != constant.value;
+        case predicate::LESS: return (U) val < constant.value;
+        case predicate::LESS_EQUAL: return (U) val <= constant.value;
+        case predicate::GREATER: return (U) val > constant.value;
+        case predicate::GREATER_EQUAL: return (U) val >= constant.value;
+        }
+        return false;
+    }
+
+    std::unique_ptr<op> compile(const predicate& pred, const std::vector<data_type>& types,
+            std::vector<field_index_t>& fields, std::vector<data_type>& columns)
+    {
+        if(pred.type() == predicate::AND || pred.type() == predicate::OR)
+        {
+            std::unique_ptr<op> left = compile(pred.left(), types, fields, columns);
+            std::unique_ptr<op> right = compile(pred.right(), types, fields, columns);
+            return std::unique_ptr<op>(new combine_op(pred.type() == predicate::AND, std::move(left), std::move(right)));
+        }
+
+        if(pred.field() >= types.size())
+        {
+            throw std::out_of_range{"Out of range field id."};
+        }
+        size_t column = std::find(fields.begin(), fields.end(), pred.field()) - fields.begin();
+        if(column == fields.size())
+        {
+            fields.push_back(pred.field());
+            columns.push_back(types[pred.field()]);
+        }
+
+        if(pred.type() != predicate::COMPARE)
+        {
+            return std::unique_ptr<op>(new null_op(column, pred.type() == predicate::IS_NULL));
+        }
+        switch(types[pred.field()])
+        {
+        case CDB_DT_BOOLEAN: return compile_compare<bool>(column, pred.op(), pred.value());
+        case CDB_DT_SIGNED_8: return compile_compare<int8_t>(column, pred.op(), pred.value());
+        case CDB_DT_UNSIGNED_8: return compile_compare<uint8_t>(column, pred.op(), pred.value());
+        case CDB_DT_SIGNED_16: return compile_compare<int16_t>(column, pred.op(), pred.value());
+        case CDB_DT_UNSIGNED_16: return compile_compare<uint16_t>(column, pred.op(), pred.value());
+        case CDB_DT_SIGNED_32: return compile_compare<int32_t>(column, pred.op(), pred.value());
+        case CDB_DT_UNSIGNED_32: return compile_compare<uint32_t>(column, pred.op(), pred.value());
+        case CDB_DT_SIGNED_64: return compile_compare<int64_t>(column, pred.op(), pred.value());
+        case CDB_DT_UNSIGNED_64: return compile_compare<uint64_t>(column, pred.op(), pred.value());
+        case CDB_DT_FLOAT_4: return compile_compare<float>(column, pred.op(), pred.value());
+        case CDB_DT_FLOAT_8: return compile_compare<double>(column, pred.op(), pred.value());
+        default:
+            throw std::invalid_argument{"Field type cannot be compared."};
+        }
+    }
+}
+
+compiled_predicate::compiled_predicate(const predicate& pred, const std::vector<data_type>& types):
+_root(compile(pred, types, _fields, _types))
+{
+}
+
+compiled_predicate::compiled_predicate(compiled_predicate&& other) = default;
+
+compiled_predicate::~compiled_predicate() = default;
+
+void compiled_predicate::evaluate(size_t count, const column_source& source, uint8_t* selection)const
+{
+    if(count == 0)
+    {
+        return;
+    }
+    block columns;
+    columns.count = count;
+    columns.bytes = (count - 1) / 8 + 1;
+    columns.values.resize(_fields.size());
+    columns.validity.resize(_fields.size());
+    for(size_t column = 0; column < _fields.size(); ++column)
+    {
+        columns.values[column] = source(_fields[column], _types[column], columns.validity[column]);
+    }
+
+    _root->evaluate(columns, selection);
+
+    // Clear bits after the end of the block.
+    if(count % 8 != 0)
+    {
+        selection[columns.bytes - 1] &= (uint8_t) ((1 << (count % 8)) - 1);
+    }
+}
+
+//
+// predicate evaluation
+//
+
+bool predicate::matches(const record& rec)const
+{
+    switch(type())
+    {
+    case COMPARE:
+    {
+        if(!rec.has(field()))
+        {
+            return false;
+        }
+        const value_t& val = rec.get(field());
+        switch(val.type())
+        {
+        case CDB_DT_BOOLEAN: return compare_value(std::get<bool>(val), op(), value());
+        case CDB_DT_SIGNED_8: return compare_value(std::get<int8_t>(val), op(), value());
+        case CDB_DT_UNSIGNED_8: return compare_value(std::get<uint8_t>(val), op(), value());
+        case CDB_DT_SIGNED_16: return compare_value(std::get<int16_t>(val), op(), value());
+        case CDB_DT_UNSIGNED_16: return compare_value(std::get<uint16_t>(val), op(), value());
+        case CDB_DT_SIGNED_32: return compare_value(std::get<int32_t>(val), op(), value());
+        case CDB_DT_UNSIGNED_32: return compare_value(std::get<uint32_t>(val), op(), value());
+        case CDB_DT_SIGNED_64: return compare_value(std::get<int64_t>(val), op(), value());
+        case CDB_DT_UNSIGNED_64: return compare_value(std::get<uint64_t>(val), op(), value());
+        case CDB_DT_FLOAT_4: return compare_value(std::get<float>(val), op(), value());
+        case CDB_DT_FLOAT_8: return compare_value(std::get<double>(val), op(), value());
+        default: return false;
+        }
+    }
+    case IS_NULL:
+        return !rec.has(field());
+    case IS_NOT_NULL:
+        return rec.has(field());
+    case AND:
+        return left().matches(rec) && right().matches(rec);
+    case OR:
+        return left().matches(rec) || right().matches(rec);
+    }
+    return false;
+}
+
+void predicate::evaluate(size_t count, const column_source& source, uint8_t* selection)const
+{
+    // Compiled once for all evaluations, all columns being provided as double.
+    std::call_once(_node->compiled_once, [this]() {
+        std::vector<field_index_t> referenced = fields();
+        std::vector<data_type> types(*std::max_element(referenced.begin(), referenced.end()) + 1, CDB_DT_FLOAT_8);
+        _node->compiled.reset(new compiled_predicate(*this, types));
+    });
+    _node->compiled->evaluate(count, [&](field_index_t field, data_type /*type*/, const uint8_t*& validity) {
+            return (const void*) source(field, validity);
+        }, selection);
+}
+
+} // namespace cyclic
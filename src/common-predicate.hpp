@@ -0,0 +1,215 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-predicate.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CYCLIC_COMMON_PREDICATE_HPP_
+#define _CYCLIC_COMMON_PREDICATE_HPP_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common-base.hpp"
+
+namespace cyclic
+{
+    /**
+     * Condition on field values of a record, as in 'errors > 0 and host is not null'.
+     * Predicates are immutable trees of conditions, cheap to copy.
+     * They can be evaluated on a single record, or on blocks of decoded column values.
+     * Tables compile them for their field types (see compiled_predicate) while scanning.
+     * A comparison with a null value is always false.
+     */
+    class predicate
+    {
+    public:
+        /**
+         * Kind of predicate node.
+         */
+        enum kind
+        {
+            COMPARE,     ///< Compare a field to a constant.
+            IS_NULL,     ///< Test if a field has no value.
+            IS_NOT_NULL, ///< Test if a field has a value.
+            AND,         ///< Both sub-predicates are true.
+            OR           ///< At least one of sub-predicates is true.
+        };
+
+        /**
+         * Comparison operator.
+         */
+        enum comparison
+        {
+            EQUAL,         ///< field == value
+            NOT_EQUAL,     ///< field != value
+            LESS,          ///< field < value
+            LESS_EQUAL,    ///< field <= value
+            GREATER,       ///< field > value
+            GREATER_EQUAL  ///< field >= value
+        };
+
+        /**
+         * Provider of decoded column values, for block evaluation.
+         * Shall return an array of values of the field for the evaluated block,
+         * and set validity to its validity bitmap (bit (i % 8) of byte (i / 8) set if value i is not null).
+         */
+        typedef std::function<const double*(field_index_t field, const uint8_t*& validity)> column_source;
+
+        /**
+         * Create a comparison of a field to a constant.
+         * @param field Index of the field to compare.
+         * @param op Comparison operator.
+         * @param value Value to compare to.
+         * @return Predicate.
+         */
+        static predicate compare(field_index_t field, comparison op, double value);
+
+        /**
+         * Create a test of absence of value of a field.
+         * @param field Index of the field to test.
+         * @return Predicate.
+         */
+        static predicate is_null(field_index_t field);
+
+        /**
+         * Create a test of presence of value of a field.
+         * @param field Index of the field to test.
+         * @return Predicate.
+         */
+        static predicate is_not_null(field_index_t field);
+
+        /**
+         * Combine with another predicate, both shall be true.
+         * @param other Other predicate.
+         * @return Combined predicate.
+         */
+        predicate operator&&(const predicate& other)const;
+
+        /**
+         * Combine with another predicate, at least one shall be true.
+         * @param other Other predicate.
+         * @return Combined predicate.
+         */
+        predicate operator||(const predicate& other)const;
+
+        /** Kind of the predicate node. */
+        kind type()const;
+        /** Compared or tested field (COMPARE, IS_NULL and IS_NOT_NULL nodes). */
+        field_index_t field()const;
+        /** Comparison operator (COMPARE nodes). */
+        comparison op()const;
+        /** Compared value (COMPARE nodes). */
+        double value()const;
+        /** First sub-predicate (AND and OR nodes). */
+        predicate left()const;
+        /** Second sub-predicate (AND and OR nodes). */
+        predicate right()const;
+
+        /**
+         * Retrieve the fields referenced by the predicate.
+         * @return Field indexes, without duplicates.
+         */
+        std::vector<field_index_t> fields()const;
+
+        /**
+         * Evaluate the predicate on a record.
+         * Values are compared in their own type, as compiled predicates do.
+         * @param rec Record to test.
+         * @return True if the record matches the predicate.
+         */
+        bool matches(const record& rec)const;
+
+        /**
+         * Evaluate the predicate on a block of records, whose values are provided as double.
+         * Columns are requested from the source at most once per referenced field.
+         * The predicate is compiled on first evaluation, and shared by its copies.
+         * @see compiled_predicate to evaluate values in their stored type.
+         * @param count Number of records in the block.
+         * @param source Provider of column values of the block.
+         * @param selection Bitmap of ((count - 1) / 8 + 1) bytes,
+         * bit (i % 8) of byte (i / 8) is set if record i matches the predicate.
+         */
+        void evaluate(size_t count, const column_source& source, uint8_t* selection)const;
+
+    private:
+        struct node;
+        std::shared_ptr<const node> _node;
+
+        predicate(std::shared_ptr<const node> node):_node(node){}
+    };
+
+    /**
+     * Predicate compiled for the field types of a table.
+     * Each condition is instantiated for the type of its field, its constant converted
+     * once to this type (conditions which cannot be true or false whatever the value, like
+     * 'x < 300' for a 8-bits field, are folded). Values are then compared in their stored
+     * type, without conversion nor precision loss, a block of records at a time.
+     */
+    class compiled_predicate
+    {
+    public:
+        /**
+         * Provider of column values, for block evaluation.
+         * Shall return an array of values of the field for the evaluated block, in the requested type,
+         * and set validity to its validity bitmap (bit (i % 8) of byte (i / 8) set if value i is not null).
+         */
+        typedef std::function<const void*(field_index_t field, data_type type, const uint8_t*& validity)> column_source;
+
+        /**
+         * Compile a predicate.
+         * @param pred Predicate to compile.
+         * @param types Types of fields, indexed by field index.
+         * @throw std::out_of_range if the predicate references a field without type.
+         * @throw std::invalid_argument if a referenced field type is not a value type.
+         */
+        compiled_predicate(const predicate& pred, const std::vector<data_type>& types);
+        /** Move constructor. */
+        compiled_predicate(compiled_predicate&& other);
+        /** Destructor. */
+        ~compiled_predicate();
+
+        /**
+         * Retrieve the fields referenced by the predicate.
+         * @return Field indexes, without duplicates.
+         */
+        const std::vector<field_index_t>& fields()const {return _fields;}
+
+        /**
+         * Evaluate the predicate on a block of records.
+         * Columns are requested from the source once per referenced field.
+         * @param count Number of records in the block.
+         * @param source Provider of column values of the block.
+         * @param selection Bitmap of ((count - 1) / 8 + 1) bytes,
+         * bit (i % 8) of byte (i / 8) is set if record i matches the predicate.
+         */
+        void evaluate(size_t count, const column_source& source, uint8_t* selection)const;
+
+        /** Compiled operator. */
+        struct op;
+        /** Columns of an evaluated block. */
+        struct block;
+
+    private:
+        std::vector<field_index_t> _fields;
+        std::vector<data_type> _types;
+        std::unique_ptr<op> _root;
+    };
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_PREDICATE_HPP_
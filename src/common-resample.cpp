@@ -0,0 +1,192 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-resample.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-resample.hpp"
+
+#include <stdexcept>
+
+namespace cyclic
+{
+
+//
+// column_chunk
+//
+
+void column_chunk::clear(int64_t start, int64_t step)
+{
+    this->start = start;
+    this->step = step;
+    values.clear();
+    validity.clear();
+}
+
+void column_chunk::push_back(bool valid, double value)
+{
+    size_t n = values.size();
+    if(n % 8 == 0)
+    {
+        validity.push_back(0);
+    }
+    values.push_back(valid ? value : 0);
+    if(valid)
+    {
+        validity[n / 8] |= (uint8_t) (1 << (n % 8));
+    }
+}
+
+//
+// resampler
+//
+
+resampler::resampler(int64_t start, int64_t end, int64_t duration, resample_method method, int64_t source_duration,
+        size_t chunk_size):
+_end(end),
+_duration(duration),
+_method(method),
+_source_duration(source_duration),
+_chunk_size(chunk_size),
+_next(start)
+{
+    if(duration <= 0)
+    {
+        throw std::invalid_argument{"Resampling duration must be positive."};
+    }
+    if(end < start)
+    {
+        throw std::invalid_argument{"End time cannot be lower than start time."};
+    }
+    if(chunk_size == 0)
+    {
+        throw std::invalid_argument{"Resampled chunk size must be positive."};
+    }
+    _pending.clear(start, duration);
+}
+
+void resampler::push(const int64_t* times, const double* values, const uint8_t* validity, size_t count, const chunk_handler& fn)
+{
+    for(size_t n = 0; n < count && !done(); ++n)
+    {
+        if(validity == nullptr || (validity[n / 8] & (1 << (n % 8))))
+        {
+            push(times[n], values[n], fn);
+        }
+    }
+    flush(fn);
+}
+
+void resampler::push(const column_chunk& in, const chunk_handler& fn)
+{
+    for(size_t n = 0; n < in.size() && !done(); ++n)
+    {
+        if(in.valid(n))
+        {
+            push(in.time(n), in.values[n], fn);
+        }
+    }
+    flush(fn);
+}
+
+void resampler::push(int64_t time, double value, const chunk_handler& fn)
+{
+    // Points before the sample lie between the last sample and this one.
+    while(_next < time && _next <= _end)
+    {
+        if(!_has_last)
+        {
+            emit(_method == resample_method::nearest, value, fn);
+            continue;
+        }
+        switch(_method)
+        {
+        case resample_method::none:
+            emit(_next < _last_time + _source_duration, _last_value, fn);
+            break;
+        case resample_method::previous:
+            emit(true, _last_value, fn);
+            break;
+        case resample_method::linear:
+            emit(true, _last_value + (value - _last_value) * (double) (_next - _last_time) / (double) (time - _last_time), fn);
+            break;
+        case resample_method::nearest:
+            emit(true, _next - _last_time <= time - _next ? _last_value : value, fn);
+            break;
+        }
+    }
+    // A point at the sample time takes its value, whatever the method.
+    if(_next == time && _next <= _end)
+    {
+        emit(true, value, fn);
+    }
+    _has_last = true;
+    _last_time = time;
+    _last_value = value;
+}
+
+void resampler::emit_trailing(const chunk_handler& fn)
+{
+    if(!_has_last)
+    {
+        emit(false, 0, fn);
+        return;
+    }
+    switch(_method)
+    {
+    case resample_method::none:
+        emit(_next < _last_time + _source_duration, _last_value, fn);
+        break;
+    case resample_method::previous:
+    case resample_method::nearest:
+        emit(true, _last_value, fn);
+        break;
+    case resample_method::linear:
+        emit(false, 0, fn);
+        break;
+    }
+}
+
+void resampler::emit(bool valid, double value, const chunk_handler& fn)
+{
+    _pending.push_back(valid, value);
+    _next += _duration;
+    if(_pending.size() == _chunk_size)
+    {
+        flush(fn);
+    }
+}
+
+void resampler::flush(const chunk_handler& fn)
+{
+    if(!_pending.empty())
+    {
+        fn(_pending);
+    }
+    _pending.clear(_next, _duration);
+}
+
+void resampler::finish(const chunk_handler& fn)
+{
+    while(!done())
+    {
+        emit_trailing(fn);
+    }
+    flush(fn);
+}
+
+} // namespace cyclic
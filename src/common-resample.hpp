@@ -0,0 +1,214 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-resample.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CYCLIC_COMMON_RESAMPLE_HPP_
+#define _CYCLIC_COMMON_RESAMPLE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace cyclic
+{
+    /**
+     * Values of a column at regular time points.
+     * Values are decoded as doubles, with a validity bitmap, so chunks can be
+     * passed directly to aggregate_values() or to another resampler.
+     */
+    struct column_chunk
+    {
+        /** Time of the first value. */
+        int64_t start = 0;
+        /** Time between two consecutive values. */
+        int64_t step = 0;
+        /** Values, meaningless where not valid. */
+        std::vector<double> values;
+        /** Validity bitmap, bit (i % 8) of byte (i / 8) is set if values[i] is valid. */
+        std::vector<uint8_t> validity;
+
+        /**
+         * Retrieve the number of values.
+         * @return Number of values.
+         */
+        size_t size()const {return values.size();}
+        /**
+         * Test if there is no value.
+         * @return True if there is no value.
+         */
+        bool empty()const {return values.empty();}
+        /**
+         * Retrieve the time of a value.
+         * @param n Offset of the value.
+         * @return Time of the value.
+         */
+        int64_t time(size_t n)const {return start + (int64_t) n * step;}
+        /**
+         * Test if a value is valid.
+         * @param n Offset of the value.
+         * @return True if the value is valid.
+         */
+        bool valid(size_t n)const {return (validity[n / 8] & (1 << (n % 8))) != 0;}
+
+        /**
+         * Forget all values.
+         * @param start Time of the next first value.
+         * @param step Time between values.
+         */
+        void clear(int64_t start, int64_t step);
+        /**
+         * Append a value.
+         * @param valid False if the value is null.
+         * @param value Value, ignored if null.
+         */
+        void push_back(bool valid, double value = 0);
+    };
+
+    /**
+     * Methods computing values at resampled time points.
+     */
+    enum class resample_method
+    {
+        /** Value of the sample covering the time point (its time, plus source duration), null otherwise. */
+        none,
+        /** Value of the last sample at or before the time point. */
+        previous,
+        /** Linear interpolation between the samples around the time point. */
+        linear,
+        /** Value of the closest sample, the previous one on ties. */
+        nearest
+    };
+
+    /**
+     * Streaming resampling operator.
+     * It consumes samples (time, value) in increasing time order, by chunks, and emits
+     * chunks of values at regular time points start, start + duration, ... up to end.
+     * Null samples are ignored, resampled points without a value are null.
+     * A point is emitted as soon as the samples needed to compute it are known,
+     * remaining ones are emitted by finish() when there is no more sample.
+     * Emitted chunks hold at most chunk_size points, a long gap between samples
+     * or a long range after the last one being emitted as several chunks.
+     */
+    class resampler
+    {
+    public:
+        /** Default maximum number of points of emitted chunks. */
+        static constexpr size_t default_chunk_size = 4096;
+
+        /** Function called with each emitted chunk, in time order. */
+        typedef std::function<void(const column_chunk&)> chunk_handler;
+
+        /**
+         * Create a resampler.
+         * @param start Time of the first resampled point.
+         * @param end Upper bound of resampled points (inclusive).
+         * @param duration Time between resampled points.
+         * @param method Method computing resampled values.
+         * @param source_duration Duration covered by each sample, for the none method, 0 for instant samples.
+         * @param chunk_size Maximum number of points of emitted chunks.
+         * @throw std::invalid_argument If duration is not positive, end is lower than start or chunk_size is 0.
+         */
+        resampler(int64_t start, int64_t end, int64_t duration, resample_method method, int64_t source_duration = 0,
+                size_t chunk_size = default_chunk_size);
+
+        /**
+         * Consume samples.
+         * @param times Sample times, in increasing order, after those of previous samples.
+         * @param values Sample values.
+         * @param validity Validity bitmap, bit (i % 8) of byte (i / 8) is set if values[i] is valid.
+         * Can be nullptr if all values are valid.
+         * @param count Number of samples.
+         * @param fn Function called with chunks of points which can be computed with these samples, if any.
+         */
+        void push(const int64_t* times, const double* values, const uint8_t* validity, size_t count, const chunk_handler& fn);
+
+        /**
+         * Consume samples of a chunk, typically emitted by another resampler.
+         * @param in Samples.
+         * @param fn Function called with chunks of points which can be computed with these samples, if any.
+         */
+        void push(const column_chunk& in, const chunk_handler& fn);
+
+        /**
+         * Emit all remaining points, there is no more sample.
+         * @param fn Function called with chunks of remaining points, if any.
+         */
+        void finish(const chunk_handler& fn);
+
+        /**
+         * Test if all points have been emitted.
+         * @return True if there is no more point to emit.
+         */
+        bool done()const {return _next > _end;}
+
+        /**
+         * Retrieve the time of the next point to emit.
+         * @return Time of the next point.
+         */
+        int64_t next()const {return _next;}
+
+    protected:
+        /**
+         * Consume a valid sample.
+         * @param time Sample time.
+         * @param value Sample value.
+         * @param fn Function called with full chunks.
+         */
+        void push(int64_t time, double value, const chunk_handler& fn);
+
+        /**
+         * Compute the next point from the last sample before it, without following sample.
+         * @param fn Function called with full chunks.
+         */
+        void emit_trailing(const chunk_handler& fn);
+
+        /**
+         * Append the next point to the pending chunk, and pass the chunk on if full.
+         * @param valid False if the point is null.
+         * @param value Value, ignored if null.
+         * @param fn Function called with the chunk if full.
+         */
+        void emit(bool valid, double value, const chunk_handler& fn);
+
+        /**
+         * Pass the pending chunk on, if not empty.
+         * @param fn Function called with the chunk.
+         */
+        void flush(const chunk_handler& fn);
+
+        int64_t _end;
+        int64_t _duration;
+        resample_method _method;
+        int64_t _source_duration;
+        size_t _chunk_size;
+        /** Time of the next point to emit. */
+        int64_t _next;
+        /** Points computed but not emitted yet. */
+        column_chunk _pending;
+
+        /** True if a valid sample has been consumed. */
+        bool _has_last = false;
+        /** Time of the last valid sample. */
+        int64_t _last_time = 0;
+        /** Value of the last valid sample. */
+        double _last_value = 0;
+    };
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_RESAMPLE_HPP_
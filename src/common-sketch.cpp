@@ -0,0 +1,305 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-sketch.cpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common-sketch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace cyclic
+{
+
+//
+// quantile_sketch::store
+//
+
+void quantile_sketch::store::extend(int64_t low, int64_t high)
+{
+    int64_t first = offset, last = offset + (int64_t) bins.size() - 1;
+    if(!bins.empty())
+    {
+        low = std::min(low, first);
+        high = std::max(high, last);
+    }
+    // Keep the highest bins, lower ones are collapsed in the lowest kept one.
+    low = std::max(low, high - (int64_t) max_bins + 1);
+    if(!bins.empty() && low == first)
+    {
+        bins.resize((size_t) (high - low + 1), 0);
+        return;
+    }
+    std::vector<uint64_t> res((size_t) (high - low + 1), 0);
+    for(size_t n = 0; n < bins.size(); ++n)
+    {
+        res[(size_t) (std::max(first + (int64_t) n, low) - low)] += bins[n];
+    }
+    bins.swap(res);
+    offset = low;
+}
+
+void quantile_sketch::store::add(int64_t key, uint64_t n)
+{
+    extend(key, key);
+    bins[(size_t) (std::max(key, offset) - offset)] += n;
+    count += n;
+}
+
+void quantile_sketch::store::merge(const store& other)
+{
+    if(other.bins.empty())
+    {
+        return;
+    }
+    // Grow once to cover both ranges, then add counts bin to bin.
+    extend(other.offset, other.offset + (int64_t) other.bins.size() - 1);
+    for(size_t n = 0; n < other.bins.size(); ++n)
+    {
+        bins[(size_t) (std::max(other.offset + (int64_t) n, offset) - offset)] += other.bins[n];
+    }
+    count += other.count;
+}
+
+//
+// quantile_sketch
+//
+
+quantile_sketch::quantile_sketch(double relative_accuracy):
+_accuracy(relative_accuracy)
+{
+    if(!(relative_accuracy > 0 && relative_accuracy < 1))
+    {
+        throw std::invalid_argument{"Sketch relative accuracy must be between 0 and 1."};
+    }
+    _gamma = (1 + relative_accuracy) / (1 - relative_accuracy);
+    _inv_log_gamma = 1 / std::log(_gamma);
+    // Keys of all finite values shall be representable.
+    if(!(_gamma > 1) || std::log(std::numeric_limits<double>::max()) * _inv_log_gamma >= std::ldexp(1.0, 62))
+    {
+        throw std::invalid_argument{"Sketch relative accuracy is too small."};
+    }
+}
+
+int64_t quantile_sketch::key(double value)const
+{
+    return (int64_t) std::ceil(std::log(value) * _inv_log_gamma);
+}
+
+double quantile_sketch::value(int64_t key)const
+{
+    return 2 * std::pow(_gamma, key) / (_gamma + 1);
+}
+
+void quantile_sketch::reset()
+{
+    _negative = store{};
+    _positive = store{};
+    _zero_count = 0;
+    _min = std::numeric_limits<double>::infinity();
+    _max = -std::numeric_limits<double>::infinity();
+    _sum = 0;
+}
+
+void quantile_sketch::add(double value, uint64_t count)
+{
+    if(!std::isfinite(value) || count == 0)
+    {
+        return;
+    }
+    if(value >= min_indexable())
+    {
+        _positive.add(key(value), count);
+    }
+    else if(value <= -min_indexable())
+    {
+        _negative.add(key(-value), count);
+    }
+    else
+    {
+        _zero_count += count;
+    }
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+    _sum += value * (double) count;
+}
+
+void quantile_sketch::add(const double* values, const uint8_t* validity, size_t count)
+{
+    for(size_t n = 0; n < count; ++n)
+    {
+        if(validity == nullptr || (validity[n / 8] & (1 << (n % 8))))
+        {
+            add(values[n]);
+        }
+    }
+}
+
+void quantile_sketch::merge(const quantile_sketch& other)
+{
+    if(other._accuracy != _accuracy)
+    {
+        throw std::invalid_argument{"Cannot merge sketches of different accuracies."};
+    }
+    _negative.merge(other._negative);
+    _positive.merge(other._positive);
+    _zero_count += other._zero_count;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+    _sum += other._sum;
+}
+
+double quantile_sketch::quantile(double q)const
+{
+    if(!(q >= 0 && q <= 1))
+    {
+        throw std::invalid_argument{"Quantile must be between 0 and 1."};
+    }
+    if(empty())
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Bins are walked in value order: negative ones from the highest absolute value,
+    // then zeros, then positive ones. The estimation is clamped to the exact extrema.
+    double rank = q * (double) (count() - 1);
+    double res = _max;
+    uint64_t seen = 0;
+    if(rank < (double) _negative.count)
+    {
+        for(size_t n = _negative.bins.size(); n-- > 0; )
+        {
+            seen += _negative.bins[n];
+            if((double) seen > rank)
+            {
+                res = -value(_negative.offset + (int64_t) n);
+                break;
+            }
+        }
+    }
+    else if(rank < (double) (_negative.count + _zero_count))
+    {
+        res = 0;
+    }
+    else
+    {
+        seen = _negative.count + _zero_count;
+        for(size_t n = 0; n < _positive.bins.size(); ++n)
+        {
+            seen += _positive.bins[n];
+            if((double) seen > rank)
+            {
+                res = value(_positive.offset + (int64_t) n);
+                break;
+            }
+        }
+    }
+    return std::max(_min, std::min(_max, res));
+}
+
+/**
+ * Append a number to a serialization buffer.
+ * @param out Serialization buffer.
+ * @param val Number to append.
+ */
+template<typename T>
+static void encode_value(std::vector<uint8_t>& out, T val)
+{
+    const uint8_t* ptr = reinterpret_cast<const uint8_t*>(&val);
+    out.insert(out.end(), ptr, ptr + sizeof(T));
+}
+
+/**
+ * Read a number from a serialization buffer.
+ * @param data Current position in the buffer, moved after the number.
+ * @param end End of the buffer.
+ * @return Number read.
+ * @throw std::invalid_argument If the buffer is too short.
+ */
+template<typename T>
+static T decode_value(const uint8_t*& data, const uint8_t* end)
+{
+    if((size_t) (end - data) < sizeof(T))
+    {
+        throw std::invalid_argument{"Truncated serialized sketch."};
+    }
+    T val;
+    std::memcpy(&val, data, sizeof(T));
+    data += sizeof(T);
+    return val;
+}
+
+std::vector<uint8_t> quantile_sketch::encode()const
+{
+    std::vector<uint8_t> out;
+    out.reserve(5 * 8 + 2 * 12 + (_negative.bins.size() + _positive.bins.size()) * 8);
+    encode_value(out, _accuracy);
+    encode_value(out, _zero_count);
+    encode_value(out, _min);
+    encode_value(out, _max);
+    encode_value(out, _sum);
+    for(const store* st : {&_negative, &_positive})
+    {
+        encode_value(out, st->offset);
+        encode_value(out, (uint32_t) st->bins.size());
+        for(uint64_t bin : st->bins)
+        {
+            encode_value(out, bin);
+        }
+    }
+    return out;
+}
+
+quantile_sketch quantile_sketch::decode(const uint8_t* data, size_t size)
+{
+    const uint8_t* end = data + size;
+    quantile_sketch res(decode_value<double>(data, end));
+    res._zero_count = decode_value<uint64_t>(data, end);
+    res._min = decode_value<double>(data, end);
+    res._max = decode_value<double>(data, end);
+    res._sum = decode_value<double>(data, end);
+    for(store* st : {&res._negative, &res._positive})
+    {
+        st->offset = decode_value<int64_t>(data, end);
+        uint32_t bins = decode_value<uint32_t>(data, end);
+        if(bins > store::max_bins)
+        {
+            throw std::invalid_argument{"Invalid serialized sketch bins."};
+        }
+        if((size_t) (end - data) / sizeof(uint64_t) < bins)
+        {
+            throw std::invalid_argument{"Truncated serialized sketch."};
+        }
+        st->bins.resize(bins);
+        for(uint64_t& bin : st->bins)
+        {
+            bin = decode_value<uint64_t>(data, end);
+            st->count += bin;
+        }
+    }
+    if(data != end)
+    {
+        throw std::invalid_argument{"Unexpected data after serialized sketch."};
+    }
+    return res;
+}
+
+} // namespace cyclic
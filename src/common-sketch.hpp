@@ -0,0 +1,218 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/common-sketch.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcycliccommon is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CYCLIC_COMMON_SKETCH_HPP_
+#define _CYCLIC_COMMON_SKETCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cyclic
+{
+    /**
+     * Mergeable summary of a distribution of values, answering quantile queries.
+     * Values are counted in logarithmic bins (DDSketch), so any quantile is estimated
+     * with a bounded relative error, whatever the distribution.
+     * Sketches built with the same accuracy can be merged without loss: the sketch of
+     * a union of values is the merge of the sketches of its parts.
+     * Memory is proportional to the logarithm of the range of magnitudes of values
+     * (about 230 bins per decade for 1% accuracy), not to the number of values.
+     * It is bounded by store::max_bins bins per sign: beyond, the bins of the lowest
+     * magnitudes are collapsed, so only quantiles among the lowest magnitudes lose accuracy.
+     */
+    class quantile_sketch
+    {
+    public:
+        /**
+         * Create an empty sketch.
+         * @param relative_accuracy Maximal relative error of quantile estimations.
+         * @throw std::invalid_argument If the accuracy is not strictly between 0 and 1,
+         * or too small for bin keys of all finite values to be represented.
+         */
+        explicit quantile_sketch(double relative_accuracy = 0.01);
+
+        /**
+         * Retrieve the accuracy of the sketch.
+         * @return Maximal relative error of quantile estimations.
+         */
+        double relative_accuracy()const {return _accuracy;}
+
+        /**
+         * Retrieve the number of values in the sketch.
+         * @return Number of values.
+         */
+        uint64_t count()const {return _negative.count + _zero_count + _positive.count;}
+
+        /**
+         * Test if the sketch has no value.
+         * @return True if no value has been added.
+         */
+        bool empty()const {return count() == 0;}
+
+        /**
+         * Retrieve the exact minimum of the values.
+         * @return Minimum, +infinity if empty.
+         */
+        double min()const {return _min;}
+
+        /**
+         * Retrieve the exact maximum of the values.
+         * @return Maximum, -infinity if empty.
+         */
+        double max()const {return _max;}
+
+        /**
+         * Retrieve the exact sum of the values.
+         * @return Sum of values.
+         */
+        double sum()const {return _sum;}
+
+        /** Forget all values. */
+        void reset();
+
+        /**
+         * Add a value.
+         * NaN and infinite values are ignored, they cannot be binned.
+         * @param value Value to add.
+         * @param count Number of occurrences of the value.
+         */
+        void add(double value, uint64_t count = 1);
+
+        /**
+         * Add a buffer of values.
+         * @param values Values to add.
+         * @param validity Validity bitmap, bit (i % 8) of byte (i / 8) is set if values[i] shall be added.
+         * Can be nullptr if all values are valid.
+         * @param count Number of values.
+         */
+        void add(const double* values, const uint8_t* validity, size_t count);
+
+        /**
+         * Add values of another sketch.
+         * @param other Sketch to merge.
+         * @throw std::invalid_argument If sketches have not the same accuracy.
+         */
+        void merge(const quantile_sketch& other);
+
+        /**
+         * Estimate a quantile of the values.
+         * @param q Quantile, between 0 (minimum) and 1 (maximum), 0.5 being the median.
+         * @return Estimation of the value of rank q * (count - 1), NaN if empty.
+         * @throw std::invalid_argument If q is not between 0 and 1.
+         */
+        double quantile(double q)const;
+
+        /**
+         * Serialize the sketch, to persist it.
+         * Numbers are in native byte order.
+         * @return Serialized sketch.
+         */
+        std::vector<uint8_t> encode()const;
+
+        /**
+         * Deserialize a sketch.
+         * @param data Serialized sketch, as returned by encode().
+         * @param size Size of serialized data.
+         * @return Sketch.
+         * @throw std::invalid_argument If data is not a valid serialized sketch.
+         */
+        static quantile_sketch decode(const uint8_t* data, size_t size);
+
+    protected:
+        /**
+         * Counts of contiguous bins.
+         * Bin of key k is at bins[k - offset].
+         * Keys lower than offset, when collapsed, are counted in the first bin.
+         */
+        struct store
+        {
+            /** Maximal number of bins. */
+            static constexpr size_t max_bins = 2048;
+
+            /** Key of the first bin. */
+            int64_t offset = 0;
+            /** Bin counts. */
+            std::vector<uint64_t> bins;
+            /** Sum of bin counts. */
+            uint64_t count = 0;
+
+            /**
+             * Add occurrences to a bin, growing bins as needed.
+             * @param key Key of the bin.
+             * @param n Number of occurrences.
+             */
+            void add(int64_t key, uint64_t n);
+
+            /**
+             * Grow bins to cover a range of keys, collapsing the lowest ones beyond max_bins.
+             * @param low Lowest key to cover.
+             * @param high Highest key to cover.
+             */
+            void extend(int64_t low, int64_t high);
+
+            /**
+             * Add bin counts of another store.
+             * @param other Store to merge.
+             */
+            void merge(const store& other);
+        };
+
+        /**
+         * Compute the key of the bin of a positive value.
+         * @param value Absolute value, at least min_indexable(), finite.
+         * @return Bin key.
+         */
+        int64_t key(double value)const;
+
+        /**
+         * Compute the representative value of a bin.
+         * @param key Bin key.
+         * @return Value whose relative error to any value of the bin is bounded by the accuracy.
+         */
+        double value(int64_t key)const;
+
+        /**
+         * Lowest absolute value counted in bins, lower ones are counted as zeros.
+         * @return Lowest indexable value.
+         */
+        static double min_indexable() {return std::numeric_limits<double>::min();}
+
+        /** Maximal relative error. */
+        double _accuracy;
+        /** Base of bin logarithm, (1 + accuracy) / (1 - accuracy). */
+        double _gamma;
+        /** Inverse of natural logarithm of gamma. */
+        double _inv_log_gamma;
+
+        /** Bins of negative values, by key of their absolute value. */
+        store _negative;
+        /** Bins of positive values. */
+        store _positive;
+        /** Number of values too close to zero to be indexed. */
+        uint64_t _zero_count = 0;
+
+        double _min = std::numeric_limits<double>::infinity();
+        double _max = -std::numeric_limits<double>::infinity();
+        double _sum = 0;
+    };
+
+} // namespace cyclic
+#endif // _CYCLIC_COMMON_SKETCH_HPP_
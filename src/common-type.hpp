@@ -134,6 +134,23 @@ namespace cyclic
 
 
 
+    /**
+     * Data type corresponding to a native type.
+     * @tparam T Native type, one of value_t acceptable types.
+     */
+    template<typename T> struct data_type_of;
+    template<> struct data_type_of<bool>     { static constexpr data_type value = CDB_DT_BOOLEAN; };
+    template<> struct data_type_of<int8_t>   { static constexpr data_type value = CDB_DT_SIGNED_8; };
+    template<> struct data_type_of<uint8_t>  { static constexpr data_type value = CDB_DT_UNSIGNED_8; };
+    template<> struct data_type_of<int16_t>  { static constexpr data_type value = CDB_DT_SIGNED_16; };
+    template<> struct data_type_of<uint16_t> { static constexpr data_type value = CDB_DT_UNSIGNED_16; };
+    template<> struct data_type_of<int32_t>  { static constexpr data_type value = CDB_DT_SIGNED_32; };
+    template<> struct data_type_of<uint32_t> { static constexpr data_type value = CDB_DT_UNSIGNED_32; };
+    template<> struct data_type_of<int64_t>  { static constexpr data_type value = CDB_DT_SIGNED_64; };
+    template<> struct data_type_of<uint64_t> { static constexpr data_type value = CDB_DT_UNSIGNED_64; };
+    template<> struct data_type_of<float>    { static constexpr data_type value = CDB_DT_FLOAT_4; };
+    template<> struct data_type_of<double>   { static constexpr data_type value = CDB_DT_FLOAT_8; };
+
     /**
      * Dataholder for storable values.
      * This class acts like a std::variant (or std::any) with conversion rules.
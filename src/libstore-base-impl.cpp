@@ -19,8 +19,12 @@
  */
 
 #include "libstore-base-impl.hpp"
+#include "common-predicate.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 
 namespace cyclic
@@ -30,6 +34,15 @@ namespace store
 namespace impl
 {
 
+/**
+ * Store a native value at a possibly unaligned address.
+ */
+template<typename T>
+static inline void store(uint8_t* ptr, T value)
+{
+    std::memcpy(ptr, &value, sizeof(T));
+}
+
 //
 // field_impl
 //
@@ -370,10 +383,12 @@ table_impl_state* base_table_impl::states[12]{
 
 base_table_impl::~base_table_impl()
 {
+    // Real implementations should already have stopped it.
+    stop_append_flusher();
 }
 
 void base_table_impl::create(const std::vector<field_st>& fields, record_index_t record_capacity,
-        record_time_t origin, record_time_t duration)
+        record_time_t origin, record_time_t duration, bool timestamped, table_options options)
 {
     if(fields.empty())
     {
@@ -383,21 +398,239 @@ void base_table_impl::create(const std::vector<field_st>& fields, record_index_t
     {
         throw std::invalid_argument{"record_capacity cannot be 0."};
     }
-    if(record_capacity==record::invalid_index())
+    _index_limit = (options & TABLE_WIDE_INDEX) ? record::absolute_max_index() : narrow_index_limit;
+    if(record_capacity >= _index_limit)
     {
         throw std::invalid_argument{"record_capacity cannot be invalid."};
     }
 
     _field_count = fields.size();
     _record_capacity = record_capacity;
+    if(options & TABLE_POW2_CAPACITY)
+    {
+        initialize_pow2_capacity();
+    }
 
-    _origin = origin;
-    _duration = duration;
+    _origin = timestamped ? 0 : origin;
+    _duration = timestamped ? 0 : duration;
 
+    // Fields are packed, in definition order, after the header bitmap.
     size_t index = 0;
+    uint16_t offset = 0;
     for(const field_st& f : fields)
     {
-        _fields.emplace_back(f.type, index++, f.name);
+        uint16_t size = field_size(f.type);
+        _fields.emplace_back(f.type, index++, f.name, size, offset);
+        offset += size;
+    }
+    uint32_t header_size = (_field_count - 1) / 8 + 1;
+    if(timestamped)
+    {
+        // The record timestamp follows the header bitmap.
+        initialize_layout(header_size + sizeof(record_time_t), header_size + sizeof(record_time_t) + offset, header_size);
+    }
+    else
+    {
+        initialize_layout(header_size, header_size + offset);
+    }
+}
+
+uint16_t base_table_impl::field_size(data_type type)
+{
+    switch(type)
+    {
+    case CDB_DT_BOOLEAN:
+    case CDB_DT_SIGNED_8:
+    case CDB_DT_UNSIGNED_8:
+        return 1;
+    case CDB_DT_SIGNED_16:
+    case CDB_DT_UNSIGNED_16:
+        return 2;
+    case CDB_DT_SIGNED_32:
+    case CDB_DT_UNSIGNED_32:
+        return 4;
+    case CDB_DT_SIGNED_64:
+    case CDB_DT_UNSIGNED_64:
+        return 8;
+    case CDB_DT_FLOAT_4:
+        return 4;
+    case CDB_DT_FLOAT_8:
+        return 8;
+    case CDB_DT_VOID:
+    case CDB_DT_UNSPECIFIED:
+    default:
+        return 0;
+    }
+}
+
+void base_table_impl::initialize_layout(uint32_t header_size, uint32_t record_size, uint32_t time_offset)
+{
+    _layout.header_size = header_size;
+    _layout.record_size = record_size;
+    _layout.time_offset = time_offset;
+    _layout.fields.clear();
+    _layout.fields.reserve(_fields.size());
+    for(const field_impl& field : _fields)
+    {
+        _layout.fields.push_back({field.type(), header_size + field.offset()});
+    }
+    initialize_field_lookup();
+}
+
+/**
+ * Encode a value at a possibly unaligned address.
+ * @param val Value to encode, not null.
+ * @param type Type to which convert the value.
+ * @param ptr Address of the encoded value, at least as big as the type size.
+ * @return False if the type is not supported.
+ */
+static bool encode_value(const value_t& val, data_type type, uint8_t* ptr)
+{
+    switch(type)
+    {
+    case CDB_DT_BOOLEAN:
+        *ptr = val.value<bool>() ? 1 : 0;
+        return true;
+    case CDB_DT_SIGNED_8:
+        store(ptr, val.value<int8_t>());
+        return true;
+    case CDB_DT_UNSIGNED_8:
+        store(ptr, val.value<uint8_t>());
+        return true;
+    case CDB_DT_SIGNED_16:
+        store(ptr, val.value<int16_t>());
+        return true;
+    case CDB_DT_UNSIGNED_16:
+        store(ptr, val.value<uint16_t>());
+        return true;
+    case CDB_DT_SIGNED_32:
+        store(ptr, val.value<int32_t>());
+        return true;
+    case CDB_DT_UNSIGNED_32:
+        store(ptr, val.value<uint32_t>());
+        return true;
+    case CDB_DT_SIGNED_64:
+        store(ptr, val.value<int64_t>());
+        return true;
+    case CDB_DT_UNSIGNED_64:
+        store(ptr, val.value<uint64_t>());
+        return true;
+    case CDB_DT_FLOAT_4:
+        store(ptr, val.value<float>());
+        return true;
+    case CDB_DT_FLOAT_8:
+        store(ptr, val.value<double>());
+        return true;
+    default:
+        // Unsupported type
+        return false;
+    }
+}
+
+void base_table_impl::encode_record(const record& rec, uint8_t* data) const
+{
+    std::memset(data, 0, _layout.record_size);
+    if(_layout.time_offset != 0)
+    {
+        store(data + _layout.time_offset, rec.time());
+    }
+    field_index_t count = std::min<field_index_t>(rec.size(), (field_index_t) _layout.fields.size());
+    for(field_index_t f = 0; f < count; ++f)
+    {
+        if(rec.has(f) && encode_value(rec[f], _layout.fields[f].type, data + _layout.fields[f].offset))
+        {
+            data[f / 8] |= (1 << (f % 8));
+        }
+    }
+}
+
+raw_record base_table_impl::decode_record(const uint8_t* data, record_index_t index) const
+{
+    raw_record rec {this, index};
+    record_view view{&_layout, data, index};
+    for(field_index_t f = 0; f < view.size(); ++f)
+    {
+        rec[f] = view.get(f);
+    }
+    if(_layout.time_offset != 0)
+    {
+        rec.time(record_view::load<record_time_t>(data + _layout.time_offset));
+    }
+    return rec;
+}
+
+record_time_t base_table_impl::slot_time(const uint8_t* data, record_index_t index) const
+{
+    if(_layout.time_offset != 0)
+    {
+        return record_view::load<record_time_t>(data + _layout.time_offset);
+    }
+    return _duration != 0 ? _origin + index * _duration : 0;
+}
+
+record_time_t base_table_impl::time_at_position(record_index_t pos) const
+{
+    if(const uint8_t* data = slot_data(pos))
+    {
+        return record_view::load<record_time_t>(data + _layout.time_offset);
+    }
+    std::vector<uint8_t> buffer(_layout.record_size);
+    read_slot(pos, buffer.data());
+    return record_view::load<record_time_t>(buffer.data() + _layout.time_offset);
+}
+
+void base_table_impl::check_timestamped_append(record_index_t index, record_time_t time) const
+{
+    if(_min_index == record::invalid_index())
+    {
+        return;
+    }
+    if(index != record::invalid_index() && index != _max_index + 1)
+    {
+        throw std::out_of_range{"Records of a timestamped table shall be appended just after the last record."};
+    }
+    if(time < time_at_position(_max_position))
+    {
+        throw std::invalid_argument{"Records of a timestamped table shall be appended in time order."};
+    }
+}
+
+const uint8_t* base_table_impl::slot_data(record_index_t /*pos*/) const
+{
+    // Not directly accessible by default
+    return nullptr;
+}
+
+void base_table_impl::read_slot(record_index_t pos, uint8_t* data) const
+{
+    encode_record(get_record_at_position(pos), data);
+}
+
+void base_table_impl::write_slot(record_index_t pos, const uint8_t* data)
+{
+    set_record_at_position(pos, decode_record(data, record::invalid_index()));
+}
+
+void base_table_impl::read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const
+{
+    std::vector<uint8_t> buffer(_layout.record_size);
+    read_slot(pos, buffer.data());
+    std::memcpy(data, buffer.data() + offset, size);
+}
+
+void base_table_impl::write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    std::vector<uint8_t> buffer(_layout.record_size);
+    read_slot(pos, buffer.data());
+    std::memcpy(buffer.data() + offset, data, size);
+    write_slot(pos, buffer.data());
+}
+
+void base_table_impl::read_slots(record_index_t pos, record_index_t count, uint8_t* data) const
+{
+    for(record_index_t n = 0; n < count; ++n)
+    {
+        read_slot(pos + n, data + (size_t) n * _layout.record_size);
     }
 }
 
@@ -422,14 +655,70 @@ const field_impl& base_table_impl::field(field_index_t field)const
 
 const cyclic::field& base_table_impl::field(const std::string& field_name)const
 {
+    field_index_t index = field_index(field_name);
+    if(index == field::invalid_index())
+    {
+        throw unknown_field{"Unknown field '" + field_name + "'."};
+    }
+    return _fields[index];
+}
+
+field_index_t base_table_impl::field_index(const std::string& field_name)const
+{
+    if(_field_lookup.empty())
+    {
+        return field::invalid_index();
+    }
+    uint32_t hash = hash_field_name(field_name);
+    size_t mask = _field_lookup.size() - 1;
+    for(size_t slot = hash & mask; ; slot = (slot + 1) & mask)
+    {
+        const field_slot& entry = _field_lookup[slot];
+        if(entry.index == field::invalid_index())
+        {
+            return field::invalid_index();
+        }
+        if(entry.hash == hash && _fields[entry.index].name_ref() == field_name)
+        {
+            return entry.index;
+        }
+    }
+}
+
+uint32_t base_table_impl::hash_field_name(const std::string& name)
+{
+    uint32_t hash = 2166136261u;
+    for(char c : name)
+    {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+void base_table_impl::initialize_field_lookup()
+{
+    // At most half full, so probing sequences stay short.
+    size_t size = 2;
+    while(size < _fields.size() * 2)
+    {
+        size <<= 1;
+    }
+    _field_lookup.assign(size, field_slot{0, field::invalid_index()});
     for(const field_impl& field : _fields)
     {
-        if(field.name() == field_name)
+        // The first field of a given name wins, as with a sequential lookup.
+        if(field_index(field.name_ref()) != field::invalid_index())
+        {
+            continue;
+        }
+        uint32_t hash = hash_field_name(field.name_ref());
+        size_t slot = hash & (size - 1);
+        while(_field_lookup[slot].index != field::invalid_index())
         {
-            return field;
+            slot = (slot + 1) & (size - 1);
         }
+        _field_lookup[slot] = field_slot{hash, field.index()};
     }
-    throw unknown_field{};
 }
 
 record_index_t base_table_impl::record_capacity() const
@@ -462,8 +751,38 @@ record_time_t base_table_impl::record_duration()const
     return _duration;
 }
 
+bool base_table_impl::timestamped()const
+{
+    return _layout.time_offset != 0;
+}
+
 record_index_t base_table_impl::record_index(record_time_t time)const
 {
+    if(timestamped())
+    {
+        lock_t lock{_mutex};
+        if(_min_index == record::invalid_index() || time < time_at_position(_min_position))
+        {
+            throw std::out_of_range{"Time before the first stored record."};
+        }
+        // Binary search of the last record not after the time point,
+        // records being stored in time order at consecutive positions (modulo capacity).
+        record_index_t low = _min_index, high = _max_index;
+        while(low < high)
+        {
+            record_index_t mid = low + (high - low + 1) / 2;
+            record_index_t pos = (record_index_t) (((uint64_t) _min_position + (mid - _min_index)) % _record_capacity);
+            if(time_at_position(pos) <= time)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+        return low;
+    }
     if(_duration == 0)
     {
         // Time points are not supported.
@@ -476,7 +795,7 @@ record_index_t base_table_impl::record_index(record_time_t time)const
         // TODO support negative time duration
     }
     record_time_t index = (time - _origin) / _duration;
-    if(index > record::absolute_max_index())
+    if((record_index_t) index > _index_limit)
     {
         // Time out of valid index range.
         throw std::out_of_range{"Time out of valid index range."};
@@ -486,6 +805,16 @@ record_index_t base_table_impl::record_index(record_time_t time)const
 
 record_time_t base_table_impl::record_time(record_index_t index)const
 {
+    if(timestamped())
+    {
+        lock_t lock{_mutex};
+        record_index_t pos = index_to_position(index);
+        if(pos == record::invalid_index())
+        {
+            throw std::out_of_range{"No record stored at this index."};
+        }
+        return time_at_position(pos);
+    }
     if(_duration == 0)
     {
         // Time points are not supported.
@@ -497,6 +826,12 @@ record_time_t base_table_impl::record_time(record_index_t index)const
 record_index_t base_table_impl::index_to_position(record_index_t index)const
 {
     lock_t lock{_mutex};
+    if(_pow2_capacity)
+    {
+        // One unsigned comparison checks both bounds.
+        bool stored = index - _min_index <= _max_index - _min_index && index != record::invalid_index();
+        return stored ? index & _position_mask : record::invalid_index();
+    }
     if(index < _min_index || index > _max_index) return record::invalid_index(); // Out of range index
     if(index == _min_index) return _min_position;
     if(index == _max_index) return _max_position;
@@ -526,6 +861,12 @@ record_index_t base_table_impl::position_to_index(record_index_t pos)const
     lock_t lock{_mutex};
     if(pos >= _record_capacity) return -2; // Position out of capacity
     if(_min_index == record::invalid_index() || _max_index == record::invalid_index()) return record::invalid_index(); // Not used position
+    if(_pow2_capacity)
+    {
+        // Distance from the last record, backward.
+        record_index_t back = (_max_position - pos) & _position_mask;
+        return back <= _max_index - _min_index ? _max_index - back : record::invalid_index();
+    }
     if(pos == _min_position) return _min_index;
     if(pos == _max_position) return _max_index;
 
@@ -598,6 +939,50 @@ const table_impl_state* base_table_impl::get_internal_state()const
     return states[get_internal_state_id()];
 }
 
+void base_table_impl::initialize_pow2_capacity()
+{
+    if((_record_capacity & (_record_capacity - 1)) != 0)
+    {
+        throw std::invalid_argument{"record_capacity shall be a power of two."};
+    }
+    _pow2_capacity = true;
+    _position_mask = _record_capacity - 1;
+}
+
+void base_table_impl::append_empty_records(record_index_t last)
+{
+    if(last - _max_index > _record_capacity)
+    {
+        // All records up to the gap would be dropped: restart from a single record,
+        // capacity records before the last one, without walking the gap.
+        _min_index = _max_index = last - _record_capacity;
+        _min_position = _max_position = _max_index % _record_capacity;
+        _first_index = _max_index - _max_position;
+    }
+    while(_max_index < last)
+    {
+        advance_max_index();
+        reset_record_at_position(_max_position);
+    }
+}
+
+void base_table_impl::advance_max_index()
+{
+    if(!_pow2_capacity)
+    {
+        get_internal_state()->do_append_record(*this);
+        return;
+    }
+    // The first record of an empty table is at index 0, position 0.
+    bool empty = _min_index == record::invalid_index();
+    _max_index = empty ? 0 : _max_index + 1;
+    _max_position = _max_index & _position_mask;
+    // The first record is forgotten when its slot is reused.
+    _min_index = empty ? 0 : _min_index + (record_index_t) (_max_index - _min_index > _position_mask);
+    _min_position = _min_index & _position_mask;
+    _first_index = _max_index - _max_position;
+}
+
 std::unique_ptr<mutable_record> base_table_impl::get_record()const
 {
     return std::unique_ptr<mutable_record>(new raw_record(this));
@@ -628,130 +1013,983 @@ std::unique_ptr<record> base_table_impl::get_record(record_time_t time)const
     return get_record(record_index(time));
 }
 
-void base_table_impl::set_record(const record& rec)
-{
-    set_record(rec.index(), rec);
-}
-
-void base_table_impl::set_record(record_index_t index, const record& rec)
+record_view base_table_impl::get_record_view(record_index_t index)const
 {
     lock_t lock{_mutex};
-    if(index == record::invalid_index())
+    record_index_t pos = index_to_position(index);
+    if(pos == record::invalid_index())
     {
-        // Bad parameter value
-        throw std::invalid_argument{"Index cannot be invalid."};
+        return record_view{};
     }
-
-    if(_min_index == record::invalid_index())
+    if(const uint8_t* data = slot_data(pos))
     {
-        // Empty table : cannot set a value to a record.
-        throw std::logic_error{"Cannot set a record on an empty table."};
+        return record_view{&_layout, data, index, slot_time(data, index)};
     }
-
-    if(index < _min_index || index > _max_index)
+    else
     {
-        // Index out of range.
-        throw std::out_of_range{"Cannot set a record at table out-of-range index."};
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>(_layout.record_size);
+        read_slot(pos, buffer->data());
+        record_time_t time = slot_time(buffer->data(), index);
+        return record_view{&_layout, std::shared_ptr<const std::vector<uint8_t>>{std::move(buffer)}, index, time};
     }
+}
 
-    record_index_t pos = index_to_position(index);
-    if(pos != record::invalid_index())
-    {
+record_view base_table_impl::get_record_view(record_time_t time)const
+{
+    return get_record_view(record_index(time));
+}
 
-        set_record_at_position(pos, rec);
-        write_table_index_descriptor(); // TODO Is really needed as we dont append new record ?
-    }
-    else
-    {
-        throw std::range_error{"Internal index computation error"};
+record_index_t base_table_impl::latest(record_index_t n, std::vector<record_view>& out)const
+{
+    lock_t lock{_mutex};
+    out.clear();
+    record_index_t count = std::min(n, record_count());
+    out.reserve(count);
+
+    // Records are stored at consecutive positions modulo the capacity, so they are
+    // read from the last position down to 0, then from the last storage position.
+    record_index_t index = _max_index;
+    record_index_t pos = _max_position;
+    while(out.size() < count)
+    {
+        record_index_t run = std::min<record_index_t>(count - out.size(), pos + 1);
+        record_index_t first = pos + 1 - run;
+        const uint8_t* slots = slot_data(first);
+        std::shared_ptr<const std::vector<uint8_t>> buffer;
+        if(slots == nullptr)
+        {
+            std::shared_ptr<std::vector<uint8_t>> copy = std::make_shared<std::vector<uint8_t>>((size_t) _layout.record_size * run);
+            read_slots(first, run, copy->data());
+            slots = copy->data();
+            buffer = std::move(copy);
+        }
+        for(record_index_t k = run; k-- > 0; --index)
+        {
+            const uint8_t* data = slots + (size_t) _layout.record_size * k;
+            out.emplace_back(&_layout, data, buffer, index, slot_time(data, index));
+        }
+        pos = _record_capacity - 1;
     }
+    return count;
 }
 
-void base_table_impl::set_record(record_time_t time, const record& rec)
+const record_layout& base_table_impl::layout()const
 {
-    set_record(record_index(time), rec);
+    return _layout;
 }
 
-void base_table_impl::update_record(const record& rec)
+/**
+ * Convert a run of encoded values of one field.
+ * @tparam S Stored type.
+ * @tparam T Requested type.
+ */
+template<typename S, typename T>
+static record_index_t convert_column_run(const uint8_t* slots, size_t record_size, size_t offset,
+        size_t flag_byte, uint8_t flag_mask, record_index_t count, T* out, uint8_t* null_bitmap, size_t bit)
 {
-    update_record(rec.index(), rec);
+    record_index_t res = 0;
+    for(record_index_t n = 0; n < count; ++n, slots += record_size)
+    {
+        if(slots[flag_byte] & flag_mask)
+        {
+            S value;
+            std::memcpy(&value, slots + offset, sizeof(S));
+            out[n] = static_cast<T>(value);
+            if(null_bitmap)
+            {
+                null_bitmap[(bit + n) / 8] |= (1 << ((bit + n) % 8));
+            }
+            ++res;
+        }
+    }
+    return res;
 }
 
-void base_table_impl::update_record(record_index_t index, const record& rec)
+/**
+ * Convert a run of encoded boolean values of one field.
+ * @tparam T Requested type.
+ */
+template<typename T>
+static record_index_t convert_column_run_bool(const uint8_t* slots, size_t record_size, size_t offset,
+        size_t flag_byte, uint8_t flag_mask, record_index_t count, T* out, uint8_t* null_bitmap, size_t bit)
 {
-    lock_t lock{_mutex};
-    if(index == record::invalid_index())
+    record_index_t res = 0;
+    for(record_index_t n = 0; n < count; ++n, slots += record_size)
     {
-        // Bad parameter value
-        throw std::invalid_argument{"Index cannot be invalid."};
+        if(slots[flag_byte] & flag_mask)
+        {
+            out[n] = static_cast<T>(slots[offset] != 0);
+            if(null_bitmap)
+            {
+                null_bitmap[(bit + n) / 8] |= (1 << ((bit + n) % 8));
+            }
+            ++res;
+        }
     }
+    return res;
+}
 
-    if(_min_index == record::invalid_index())
+template<typename T>
+record_index_t base_table_impl::read_column_as(field_index_t field, record_index_t first, record_index_t last,
+        T* out, uint8_t* null_bitmap, size_t bit) const
+{
+    // Maximum number of slots copied at once when storage is not directly accessible.
+    static constexpr record_index_t buffer_slots = 1024;
+
+    const record_layout::field_layout& fld = _layout.fields[field];
+    size_t record_size = _layout.record_size;
+    size_t flag_byte = field / 8;
+    uint8_t flag_mask = 1 << (field % 8);
+
+    std::vector<uint8_t> buffer;
+    record_index_t res = 0;
+    record_index_t index = first;
+    while(index <= last)
     {
-        // Empty table : cannot update a value to a record.
-        throw std::logic_error{"Cannot update a record on an empty table."};
+        // Consecutive indexes are stored at consecutive positions, until the end of storage.
+        record_index_t pos = index_to_position(index);
+        record_index_t count = std::min<record_index_t>(last - index + 1, _record_capacity - pos);
+
+        const uint8_t* slots = slot_data(pos);
+        if(slots == nullptr)
+        {
+            count = std::min(count, buffer_slots);
+            buffer.resize((size_t) count * record_size);
+            read_slots(pos, count, buffer.data());
+            slots = buffer.data();
+        }
+
+        T* dst = out + (index - first);
+        size_t dst_bit = bit + (index - first);
+        switch(fld.type)
+        {
+        case CDB_DT_BOOLEAN:
+            res += convert_column_run_bool<T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_SIGNED_8:
+            res += convert_column_run<int8_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_UNSIGNED_8:
+            res += convert_column_run<uint8_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_SIGNED_16:
+            res += convert_column_run<int16_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_UNSIGNED_16:
+            res += convert_column_run<uint16_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_SIGNED_32:
+            res += convert_column_run<int32_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_UNSIGNED_32:
+            res += convert_column_run<uint32_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_SIGNED_64:
+            res += convert_column_run<int64_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_UNSIGNED_64:
+            res += convert_column_run<uint64_t, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_FLOAT_4:
+            res += convert_column_run<float, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        case CDB_DT_FLOAT_8:
+            res += convert_column_run<double, T>(slots, record_size, fld.offset, flag_byte, flag_mask, count, dst, null_bitmap, dst_bit);
+            break;
+        default:
+            // Unsupported stored type, no value.
+            break;
+        }
+        index += count;
     }
+    return res;
+}
 
-    if(index < _min_index || index > _max_index)
+record_index_t base_table_impl::read_column(field_index_t field, record_index_t first, record_index_t last,
+        data_type type, void* out, uint8_t* null_bitmap) const
+{
+    if(field >= _layout.fields.size())
     {
-        // Index out of range.
-        throw std::out_of_range{"Cannot update a record at table out-of-range index."};
+        std::ostringstream stm;
+        stm << "Out of range field id (" << field << " / " << _layout.fields.size() << ") .";
+        throw std::out_of_range(stm.str());
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(type <= CDB_DT_VOID || type >= CDB_DT_MAX_TYPE)
+    {
+        throw std::invalid_argument{"Unsupported column type."};
     }
 
-    record_index_t pos = index_to_position(index);
-    if(pos != record::invalid_index())
+    size_t count = (size_t) last - first + 1;
+    std::memset(out, 0, count * field_size(type));
+    if(null_bitmap)
     {
-        update_record_at_position(pos, rec);
-        write_table_index_descriptor(); // TODO Is really needed as we dont append new record ?
+        std::memset(null_bitmap, 0, (count - 1) / 8 + 1);
     }
-    else
+
+    lock_t lock{_mutex};
+    if(_min_index == record::invalid_index() || last < _min_index || first > _max_index)
     {
-        throw std::range_error{"Internal index computation error"};
+        // No stored record in the range.
+        return 0;
     }
-}
 
-void base_table_impl::update_record(record_time_t time, const record& rec)
-{
-    update_record(record_index(time), rec);
+    // Only read stored records.
+    record_index_t from = std::max(first, _min_index);
+    record_index_t to = std::min(last, _max_index);
+    size_t skip = from - first;
+    switch(type)
+    {
+    case CDB_DT_BOOLEAN:
+        return read_column_as<bool>(field, from, to, (bool*) out + skip, null_bitmap, skip);
+    case CDB_DT_SIGNED_8:
+        return read_column_as<int8_t>(field, from, to, (int8_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_UNSIGNED_8:
+        return read_column_as<uint8_t>(field, from, to, (uint8_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_SIGNED_16:
+        return read_column_as<int16_t>(field, from, to, (int16_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_UNSIGNED_16:
+        return read_column_as<uint16_t>(field, from, to, (uint16_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_SIGNED_32:
+        return read_column_as<int32_t>(field, from, to, (int32_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_UNSIGNED_32:
+        return read_column_as<uint32_t>(field, from, to, (uint32_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_SIGNED_64:
+        return read_column_as<int64_t>(field, from, to, (int64_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_UNSIGNED_64:
+        return read_column_as<uint64_t>(field, from, to, (uint64_t*) out + skip, null_bitmap, skip);
+    case CDB_DT_FLOAT_4:
+        return read_column_as<float>(field, from, to, (float*) out + skip, null_bitmap, skip);
+    case CDB_DT_FLOAT_8:
+        return read_column_as<double>(field, from, to, (double*) out + skip, null_bitmap, skip);
+    default:
+        return 0;
+    }
 }
 
-void base_table_impl::append_record()
+aggregate_result base_table_impl::aggregate(field_index_t field, record_index_t first, record_index_t last,
+        aggregate_ops ops) const
 {
-    get_internal_state()->do_append_record(*this);
-    reset_record_at_position(_max_position);
-    write_table_index_descriptor();
-}
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
 
-void base_table_impl::append_record(record_index_t index)
-{
-    lock_t lock{_mutex};
-    if(index == record::invalid_index())
+    if(field >= _layout.fields.size())
     {
-        if(_min_index == record::invalid_index())
-            index = 0; // Table is empty, append to first record index.
-        else
-            index = _max_index + 1; // Table is not empty, append just after the last index.
+        std::ostringstream stm;
+        stm << "Out of range field id (" << field << " / " << _layout.fields.size() << ") .";
+        throw std::out_of_range(stm.str());
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
     }
 
-    if(_min_index != record::invalid_index() && index <= _max_index)
+    aggregate_result res;
+    lock_t lock{_mutex};
+    if(_min_index == record::invalid_index() || last < _min_index || first > _max_index)
     {
-        // Bad parameter value : intend to append before end of existing records.
-        // True only if table is not empty (otherwise _max_index is always upper than index).
-        throw std::out_of_range{"Cannot append a record before end of table."};
+        return res;
     }
+    record_index_t from = std::max(first, _min_index);
+    record_index_t to = std::min(last, _max_index);
 
-    do
+    std::vector<double> values(std::min<size_t>(chunk_size, (size_t) to - from + 1));
+    std::vector<uint8_t> validity((values.size() - 1) / 8 + 1);
+    for(record_index_t index = from; index <= to; )
     {
-        // Insert records up to correct index
-        get_internal_state()->do_append_record(*this);
+        record_index_t count = std::min<record_index_t>(to - index + 1, chunk_size);
+        read_column(field, index, index + count - 1, CDB_DT_FLOAT_8, values.data(), validity.data());
+        aggregate_values(values.data(), validity.data(), count, ops, res);
+        index += count;
+    }
+    return res;
+}
+
+/**
+ * Retrieve the validity bitmap of values beginning at an offset of a chunk.
+ * @param validity Validity bitmap of the chunk.
+ * @param offset Offset of the first value.
+ * @param count Number of values.
+ * @param buffer Buffer of at least ((count - 1) / 8 + 1) bytes, used when bits must be realigned.
+ * @return Validity bitmap of the values.
+ */
+static const uint8_t* validity_at(const uint8_t* validity, record_index_t offset, record_index_t count, uint8_t* buffer)
+{
+    if(offset % 8 == 0)
+    {
+        return validity + offset / 8;
+    }
+    std::memset(buffer, 0, (count - 1) / 8 + 1);
+    for(record_index_t i = 0; i < count; ++i)
+    {
+        record_index_t bit = offset + i;
+        if(validity[bit / 8] & (1 << (bit % 8)))
+        {
+            buffer[i / 8] |= (uint8_t) (1 << (i % 8));
+        }
+    }
+    return buffer;
+}
+
+std::vector<aggregate_bucket> base_table_impl::group_by(field_index_t field, record_index_t first, record_index_t last,
+        record_index_t bucket_size, aggregate_ops ops) const
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    if(field >= _layout.fields.size())
+    {
+        std::ostringstream stm;
+        stm << "Out of range field id (" << field << " / " << _layout.fields.size() << ") .";
+        throw std::out_of_range(stm.str());
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(bucket_size == 0)
+    {
+        throw std::invalid_argument{"Bucket size cannot be null."};
+    }
+
+    std::vector<aggregate_bucket> res;
+    lock_t lock{_mutex};
+    if(_min_index == record::invalid_index() || last < _min_index || first > _max_index)
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, _min_index);
+    record_index_t to = std::min(last, _max_index);
+    res.reserve(to / bucket_size - from / bucket_size + 1);
+
+    // Bucket ending at or after the specified record, clipped to the range.
+    auto bucket_last = [&](record_index_t index) {
+        return (record_index_t) std::min<uint64_t>(to, (uint64_t) index - index % bucket_size + bucket_size - 1);
+    };
+
+    // Single pass over the range: chunks are decoded once and split at bucket boundaries.
+    std::vector<double> values(std::min<size_t>(chunk_size, (size_t) to - from + 1));
+    std::vector<uint8_t> validity((values.size() - 1) / 8 + 1);
+    std::vector<uint8_t> realigned(validity.size());
+    aggregate_bucket bucket{from, bucket_last(from), {}};
+    for(record_index_t index = from; ; )
+    {
+        record_index_t count = std::min<record_index_t>(to - index + 1, chunk_size);
+        read_column(field, index, index + count - 1, CDB_DT_FLOAT_8, values.data(), validity.data());
+        for(record_index_t offset = 0; offset < count; )
+        {
+            record_index_t n = std::min<record_index_t>(count - offset, bucket.last - (index + offset) + 1);
+            aggregate_values(values.data() + offset, validity_at(validity.data(), offset, n, realigned.data()),
+                    n, ops, bucket.result);
+            offset += n;
+            if(index + offset - 1 == bucket.last)
+            {
+                res.push_back(bucket);
+                if(bucket.last == to)
+                {
+                    return res;
+                }
+                bucket = aggregate_bucket{bucket.last + 1, bucket_last(bucket.last + 1), {}};
+            }
+        }
+        index += count;
+    }
+}
+
+std::vector<sketch_bucket> base_table_impl::sketch_by(field_index_t field, record_index_t first, record_index_t last,
+        record_index_t bucket_size, double relative_accuracy) const
+{
+    // Number of records decoded at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    if(field >= _layout.fields.size())
+    {
+        std::ostringstream stm;
+        stm << "Out of range field id (" << field << " / " << _layout.fields.size() << ") .";
+        throw std::out_of_range(stm.str());
+    }
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+    if(bucket_size == 0)
+    {
+        throw std::invalid_argument{"Bucket size cannot be null."};
+    }
+
+    std::vector<sketch_bucket> res;
+    quantile_sketch empty(relative_accuracy);
+    lock_t lock{_mutex};
+    if(_min_index == record::invalid_index() || last < _min_index || first > _max_index)
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, _min_index);
+    record_index_t to = std::min(last, _max_index);
+    res.reserve(to / bucket_size - from / bucket_size + 1);
+
+    // Bucket ending at or after the specified record, clipped to the range.
+    auto bucket_last = [&](record_index_t index) {
+        return (record_index_t) std::min<uint64_t>(to, (uint64_t) index - index % bucket_size + bucket_size - 1);
+    };
+
+    // Single pass over the range, as group_by().
+    std::vector<double> values(std::min<size_t>(chunk_size, (size_t) to - from + 1));
+    std::vector<uint8_t> validity((values.size() - 1) / 8 + 1);
+    std::vector<uint8_t> realigned(validity.size());
+    res.push_back(sketch_bucket{from, bucket_last(from), empty});
+    for(record_index_t index = from; ; )
+    {
+        record_index_t count = std::min<record_index_t>(to - index + 1, chunk_size);
+        read_column(field, index, index + count - 1, CDB_DT_FLOAT_8, values.data(), validity.data());
+        for(record_index_t offset = 0; offset < count; )
+        {
+            sketch_bucket& bucket = res.back();
+            record_index_t n = std::min<record_index_t>(count - offset, bucket.last - (index + offset) + 1);
+            bucket.sketch.add(values.data() + offset, validity_at(validity.data(), offset, n, realigned.data()), n);
+            offset += n;
+            if(index + offset - 1 == bucket.last)
+            {
+                if(bucket.last == to)
+                {
+                    return res;
+                }
+                record_index_t next = bucket.last + 1;
+                res.push_back(sketch_bucket{next, bucket_last(next), empty});
+            }
+        }
+        index += count;
+    }
+}
+
+std::vector<record_index_t> base_table_impl::filter(const predicate& where, record_index_t first, record_index_t last) const
+{
+    // Number of records evaluated at once.
+    static constexpr record_index_t chunk_size = 4096;
+
+    std::vector<data_type> types;
+    for(const record_layout::field_layout& fld : _layout.fields)
+    {
+        types.push_back(fld.type);
+    }
+    compiled_predicate compiled(where, types);
+    if(last < first)
+    {
+        throw std::invalid_argument{"Last record index cannot be lower than first one."};
+    }
+
+    std::vector<record_index_t> res;
+    lock_t lock{_mutex};
+    if(_min_index == record::invalid_index() || last < _min_index || first > _max_index)
+    {
+        return res;
+    }
+    record_index_t from = std::max(first, _min_index);
+    record_index_t to = std::min(last, _max_index);
+
+    // Referenced columns are decoded block by block, in their stored type.
+    size_t block = std::min<size_t>(chunk_size, (size_t) to - from + 1);
+    std::vector<std::vector<uint64_t>> values(_layout.fields.size());
+    std::vector<std::vector<uint8_t>> validity(_layout.fields.size());
+    for(field_index_t field : compiled.fields())
+    {
+        values[field].resize(block);
+        validity[field].resize((block - 1) / 8 + 1);
+    }
+    std::vector<uint8_t> selection((block - 1) / 8 + 1);
+
+    for(record_index_t index = from; ; )
+    {
+        record_index_t count = std::min<record_index_t>(to - index + 1, chunk_size);
+        compiled.evaluate(count, [&](field_index_t field, data_type type, const uint8_t*& valid) {
+                read_column(field, index, index + count - 1, type, values[field].data(), validity[field].data());
+                valid = validity[field].data();
+                return (const void*) values[field].data();
+            }, selection.data());
+
+        for(record_index_t b = 0; b <= (count - 1) / 8; ++b)
+        {
+            for(uint8_t bits = selection[b]; bits != 0; bits &= (uint8_t) (bits - 1))
+            {
+                res.push_back(index + b * 8 + __builtin_ctz(bits));
+            }
+        }
+
+        if(to - index < chunk_size)
+        {
+            return res;
+        }
+        index += count;
+    }
+}
+
+void base_table_impl::set_record(const record& rec)
+{
+    set_record(rec.index(), rec);
+}
+
+void base_table_impl::set_record(record_index_t index, const record& rec)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    if(index == record::invalid_index())
+    {
+        // Bad parameter value
+        throw std::invalid_argument{"Index cannot be invalid."};
+    }
+
+    if(_min_index == record::invalid_index())
+    {
+        // Empty table : cannot set a value to a record.
+        throw std::logic_error{"Cannot set a record on an empty table."};
+    }
+
+    if(index < _min_index || index > _max_index)
+    {
+        // Index out of range.
+        throw std::out_of_range{"Cannot set a record at table out-of-range index."};
+    }
+
+    record_index_t pos = index_to_position(index);
+    if(pos != record::invalid_index())
+    {
+        if(timestamped())
+        {
+            // Records keep the time they have been appended with, so they stay in time order.
+            raw_record stamped{rec};
+            stamped.time(time_at_position(pos));
+            set_record_at_position(pos, stamped);
+        }
+        else
+        {
+            set_record_at_position(pos, rec);
+        }
+        update_continuous_aggregates(index);
+        write_table_index_descriptor(); // TODO Is really needed as we dont append new record ?
+    }
+    else
+    {
+        throw std::range_error{"Internal index computation error"};
+    }
+}
+
+void base_table_impl::set_record(record_time_t time, const record& rec)
+{
+    set_record(record_index(time), rec);
+}
+
+void base_table_impl::update_record(const record& rec)
+{
+    update_record(rec.index(), rec);
+}
+
+void base_table_impl::update_record(record_index_t index, const record& rec)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    if(index == record::invalid_index())
+    {
+        // Bad parameter value
+        throw std::invalid_argument{"Index cannot be invalid."};
+    }
+
+    if(_min_index == record::invalid_index())
+    {
+        // Empty table : cannot update a value to a record.
+        throw std::logic_error{"Cannot update a record on an empty table."};
+    }
+
+    if(index < _min_index || index > _max_index)
+    {
+        // Index out of range.
+        throw std::out_of_range{"Cannot update a record at table out-of-range index."};
+    }
+
+    record_index_t pos = index_to_position(index);
+    if(pos != record::invalid_index())
+    {
+        update_record_at_position(pos, rec);
+        update_continuous_aggregates(index);
+        write_table_index_descriptor(); // TODO Is really needed as we dont append new record ?
+    }
+    else
+    {
+        throw std::range_error{"Internal index computation error"};
+    }
+}
+
+void base_table_impl::update_record(record_time_t time, const record& rec)
+{
+    update_record(record_index(time), rec);
+}
+
+record_index_t base_table_impl::field_update_position(record_index_t index, field_index_t field) const
+{
+    if(index == record::invalid_index())
+    {
+        // Bad parameter value
+        throw std::invalid_argument{"Index cannot be invalid."};
+    }
+
+    if(_min_index == record::invalid_index())
+    {
+        // Empty table : cannot update a value to a record.
+        throw std::logic_error{"Cannot update a record on an empty table."};
+    }
+
+    if(index < _min_index || index > _max_index)
+    {
+        // Index out of range.
+        throw std::out_of_range{"Cannot update a record at table out-of-range index."};
+    }
+
+    if(field >= _layout.fields.size())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+
+    record_index_t pos = index_to_position(index);
+    if(pos == record::invalid_index())
+    {
+        throw std::range_error{"Internal index computation error"};
+    }
+    return pos;
+}
+
+void base_table_impl::write_field_at_position(record_index_t pos, field_index_t field, const value_t& value)
+{
+    // Value and header byte closer than this are written at once, with the bytes between them.
+    static constexpr uint32_t max_combined_span = 64;
+
+    const record_layout::field_layout& layout = _layout.fields[field];
+    uint32_t size = field_size(layout.type);
+    uint8_t bytes[sizeof(uint64_t)] = {0};
+    bool valid = value.has_value() && encode_value(value, layout.type, bytes);
+    uint32_t flag_byte = field / 8;
+    uint8_t flag_mask = (uint8_t) (1 << (field % 8));
+
+    uint32_t span = layout.offset + size - flag_byte;
+    if(layout.offset > flag_byte && span <= max_combined_span)
+    {
+        uint8_t slot[max_combined_span];
+        read_slot_bytes(pos, flag_byte, slot, span);
+        slot[0] = valid ? (uint8_t) (slot[0] | flag_mask) : (uint8_t) (slot[0] & ~flag_mask);
+        std::memcpy(slot + (layout.offset - flag_byte), bytes, size);
+        write_slot_bytes(pos, flag_byte, slot, span);
+        return;
+    }
+
+    write_slot_bytes(pos, layout.offset, bytes, size);
+    uint8_t bitmap;
+    read_slot_bytes(pos, flag_byte, &bitmap, 1);
+    uint8_t flagged = valid ? (uint8_t) (bitmap | flag_mask) : (uint8_t) (bitmap & ~flag_mask);
+    if(flagged != bitmap)
+    {
+        write_slot_bytes(pos, flag_byte, &flagged, 1);
+    }
+}
+
+void base_table_impl::set_field(record_index_t index, field_index_t field, const value_t& value)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    write_field_at_position(field_update_position(index, field), field, value);
+    update_continuous_aggregates(index);
+    // No index changed, the table index descriptor is left as is.
+}
+
+void base_table_impl::set_field(record_time_t time, field_index_t field, const value_t& value)
+{
+    set_field(record_index(time), field, value);
+}
+
+void base_table_impl::reset_field(record_index_t index, field_index_t field)
+{
+    set_field(index, field, value_t{});
+}
+
+void base_table_impl::reset_field(record_time_t time, field_index_t field)
+{
+    set_field(record_index(time), field, value_t{});
+}
+
+/**
+ * Accumulate a value in an encoded field.
+ * @param ptr Address of the encoded field value.
+ * @param has True if the field has a value.
+ * @param op Accumulation operation.
+ * @param value Value to accumulate.
+ */
+template<typename T>
+static void accumulate_value(uint8_t* ptr, bool has, accumulate_op op, const value_t& value)
+{
+    T curr = has ? record_view::load<T>(ptr) : T{};
+    switch(op)
+    {
+    case ACCUMULATE_ADD:
+        store(ptr, (T) (curr + value.value<T>()));
+        break;
+    case ACCUMULATE_MIN:
+        store(ptr, has ? std::min(curr, value.value<T>()) : value.value<T>());
+        break;
+    case ACCUMULATE_MAX:
+        store(ptr, has ? std::max(curr, value.value<T>()) : value.value<T>());
+        break;
+    case ACCUMULATE_LAST:
+        store(ptr, value.value<T>());
+        break;
+    case ACCUMULATE_COUNT:
+        store(ptr, (T) (curr + 1));
+        break;
+    }
+}
+
+void base_table_impl::accumulate(record_index_t index, field_index_t field, accumulate_op op, const value_t& value)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    if(timestamped())
+    {
+        throw std::logic_error{"Records of a timestamped table cannot be accumulated."};
+    }
+    if(index == record::invalid_index())
+    {
+        // Bad parameter value
+        throw std::invalid_argument{"Index cannot be invalid."};
+    }
+    if(field >= _layout.fields.size())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(_min_index != record::invalid_index() && index < _min_index)
+    {
+        throw std::out_of_range{"Cannot accumulate in a record before the first one."};
+    }
+    if(op != ACCUMULATE_COUNT && !value.has_value())
+    {
+        return;
+    }
+
+    if(index != _accumulator.index)
+    {
+        // The slot of the previous record is closed, open the one of the new record.
+        flush_accumulator();
+        if(_min_index == record::invalid_index() || index > _max_index)
+        {
+            do_append_slot(index);
+            reset_record_at_position(_max_position);
+            update_continuous_aggregates(_max_index);
+            write_table_index_descriptor();
+            notify_appended();
+        }
+        _accumulator.slot.resize(_layout.record_size);
+        read_slot(index_to_position(index), _accumulator.slot.data());
+        _accumulator.index = index;
+    }
+
+    const record_layout::field_layout& layout = _layout.fields[field];
+    uint8_t* ptr = _accumulator.slot.data() + layout.offset;
+    uint8_t& bitmap = _accumulator.slot[field / 8];
+    bool has = (bitmap & (1 << (field % 8))) != 0;
+    switch(layout.type)
+    {
+    case CDB_DT_BOOLEAN:
+        accumulate_value<bool>(ptr, has, op, value);
+        break;
+    case CDB_DT_SIGNED_8:
+        accumulate_value<int8_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_UNSIGNED_8:
+        accumulate_value<uint8_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_SIGNED_16:
+        accumulate_value<int16_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_UNSIGNED_16:
+        accumulate_value<uint16_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_SIGNED_32:
+        accumulate_value<int32_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_UNSIGNED_32:
+        accumulate_value<uint32_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_SIGNED_64:
+        accumulate_value<int64_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_UNSIGNED_64:
+        accumulate_value<uint64_t>(ptr, has, op, value);
+        break;
+    case CDB_DT_FLOAT_4:
+        accumulate_value<float>(ptr, has, op, value);
+        break;
+    case CDB_DT_FLOAT_8:
+        accumulate_value<double>(ptr, has, op, value);
+        break;
+    default:
+        // Unsupported type
+        return;
+    }
+    bitmap |= (uint8_t) (1 << (field % 8));
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(!_accumulator.dirty)
+    {
+        _accumulator.dirty = true;
+        _accumulator.since = now;
+        if(_accumulate_interval.count() > 0)
+        {
+            arm_accumulate_flush(now + _accumulate_interval);
+        }
+    }
+    if(now - _accumulator.since >= _accumulate_interval)
+    {
+        flush_accumulator();
+    }
+}
+
+void base_table_impl::accumulate(record_time_t time, field_index_t field, accumulate_op op, const value_t& value)
+{
+    accumulate(record_index(time), field, op, value);
+}
+
+void base_table_impl::configure_accumulate(std::chrono::milliseconds interval)
+{
+    lock_t lock{_mutex};
+    _accumulate_interval = interval;
+    flush_accumulator();
+}
+
+void base_table_impl::flush_expired_accumulator()
+{
+    if(!_accumulator.dirty)
+    {
+        return;
+    }
+    std::chrono::steady_clock::time_point deadline = _accumulator.since + _accumulate_interval;
+    if(std::chrono::steady_clock::now() >= deadline)
+    {
+        flush_accumulator();
+    }
+    else
+    {
+        arm_accumulate_flush(deadline);
+    }
+}
+
+void base_table_impl::arm_accumulate_flush(std::chrono::steady_clock::time_point deadline)
+{
+    {
+        std::lock_guard<std::mutex> lock{_append_mutex};
+        if(_append_stop)
+        {
+            return;
+        }
+        if(!_append_flusher.joinable())
+        {
+            _append_flusher = std::thread(&base_table_impl::run_append_flusher, this);
+        }
+        if(!_accumulate_armed || deadline < _accumulate_deadline)
+        {
+            _accumulate_armed = true;
+            _accumulate_deadline = deadline;
+        }
+    }
+    _append_not_empty.notify_one();
+}
+
+void base_table_impl::flush_accumulator()
+{
+    if(_accumulator.index == record::invalid_index())
+    {
+        return;
+    }
+    record_index_t index = _accumulator.index;
+    _accumulator.index = record::invalid_index();
+    if(_accumulator.dirty)
+    {
+        _accumulator.dirty = false;
+        write_slot(index_to_position(index), _accumulator.slot.data());
+        update_continuous_aggregates(index);
+        write_table_index_descriptor();
+    }
+}
+
+void base_table_impl::append_record()
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    if(timestamped())
+    {
+        throw std::logic_error{"Records of a timestamped table shall be appended with their time."};
+    }
+    if(_min_index != record::invalid_index() && _max_index >= _index_limit)
+    {
+        throw table_is_full{"Table is full, no more record can be append"};
+    }
+    advance_max_index();
+    reset_record_at_position(_max_position);
+    update_continuous_aggregates(_max_index);
+    write_table_index_descriptor();
+    notify_appended();
+}
+
+void base_table_impl::append_record(record_index_t index)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    if(timestamped())
+    {
+        throw std::logic_error{"Records of a timestamped table shall be appended with their time."};
+    }
+    if(index == record::invalid_index())
+    {
+        if(_min_index == record::invalid_index())
+            index = 0; // Table is empty, append to first record index.
+        else
+            index = _max_index + 1; // Table is not empty, append just after the last index.
+    }
+
+    if(_min_index != record::invalid_index() && index <= _max_index)
+    {
+        // Bad parameter value : intend to append before end of existing records.
+        // True only if table is not empty (otherwise _max_index is always upper than index).
+        throw std::out_of_range{"Cannot append a record before end of table."};
+    }
+
+    if(index > _index_limit)
+    {
+        throw table_is_full{"Table is full, no more record can be append"};
+    }
+
+    if(_min_index == record::invalid_index())
+    {
+        // Empty table, insert the first record.
+        advance_max_index();
         reset_record_at_position(_max_position);
-    }    while(_max_index < index);
-    // Note : do not test before inserting to be sure to insert a rec on empty tables.
+    }
+    // Insert records up to correct index
+    append_empty_records(index);
+    update_continuous_aggregates(_max_index);
     write_table_index_descriptor();
+    notify_appended();
 }
 
 void base_table_impl::append_record(record_time_t time)
 {
+    if(timestamped())
+    {
+        append_record(time, raw_record{this});
+        return;
+    }
     append_record(record_index(time));
 }
 
@@ -763,6 +2001,27 @@ void base_table_impl::append_record(const record& rec)
 void base_table_impl::append_record(record_index_t index, const record& rec)
 {
     lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    do_append_record(index, rec);
+    write_table_index_descriptor();
+    notify_appended();
+}
+
+record_index_t base_table_impl::do_append_record(record_index_t index, const record& rec)
+{
+    if(timestamped())
+    {
+        check_timestamped_append(index, rec.time());
+    }
+    index = do_append_slot(index);
+    set_record_at_position(_max_position, rec);
+    update_continuous_aggregates(index);
+    return index;
+}
+
+record_index_t base_table_impl::do_append_slot(record_index_t index)
+{
     // If the index is not set (invalid), append just after the last record
     if(index == record::invalid_index())
     {
@@ -780,10 +2039,9 @@ void base_table_impl::append_record(record_index_t index, const record& rec)
     else if(_min_index == record::invalid_index() && index == 0)
     {
         // Table is empty and inserting at first index
-        get_internal_state()->do_append_record(*this);
-        set_record_at_position(_max_position, rec);
+        advance_max_index();
     }
-    else if(_max_index == record::absolute_max_index())
+    else if(_max_index >= _index_limit || index > _index_limit)
     {
         // Table is full : max capacity reached
         throw table_is_full{"Table is full, no more record can be append"};
@@ -791,28 +2049,42 @@ void base_table_impl::append_record(record_index_t index, const record& rec)
     else
     {
         // Append empty rec before target index
-        while(_max_index < index - 1)
-        {
-            get_internal_state()->do_append_record(*this);
-            reset_record_at_position(_max_position);
-        }
+        append_empty_records(index - 1);
 
         // Append record at target index
-        //if(max_index() < index) // Shall be always true
-        //{
-        get_internal_state()->do_append_record(*this);
-        set_record_at_position(_max_position, rec);
-        //}
-
-        write_table_index_descriptor();
+        advance_max_index();
     }
+    return _max_index;
 }
 
 void base_table_impl::append_record(record_time_t time, const record& rec)
 {
+    if(timestamped())
+    {
+        raw_record stamped{rec};
+        stamped.time(time);
+        append_record(record::invalid_index(), stamped);
+        return;
+    }
     append_record(record_index(time), rec);
 }
 
+void base_table_impl::append_encoded(const uint8_t* data, record_index_t index)
+{
+    lock_t lock{_mutex};
+    check_writable();
+    flush_accumulator();
+    if(timestamped())
+    {
+        check_timestamped_append(index, record_view::load<record_time_t>(data + _layout.time_offset));
+    }
+    do_append_slot(index);
+    write_slot(_max_position, data);
+    update_continuous_aggregates(_max_index);
+    write_table_index_descriptor();
+    notify_appended();
+}
+
 void base_table_impl::insert_record(record_index_t index)
 {
     lock_t lock{_mutex};
@@ -836,6 +2108,16 @@ void base_table_impl::insert_record(record_index_t index)
 
 void base_table_impl::insert_record(record_time_t time)
 {
+    if(timestamped())
+    {
+        lock_t lock{_mutex};
+        if(_min_index == record::invalid_index() || time > time_at_position(_max_position))
+        {
+            // After the last record, append a record.
+            append_record(time);
+        }
+        return;
+    }
     insert_record(record_index(time));
 }
 
@@ -868,9 +2150,271 @@ void base_table_impl::insert_record(record_index_t index, const record& rec)
 
 void base_table_impl::insert_record(record_time_t time, const record& rec)
 {
+    if(timestamped())
+    {
+        lock_t lock{_mutex};
+        if(_min_index == record::invalid_index() || time > time_at_position(_max_position))
+        {
+            // After the last record, append a record.
+            append_record(time, rec);
+        }
+        else
+        {
+            // Set the record in effect at this time point.
+            set_record(record_index(time), rec);
+        }
+        return;
+    }
     insert_record(record_index(time), rec);
 }
 
+std::future<record_index_t> base_table_impl::append_async(const record& rec)
+{
+    check_writable();
+    std::unique_lock<std::mutex> lock{_append_mutex};
+    if(_append_stop)
+    {
+        throw std::logic_error{"Cannot append asynchronously to a closing table."};
+    }
+    if(!_append_flusher.joinable())
+    {
+        _append_flusher = std::thread(&base_table_impl::run_append_flusher, this);
+    }
+
+    if(_append_queue.size() >= _append_queue_capacity)
+    {
+        switch(_append_policy)
+        {
+        case APPEND_FAIL:
+            throw queue_is_full{"Asynchronous append queue is full."};
+        case APPEND_DROP_OLDEST:
+            while(_append_queue.size() >= _append_queue_capacity)
+            {
+                _append_queue.front().promise.set_exception(std::make_exception_ptr(
+                        queue_is_full{"Record dropped from a full asynchronous append queue."}));
+                _append_queue.pop_front();
+            }
+            break;
+        case APPEND_BLOCK:
+        default:
+            _append_not_full.wait(lock, [this]{return _append_queue.size() < _append_queue_capacity;});
+            break;
+        }
+    }
+
+    _append_queue.push_back(append_request{raw_record{rec}, std::promise<record_index_t>{}});
+    std::future<record_index_t> res = _append_queue.back().promise.get_future();
+    lock.unlock();
+    _append_not_empty.notify_one();
+    return res;
+}
+
+void base_table_impl::configure_append_queue(size_t capacity, append_policy policy)
+{
+    if(capacity == 0)
+    {
+        throw std::invalid_argument{"Append queue capacity cannot be 0."};
+    }
+    {
+        std::lock_guard<std::mutex> lock{_append_mutex};
+        _append_queue_capacity = capacity;
+        _append_policy = policy;
+    }
+    _append_not_full.notify_all();
+}
+
+void base_table_impl::flush()
+{
+    {
+        std::unique_lock<std::mutex> lock{_append_mutex};
+        _append_done.wait(lock, [this]{return _append_queue.empty() && _append_inflight == 0;});
+    }
+    lock_t lock{_mutex};
+    flush_accumulator();
+}
+
+void base_table_impl::run_append_flusher()
+{
+    std::vector<append_request> batch;
+    std::vector<std::exception_ptr> errors;
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock{_append_mutex};
+            auto ready = [this]{
+                return _append_stop || !_append_queue.empty()
+                        || (_accumulate_armed && std::chrono::steady_clock::now() >= _accumulate_deadline);
+            };
+            while(!ready())
+            {
+                if(_accumulate_armed)
+                {
+                    _append_not_empty.wait_until(lock, _accumulate_deadline);
+                }
+                else
+                {
+                    _append_not_empty.wait(lock);
+                }
+            }
+            if(_append_queue.empty())
+            {
+                if(_append_stop)
+                {
+                    // Stop requested and nothing more to write.
+                    // The accumulated record, if any, is written by the table when closed.
+                    return;
+                }
+                // Accumulation deadline reached.
+                _accumulate_armed = false;
+                lock.unlock();
+                try
+                {
+                    lock_t table_lock{_mutex};
+                    flush_expired_accumulator();
+                }
+                catch(...)
+                {
+                    // Retried at the next accumulation or modification.
+                }
+                continue;
+            }
+            batch.clear();
+            std::move(_append_queue.begin(), _append_queue.end(), std::back_inserter(batch));
+            _append_queue.clear();
+            _append_inflight = batch.size();
+        }
+        _append_not_full.notify_all();
+
+        // Write the whole batch with only one index descriptor update.
+        std::vector<record_index_t> indexes(batch.size(), record::invalid_index());
+        errors.assign(batch.size(), nullptr);
+        {
+            lock_t lock{_mutex};
+            for(size_t n = 0; n < batch.size(); ++n)
+            {
+                try
+                {
+                    flush_accumulator();
+                    indexes[n] = do_append_record(batch[n].rec.index(), batch[n].rec);
+                }
+                catch(...)
+                {
+                    errors[n] = std::current_exception();
+                }
+            }
+            try
+            {
+                write_table_index_descriptor();
+            }
+            catch(...)
+            {
+                std::exception_ptr err = std::current_exception();
+                for(std::exception_ptr& e : errors)
+                {
+                    if(!e) e = err;
+                }
+            }
+            notify_appended();
+        }
+
+        for(size_t n = 0; n < batch.size(); ++n)
+        {
+            if(errors[n])
+                batch[n].promise.set_exception(errors[n]);
+            else
+                batch[n].promise.set_value(indexes[n]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{_append_mutex};
+            _append_inflight = 0;
+        }
+        _append_done.notify_all();
+    }
+}
+
+void base_table_impl::stop_append_flusher()
+{
+    {
+        std::lock_guard<std::mutex> lock{_append_mutex};
+        _append_stop = true;
+    }
+    _append_not_empty.notify_all();
+    if(_append_flusher.joinable())
+    {
+        _append_flusher.join();
+    }
+}
+
+base_table_impl::subscription_t base_table_impl::subscribe(subscription_callback_t callback, record_index_t from_index)
+{
+    lock_t lock{_mutex};
+    subscription_t id = _next_subscription++;
+    if(from_index == record::invalid_index())
+    {
+        from_index = _max_index == record::invalid_index() ? 0 : _max_index + 1;
+    }
+    _subscribers.push_back(subscriber{id, callback, from_index});
+
+    // Notify already stored records.
+    if(_max_index != record::invalid_index() && from_index <= _max_index)
+    {
+        _subscribers.back().next = _max_index + 1;
+        callback(std::max(from_index, _min_index), _max_index);
+    }
+    return id;
+}
+
+void base_table_impl::unsubscribe(subscription_t subscription)
+{
+    lock_t lock{_mutex};
+    _subscribers.erase(std::remove_if(_subscribers.begin(), _subscribers.end(),
+            [subscription](const subscriber& sub){return sub.id == subscription;}),
+            _subscribers.end());
+}
+
+bool base_table_impl::wait_for_index(record_index_t index, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::recursive_mutex> lock{_mutex};
+    return _appended.wait_for(lock, timeout, [this, index]{
+        return _max_index != record::invalid_index() && _max_index >= index;
+    });
+}
+
+bool base_table_impl::refresh()
+{
+    // Nothing to refresh by default
+    return false;
+}
+
+void base_table_impl::notify_appended()
+{
+    if(_max_index == record::invalid_index() || _max_index == _notified_index)
+    {
+        return;
+    }
+    _notified_index = _max_index;
+    _appended.notify_all();
+
+    if(!_subscribers.empty())
+    {
+        // Work on a copy, callbacks may unsubscribe.
+        std::vector<subscriber> subscribers = _subscribers;
+        for(subscriber& sub : subscribers)
+        {
+            if(sub.next <= _max_index)
+            {
+                record_index_t first = std::max(sub.next, _min_index);
+                for(subscriber& live : _subscribers)
+                {
+                    if(live.id == sub.id) live.next = _max_index + 1;
+                }
+                sub.callback(first, _max_index);
+            }
+        }
+    }
+}
+
 void base_table_impl::update_record_at_position(record_index_t pos, const record& rec)
 {
     raw_record curr = get_record_at_position(pos);
@@ -878,6 +2422,79 @@ void base_table_impl::update_record_at_position(record_index_t pos, const record
     set_record_at_position(pos, curr);
 }
 
+base_table_impl::continuous_aggregate_t base_table_impl::add_continuous_aggregate(field_index_t field,
+        record_index_t window, aggregate_ops ops)
+{
+    lock_t lock{_mutex};
+    if(field >= _fields.size())
+    {
+        throw std::out_of_range{"Out of range field id."};
+    }
+    if(window == 0)
+    {
+        throw std::invalid_argument{"Window cannot be 0."};
+    }
+    // Records evicted from the table leave the window.
+    window = std::min(window, _record_capacity);
+    continuous_aggregate_state state{_next_continuous_aggregate++, field, rolling_aggregate{window, ops}};
+
+    // Aggregate records already stored in the window.
+    if(_min_index != record::invalid_index())
+    {
+        record_index_t first = _max_index - _min_index >= window ? _max_index - window + 1 : _min_index;
+        size_t count = _max_index - first + 1;
+        std::vector<double> values(count);
+        std::vector<uint8_t> validity(count / 8 + 1);
+        read_column(field, first, _max_index, CDB_DT_FLOAT_8, values.data(), validity.data());
+        for(size_t n = 0; n < count; ++n)
+        {
+            state.rolling.set(first + n, (validity[n / 8] >> (n % 8)) & 1, values[n]);
+        }
+    }
+
+    _continuous_aggregates.push_back(std::move(state));
+    return _continuous_aggregates.back().id;
+}
+
+aggregate_result base_table_impl::continuous_aggregate(continuous_aggregate_t id) const
+{
+    lock_t lock{_mutex};
+    for(const continuous_aggregate_state& state : _continuous_aggregates)
+    {
+        if(state.id == id)
+        {
+            return state.rolling.result();
+        }
+    }
+    throw std::invalid_argument{"Unknown continuous aggregate."};
+}
+
+void base_table_impl::remove_continuous_aggregate(continuous_aggregate_t id)
+{
+    lock_t lock{_mutex};
+    _continuous_aggregates.erase(std::remove_if(_continuous_aggregates.begin(), _continuous_aggregates.end(),
+            [id](const continuous_aggregate_state& state){ return state.id == id; }), _continuous_aggregates.end());
+}
+
+void base_table_impl::update_continuous_aggregates(record_index_t index)
+{
+    if(_continuous_aggregates.empty())
+    {
+        return;
+    }
+    record_view view = get_record_view(index);
+    for(continuous_aggregate_state& state : _continuous_aggregates)
+    {
+        bool valid = view && view.has(state.field);
+        state.rolling.set(index, valid, valid ? view.get<double>(state.field) : 0);
+    }
+}
+
+void base_table_impl::check_writable() const
+{
+    // Always writable by default
+}
+
 void base_table_impl::write_table_index_descriptor()
 {
     // Do nothing by default
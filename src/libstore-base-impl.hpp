@@ -23,9 +23,13 @@
 
 #include "libstore.hpp"
 
+#include <condition_variable>
+#include <deque>
+#include <limits>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace cyclic
@@ -92,6 +96,8 @@ public:
 
     virtual field_index_t index() const;
     virtual std::string name() const;
+    /** Name of the field, without copy. */
+    const std::string& name_ref() const {return _name;}
     virtual data_type type() const;
 
     virtual uint16_t size() const;
@@ -141,14 +147,120 @@ protected:
     /** Position of the last stored record. */
     record_index_t _max_position = record::invalid_index();
 
+    /**
+     * Greatest record index of tables without TABLE_WIDE_INDEX option.
+     * Their indexes fit in 32 bits, the invalid index being stored as the next value.
+     */
+    static constexpr record_index_t narrow_index_limit = std::numeric_limits<uint32_t>::max() - 2;
+    /** Greatest record index the table can store (inclusive). */
+    record_index_t _index_limit = narrow_index_limit;
+
+    /** True if capacity is a power of two and positions are computed by masking indexes. */
+    bool _pow2_capacity = false;
+    /** Mask of indexes giving their positions (capacity - 1), used only with power of two capacity. */
+    record_index_t _position_mask = 0;
+
     /** Stored field descriptors. */
     std::vector<field_impl> _fields;
+    /** Entry of the field name lookup table. */
+    struct field_slot
+    {
+        /** Hash of the field name. */
+        uint32_t hash;
+        /** Index of the field, field::invalid_index() for empty slots. */
+        field_index_t index;
+    };
+    /** Open-addressing (linear probing) field name lookup table, power of two sized. */
+    std::vector<field_slot> _field_lookup;
+    /** Binary encoding of records in storage slots. */
+    record_layout _layout;
 
     /** Concurrent access protection mutex. */
     mutable std::recursive_mutex _mutex;
     /** Alias for mutex guard. */
     typedef std::lock_guard<std::recursive_mutex> lock_t;
 
+    /** Record waiting in the asynchronous append queue. */
+    struct append_request
+    {
+        raw_record rec;
+        std::promise<record_index_t> promise;
+    };
+
+    /** Asynchronous append queue. */
+    std::deque<append_request> _append_queue;
+    /** Maximum number of records in the asynchronous append queue. */
+    size_t _append_queue_capacity = 1024;
+    /** Policy applied when the asynchronous append queue is full. */
+    append_policy _append_policy = APPEND_BLOCK;
+    /** Number of records currently written by the flusher. */
+    size_t _append_inflight = 0;
+    /** Request the flusher to stop when the queue is drained. */
+    bool _append_stop = false;
+    /** Asynchronous append queue protection mutex. */
+    std::mutex _append_mutex;
+    /** Time at which the flusher shall write the accumulated record, if armed. */
+    std::chrono::steady_clock::time_point _accumulate_deadline;
+    /** True if the flusher shall write the accumulated record at its deadline. */
+    bool _accumulate_armed = false;
+    /** Signaled when records are queued, an accumulation deadline is armed or when the flusher must stop. */
+    std::condition_variable _append_not_empty;
+    /** Signaled when records are taken from the queue. */
+    std::condition_variable _append_not_full;
+    /** Signaled when a batch of records have been written. */
+    std::condition_variable _append_done;
+    /** Flusher thread, started on first asynchronous append or accumulation. */
+    std::thread _append_flusher;
+
+    /** Registered subscription to appended records. */
+    struct subscriber
+    {
+        subscription_t id;
+        subscription_callback_t callback;
+        /** Index of the next record to notify. */
+        record_index_t next;
+    };
+
+    /** Registered subscriptions. */
+    std::vector<subscriber> _subscribers;
+    /** Identifier of the next subscription. */
+    subscription_t _next_subscription = 0;
+    /** Highest index already notified, invalid_index() if none. */
+    record_index_t _notified_index = record::invalid_index();
+    /** Signaled when max index advances, used with table mutex. */
+    std::condition_variable_any _appended;
+
+    /** Registered continuous aggregate. */
+    struct continuous_aggregate_state
+    {
+        continuous_aggregate_t id;
+        field_index_t field;
+        rolling_aggregate rolling;
+    };
+
+    /** Registered continuous aggregates. */
+    std::vector<continuous_aggregate_state> _continuous_aggregates;
+    /** Identifier of the next continuous aggregate. */
+    continuous_aggregate_t _next_continuous_aggregate = 0;
+
+    /** Record combining accumulations until its slot closes. */
+    struct accumulator
+    {
+        /** Index of the cached record, invalid_index() if none. */
+        record_index_t index = record::invalid_index();
+        /** Encoded cached record. */
+        std::vector<uint8_t> slot;
+        /** True if the cached record has not been written since its last accumulation. */
+        bool dirty = false;
+        /** Time of the first accumulation not written. */
+        std::chrono::steady_clock::time_point since;
+    };
+
+    /** Record currently accumulated. */
+    accumulator _accumulator;
+    /** Maximal time accumulations are kept in cache. */
+    std::chrono::milliseconds _accumulate_interval{1000};
+
 public:
     /** Default constructor. */
     base_table_impl() = default;
@@ -162,17 +274,22 @@ public:
      * @param record_capacity Number of record the table shall be able to store.
      * @param origin Table time origin.
      * @param duration Table time duration.
+     * @param timestamped True if records carry their own time point (origin and duration are then ignored).
+     * @param options Table creation options.
      * @throw std::invalid_argument Fields list is empty.
      * This is a non-sense to create a table without fields.
      * @throw std::invalid_argument Record capacity of 0.
      * This is a non-sense to create a table without storage capacity.
      * @throw std::invalid_argument Invalid record capacity.
+     * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
      */
-    virtual void create(const std::vector<field_st>& fields, record_index_t record_capacity, record_time_t origin =0, record_time_t duration =0);
+    virtual void create(const std::vector<field_st>& fields, record_index_t record_capacity, record_time_t origin =0, record_time_t duration =0,
+            bool timestamped =false, table_options options =TABLE_DEFAULT);
 
     field_index_t field_count() const override;
     const field_impl& field(field_index_t field)const override;
     const cyclic::field& field(const std::string& field_name)const override;
+    field_index_t field_index(const std::string& field_name)const override;
 
     record_index_t record_capacity() const override;
     record_index_t record_count() const override;
@@ -181,12 +298,41 @@ public:
 
     record_time_t record_origin()const override;
     record_time_t record_duration()const override;
+    bool timestamped()const override;
     record_index_t record_index(record_time_t time)const override;
     record_time_t record_time(record_index_t index)const override;
 
     std::unique_ptr<mutable_record> get_record() const override;
     std::unique_ptr<record> get_record(record_index_t index) const override;
     std::unique_ptr<record> get_record(record_time_t time) const override;
+    record_view get_record_view(record_index_t index) const override;
+    record_view get_record_view(record_time_t time) const override;
+    record_index_t latest(record_index_t n, std::vector<record_view>& out) const override;
+    const record_layout& layout() const override;
+
+    using table::aggregate;
+    aggregate_result aggregate(field_index_t field, record_index_t first, record_index_t last,
+            aggregate_ops ops = AGGREGATE_ALL) const override;
+
+    using table::group_by;
+    std::vector<aggregate_bucket> group_by(field_index_t field, record_index_t first, record_index_t last,
+            record_index_t bucket_size, aggregate_ops ops = AGGREGATE_ALL) const override;
+
+    using table::sketch_by;
+    std::vector<sketch_bucket> sketch_by(field_index_t field, record_index_t first, record_index_t last,
+            record_index_t bucket_size, double relative_accuracy = 0.01) const override;
+
+    std::vector<record_index_t> filter(const predicate& where, record_index_t first, record_index_t last) const override;
+
+    using table::add_continuous_aggregate;
+    continuous_aggregate_t add_continuous_aggregate(field_index_t field, record_index_t window,
+            aggregate_ops ops = AGGREGATE_ALL) override;
+    aggregate_result continuous_aggregate(continuous_aggregate_t id) const override;
+    void remove_continuous_aggregate(continuous_aggregate_t id) override;
+
+    using table::read_column;
+    record_index_t read_column(field_index_t field, record_index_t first, record_index_t last,
+            data_type type, void* out, uint8_t* null_bitmap = nullptr) const override;
 
     void set_record(const record& rec) override;
     void set_record(record_index_t index, const record& rec) override;
@@ -196,12 +342,23 @@ public:
     void update_record(record_index_t index, const record& rec) override;
     void update_record(record_time_t time, const record& rec) override;
 
+    void set_field(record_index_t index, field_index_t field, const value_t& value) override;
+    void set_field(record_time_t time, field_index_t field, const value_t& value) override;
+    void reset_field(record_index_t index, field_index_t field) override;
+    void reset_field(record_time_t time, field_index_t field) override;
+
+    using table::accumulate;
+    void accumulate(record_index_t index, field_index_t field, accumulate_op op, const value_t& value = value_t{}) override;
+    void accumulate(record_time_t time, field_index_t field, accumulate_op op, const value_t& value = value_t{}) override;
+    void configure_accumulate(std::chrono::milliseconds interval) override;
+
     void append_record() override;
     void append_record(record_index_t index) override;
     void append_record(record_time_t time) override;
     void append_record(const record& rec) override;
     void append_record(record_index_t index, const record& rec) override;
     void append_record(record_time_t time, const record& rec) override;
+    void append_encoded(const uint8_t* data, record_index_t index = record::invalid_index()) override;
 
     void insert_record(record_index_t index) override;
     void insert_record(record_time_t time) override;
@@ -209,9 +366,249 @@ public:
     void insert_record(record_index_t index, const record& rec) override;
     void insert_record(record_time_t time, const record& rec) override;
 
+    std::future<record_index_t> append_async(const record& rec) override;
+    void configure_append_queue(size_t capacity, append_policy policy = APPEND_BLOCK) override;
+    void flush() override;
+
+    subscription_t subscribe(subscription_callback_t callback, record_index_t from_index = record::invalid_index()) override;
+    void unsubscribe(subscription_t subscription) override;
+    bool wait_for_index(record_index_t index, std::chrono::milliseconds timeout) override;
+    bool refresh() override;
+
     virtual const_recordset_iterator begin()const override;
     virtual const_recordset_iterator end()const override;
 protected:
+    /**
+     * Append a record at the specified index without flushing table index descriptors.
+     * Implementation of append_record(record_index_t, const record&),
+     * the caller shall hold the table mutex.
+     * @param index Index of record to append, invalid_index() to append after the last record.
+     * @param rec Record to append.
+     * @return Index of the appended record.
+     * @throw std::out_of_range Append a record before end of table.
+     * @throw cyclic::table_is_full Table is full, no more record can be append.
+     */
+    record_index_t do_append_record(record_index_t index, const record& rec);
+    /**
+     * Append an empty slot at the specified index without flushing table index descriptors.
+     * Once returned, the appended slot is at _max_position and shall be written by the caller.
+     * The caller shall hold the table mutex.
+     * @param index Index of record to append, invalid_index() to append after the last record.
+     * @return Index of the appended record.
+     * @throw std::out_of_range Append a record before end of table.
+     * @throw cyclic::table_is_full Table is full, no more record can be append.
+     */
+    record_index_t do_append_slot(record_index_t index);
+
+    /**
+     * Notify waiters and subscribers if max index advanced since last notification.
+     * Shall be called, with the table mutex held, after records are appended
+     * and table index descriptors are flushed.
+     */
+    void notify_appended();
+
+    /**
+     * Update continuous aggregates with the record stored at specified index.
+     * Shall be called, with the table mutex held, each time a record is written.
+     * Records skipped since the last appended one are considered null.
+     * @param index Index of the written record.
+     */
+    void update_continuous_aggregates(record_index_t index);
+
+    /**
+     * Body of the asynchronous append flusher thread.
+     * It also writes accumulated records whose flush interval is elapsed.
+     */
+    void run_append_flusher();
+    /**
+     * Request the flusher to write the accumulated record at a deadline, starting it if needed.
+     * Do nothing if the flusher is stopped.
+     * @param deadline Time at which the accumulated record shall be written.
+     */
+    void arm_accumulate_flush(std::chrono::steady_clock::time_point deadline);
+    /**
+     * Write the accumulated record if its flush interval is elapsed, otherwise arm its deadline.
+     * Shall be called with the table mutex locked.
+     */
+    void flush_expired_accumulator();
+    /**
+     * Write all queued records and stop the asynchronous append flusher thread.
+     * Shall be called by real storage implementations before their own destruction
+     * as the flusher uses their storage methods.
+     */
+    void stop_append_flusher();
+
+    /**
+     * Storage size of a field value.
+     * @param type Type of the field.
+     * @return Size of encoded values, in bytes.
+     */
+    static uint16_t field_size(data_type type);
+
+    /**
+     * Initialize the record layout and the field name lookup from field descriptors.
+     * Field sizes and offsets shall already be set.
+     * @param header_size Size of the record header.
+     * @param record_size Size of a record slot.
+     * @param time_offset Offset of the record timestamp in the header, 0 if records do not carry their time.
+     */
+    void initialize_layout(uint32_t header_size, uint32_t record_size, uint32_t time_offset = 0);
+
+    /**
+     * Hash a field name for the field name lookup table.
+     * @param name Field name.
+     * @return Hash of the name (FNV-1a).
+     */
+    static uint32_t hash_field_name(const std::string& name);
+
+    /**
+     * Build the field name lookup table from field descriptors.
+     */
+    void initialize_field_lookup();
+
+    /**
+     * Encode a record in a slot buffer, following the record layout.
+     * @param rec Record to encode.
+     * @param data Slot buffer, at least as big as the record size.
+     */
+    void encode_record(const record& rec, uint8_t* data) const;
+    /**
+     * Decode a record from a slot buffer, following the record layout.
+     * @param data Slot buffer.
+     * @param index Index of the decoded record.
+     * @return Decoded record.
+     */
+    raw_record decode_record(const uint8_t* data, record_index_t index) const;
+    /**
+     * Retrieve the time of an encoded record.
+     * @param data Encoded record.
+     * @param index Index of the record.
+     * @return Time stored in the record for timestamped tables,
+     * time computed from the index if records have a duration, 0 otherwise.
+     */
+    record_time_t slot_time(const uint8_t* data, record_index_t index) const;
+    /**
+     * Retrieve the time stored in the record at specified position of a timestamped table.
+     * @param pos Position of the record.
+     * @return Time of the record.
+     */
+    record_time_t time_at_position(record_index_t pos) const;
+    /**
+     * Check a record can be appended to a timestamped table.
+     * Records of timestamped tables are appended consecutively, in time order.
+     * @param index Index of the record to append, invalid_index() to append after the last record.
+     * @param time Time of the record to append.
+     * @throw std::out_of_range The index is not the one following the last record.
+     * @throw std::invalid_argument The time is before the time of the last record.
+     */
+    void check_timestamped_append(record_index_t index, record_time_t time) const;
+
+    /**
+     * Direct access to the encoded record stored at specified position.
+     * Internal implementation method.
+     * Return nullptr by default, should be overriden by real storage implementations
+     * able to expose their storage.
+     * @param pos Position to look for.
+     * @return Pointer to the encoded record, nullptr if not directly accessible.
+     */
+    virtual const uint8_t* slot_data(record_index_t pos) const;
+    /**
+     * Copy the encoded record stored at specified position.
+     * Internal implementation method.
+     * Default implementation encodes the record retrieved with get_record_at_position().
+     * @param pos Position to look for.
+     * @param data Buffer to fill, at least as big as the record size.
+     * @throw std::range_error Bad position parameter.
+     */
+    virtual void read_slot(record_index_t pos, uint8_t* data) const;
+    /**
+     * Copy the encoded records stored at consecutive positions.
+     * Internal implementation method.
+     * Default implementation calls read_slot() for each position.
+     * @param pos First position to look for.
+     * @param count Number of positions to read, shall not go after the last position.
+     * @param data Buffer to fill, at least as big as count record sizes.
+     * @throw std::range_error Bad position parameter.
+     */
+    virtual void read_slots(record_index_t pos, record_index_t count, uint8_t* data) const;
+    /**
+     * Store an encoded record at specified position.
+     * Internal implementation method.
+     * Default implementation decodes the record and stores it with set_record_at_position().
+     * @param pos Position to which store the record.
+     * @param data Encoded record.
+     * @throw std::range_error Bad position parameter.
+     */
+    virtual void write_slot(record_index_t pos, const uint8_t* data);
+
+    /**
+     * Copy a part of the encoded record stored at specified position.
+     * Internal implementation method.
+     * Default implementation copies it from the whole slot read with read_slot().
+     * @param pos Position to look for.
+     * @param offset Offset of the first byte to copy in the slot.
+     * @param data Buffer to fill, at least as big as size.
+     * @param size Number of bytes to copy.
+     * @throw std::range_error Bad position parameter.
+     */
+    virtual void read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const;
+    /**
+     * Overwrite a part of the encoded record stored at specified position.
+     * Internal implementation method.
+     * Default implementation rewrites the whole slot with write_slot(),
+     * storage implementations should only write the specified bytes.
+     * @param pos Position to which store the bytes.
+     * @param offset Offset of the first byte to write in the slot.
+     * @param data Bytes to write.
+     * @param size Number of bytes to write.
+     * @throw std::range_error Bad position parameter.
+     */
+    virtual void write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size);
+
+    /**
+     * Write the accumulated record to storage, if modified, and forget it.
+     * Shall be called with the table mutex locked, before any other modification.
+     */
+    void flush_accumulator();
+
+    /**
+     * Check a record can have one of its fields modified and compute its position.
+     * @param index Index of the record.
+     * @param field Index of the field.
+     * @return Position of the record.
+     * @throw std::invalid_argument index is invalid.
+     * @throw std::logic_error the table is empty.
+     * @throw std::out_of_range index out of current table range, or field index out of held field range.
+     * @throw std::range_error internal index computation error.
+     */
+    record_index_t field_update_position(record_index_t index, field_index_t field) const;
+    /**
+     * Write a field value of the record stored at specified position.
+     * The value is written before its null flag, so concurrent readers
+     * never see a flagged value which is not written yet.
+     * @param pos Position of the record.
+     * @param field Index of the field.
+     * @param value Value to write, null to reset the field.
+     * @throw std::range_error Bad position parameter.
+     */
+    void write_field_at_position(record_index_t pos, field_index_t field, const value_t& value);
+
+    /**
+     * Read values of a field for a range of stored records.
+     * Implementation of read_column() for a requested type.
+     * @tparam T Requested type.
+     * @param field Index of the field to read.
+     * @param first Index of the first record to read, shall be stored.
+     * @param last Index of the last record to read (inclusive), shall be stored.
+     * @param out Array of values, corresponding to first record.
+     * @param null_bitmap Validity bitmap, corresponding to first record, can be nullptr.
+     * @param bit Index of the first record bit in the validity bitmap.
+     * @return Number of values read (i.e. not null).
+     */
+    template<typename T>
+    record_index_t read_column_as(field_index_t field, record_index_t first, record_index_t last,
+            T* out, uint8_t* null_bitmap, size_t bit) const;
+
     /**
      * Compute the position of a record from its index.
      * @param index Index of record.
@@ -238,6 +635,29 @@ protected:
      */
     const table_impl_state* get_internal_state()const;
 
+    /**
+     * Switch index to position mapping to masking, for power of two capacities.
+     * Positions are then index & (capacity - 1), which is what the state machine
+     * computes too, tables starting at index 0 and position 0.
+     * @throw std::invalid_argument Record capacity is not a power of two.
+     */
+    void initialize_pow2_capacity();
+
+    /**
+     * Append empty records after the last one, up to an index.
+     * When the gap exceeds capacity, older records are not walked: all of them would be dropped.
+     * @param last Index of the last empty record to append (inclusive), greater than the last record index.
+     * The table shall not be empty.
+     */
+    void append_empty_records(record_index_t last);
+
+    /**
+     * Advance the last record index and position of one slot, forgetting the first
+     * record when the table is full.
+     * Dispatched to the current state, or computed branch-free with power of two capacity.
+     */
+    void advance_max_index();
+
     /**
      * Retrieve the record stored at specified position.
      * Internal implementation method.
@@ -274,6 +694,14 @@ protected:
      */
     virtual void update_record_at_position(record_index_t pos, const record& rec);
 
+    /**
+     * Check the table can be modified.
+     * Called before any record modification.
+     * Do nothing by default, should be overriden by real implementation if needed.
+     * @throw std::logic_error The table cannot be modified.
+     */
+    virtual void check_writable() const;
+
     /**
      * Implementation method used to flush table index descriptors to storage layer.
      * Do nothing by default, should be overriden by real implementation if needed.
@@ -20,11 +20,21 @@
 
 #include "libstore-file-impl.hpp"
 
+#include <array>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <thread>
 
 #include "common-file.hpp"
 
+#include <unistd.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
 /**
  * @page cydbfile .cydb file format
  *
@@ -97,7 +107,10 @@
  *
  * Where:
  * * Header size: size of file header, including file marker, in bytes (4 bytes)
- * * Record options: specific record option flags, not used yet (4 bytes)
+ * * Record options: specific record option flags (4 bytes):
+ *   - 0x1: records are timestamped, their time follows the record header bitmap,
+ *   - 0x2: record capacity is a power of two, record positions are indexes masked by capacity - 1,
+ *   - 0x4: record indexes are stored on 64 bits (see storage content index).
  * * Record capacity: number of record the table is able to store (4 bytes)
  * * Field count: number of fields (per record) (2 bytes)
  * * Record origin: Time of record origin (8 bytes)
@@ -128,7 +141,7 @@
  *     <td colspan="4">Max index</td>
  *     <td colspan="4">Max position</td>
  *   </tr>
- *   <tr><td colspan="8">Reserved</td></tr>
+ *   <tr><td colspan="8">Change counter</td></tr>
  * </table>
  *
  * Where:
@@ -137,6 +150,22 @@
  * * Min position: position of the first record, 0-based, -1 if no record (4 bytes)
  * * Max index: index of the last record, 0-based, min==max if one record, -1 if no record (4 bytes)
  * * Max position: position of the last record, 0-based, min==max if one record, -1 if no record (4 bytes)
+ * * Change counter: incremented each time the storage content index is written (8 bytes)
+ *
+ * With the 0x4 record option, indexes are stored on 64 bits and positions are not stored,
+ * records being always at their index modulo the capacity:
+ *
+ * <table>
+ * <caption>CYDB 1.0 Storage content index format with 64 bits indexes</caption>
+ *   <tr><th> <th>0<th>1<th>2<th>3<th>4<th>5<th>6<th>7
+ *   <tr>
+ *     <th rowspan="4">Storage content index (32 bytes)</th>
+ *     <td colspan="8">First index</td>
+ *   </tr>
+ *   <tr><td colspan="8">Min index</td></tr>
+ *   <tr><td colspan="8">Max index</td></tr>
+ *   <tr><td colspan="8">Change counter</td></tr>
+ * </table>
  *
  * The storage content index is positionned at byte 48 in the file (size of file header and storage structure blocks).
  *
@@ -222,6 +251,18 @@
  * * max index: the current highest valid index of the table
  * * max position: the position of the index_max record
  *
+ * CYDB concurrent access
+ * ----------------------
+ *
+ * Only one process can write a table file at a time, many others can read it.
+ * Coordination is done with advisory byte range locks:
+ * * The writer holds an exclusive lock on the file header (bytes 0 to 7) as long
+ *   as it has the file opened.
+ * * The writer updates the storage content index, and increments its change counter,
+ *   with an exclusive lock on it (bytes 48 to 79).
+ * * Readers read the storage content index with a shared lock on it (bytes 48 to 79),
+ *   only when the change counter differs from the last one they read.
+ *
  **/
 
 /*
@@ -285,17 +326,39 @@ std::string file_table_impl::FILE_MARKER = "CYDB";
 
 file_table_impl::~file_table_impl()
 {
+    stop_append_flusher();
+    if(_file && !_read_only)
+    {
+        try
+        {
+            lock_t lock{_mutex};
+            flush_accumulator();
+        }
+        catch(...)
+        {
+            // Nothing can be reported while closing the table.
+        }
+    }
+    _records.unmap();
     if(_file)
     {
-        _file.sync();
+        if(!_read_only)
+        {
+            _file.sync();
+        }
         _file.close();
     }
 }
 
 void file_table_impl::create(const std::string& filename, const std::vector<field_st>& fields,
-        record_index_t record_capacity, record_time_t origin, record_time_t duration)
+        record_index_t record_capacity, record_time_t origin, record_time_t duration, bool timestamped,
+        table_options options)
 {
-    base_table_impl::create(fields, record_capacity, origin, duration);
+    if(record_capacity > std::numeric_limits<uint32_t>::max())
+    {
+        throw std::invalid_argument{"record_capacity cannot be stored in a table file."};
+    }
+    base_table_impl::create(fields, record_capacity, origin, duration, timestamped, options);
     _filename = filename;
     initialize_on_creation(fields);
 }
@@ -305,6 +368,22 @@ void file_table_impl::initialize_on_creation(const std::vector<field_st>& fields
     // Compute record header size (bitset)
     // Enough space to save one bit per field.
     _record_header_size = _field_count > 0 ? (_field_count - 1) / 8 + 1 : 0;
+    uint32_t time_offset = 0;
+    if(_layout.time_offset != 0)
+    {
+        // Followed by the record timestamp.
+        time_offset = _record_header_size;
+        _record_header_size += sizeof(record_time_t);
+        _record_options |= _record_option_timestamped;
+    }
+    if(_pow2_capacity)
+    {
+        _record_options |= _record_option_pow2_capacity;
+    }
+    if(_index_limit != narrow_index_limit)
+    {
+        _record_options |= _record_option_wide_index;
+    }
 
     // Compute record size
     // Enought space to save the record header and all fields.
@@ -339,8 +418,11 @@ void file_table_impl::initialize_on_creation(const std::vector<field_st>& fields
         offset += size;
     }
 
+    initialize_layout(_record_header_size, _record_size, time_offset);
+
     // Really create the table file.
     create_table_file();
+    map_records();
 }
 
 void file_table_impl::create_table_file()
@@ -352,6 +434,15 @@ void file_table_impl::create_table_file()
         stm << "Error while creating table file " << _filename << std::endl;
         throw cyclic::io::io_exception(0, stm.str());
     }
+    if(!_file.lock(_table_writer_lock_position, _table_writer_lock_size, true, false))
+    {
+        std::ostringstream stm;
+        stm << "Table file " << _filename << " is used by another writer" << std::endl;
+        throw cyclic::io::io_exception(0, stm.str());
+    }
+    _writer = true;
+    // Only now the previous content, if any, can be dropped.
+    _file.truncate(0);
 
     //
     // Table header
@@ -365,7 +456,7 @@ void file_table_impl::create_table_file()
     // Storage structure
     _file.write(_table_header_size); // Table header size
     _file.write(_record_options); // Record options
-    _file.write(_record_capacity); // Record capacity (in slot count)
+    _file.write((uint32_t) _record_capacity); // Record capacity (in slot count)
     _file.write(_field_count); // Field count
     _file.write<uint16_t>(0); // Reserved
     _file.write(_origin); // Record origin
@@ -373,13 +464,7 @@ void file_table_impl::create_table_file()
     _file.write(_record_header_size); // Record header size
     _file.write(_record_size); // Record size
     // Storage content index
-    _file.write(_first_index); // first index
-    _file.write<uint32_t>(0); // Unused
-    _file.write(_min_index); // min index
-    _file.write(_min_position); // min position
-    _file.write(_max_index); // max index
-    _file.write(_max_position); // max position
-    _file.write<uint64_t>(0); // Unused
+    write_index_content();
 
     // Field descriptors
     for(field_index_t f = 0; f < _field_count; ++f)
@@ -412,7 +497,7 @@ void file_table_impl::create_table_file()
     _file.sync();
 }
 
-void file_table_impl::open(const std::string& filename, const io::file& file, const std::string& /*version*/)
+void file_table_impl::open(const std::string& filename, io::file&& file, const std::string& /*version*/, bool read_only)
 {
     if(filename.empty())
     {
@@ -425,7 +510,13 @@ void file_table_impl::open(const std::string& filename, const io::file& file, co
         throw cyclic::io::io_exception(0, stm.str());
     }
     _filename = filename;
-    _file = file;
+    // Moved rather than duplicated: with process-associated locks, closing any
+    // descriptor of the file would release the writer lock taken below.
+    _file = std::move(file);
+    _read_only = read_only;
+
+    // Become the writer of the table if no one else is.
+    _writer = !_read_only && _file.lock(_table_writer_lock_position, _table_writer_lock_size, true, false);
 
     // End of file header (1 byte)
     _file.read(_global_options); // Global options
@@ -433,7 +524,15 @@ void file_table_impl::open(const std::string& filename, const io::file& file, co
     // Storage structure (40 bytes)
     _file.read(_table_header_size); // Table header size
     _file.read(_record_options); // Record options
-    _file.read(_record_capacity); // Record capacity (in slot count)
+    if(_record_options & ~(_record_option_timestamped | _record_option_pow2_capacity | _record_option_wide_index))
+    {
+        std::ostringstream stm;
+        stm << "Unsupported record options (0x" << std::hex << _record_options << ") in table file " << _filename << std::endl;
+        throw cyclic::io::io_exception(0, stm.str());
+    }
+    uint32_t record_capacity;
+    _file.read(record_capacity); // Record capacity (in slot count)
+    _record_capacity = record_capacity;
     _file.read(_field_count); // Field count
     _file.skip<2>(); // Reserved for table global variables, unused yet
     _file.read(_origin); // Record origin
@@ -442,13 +541,11 @@ void file_table_impl::open(const std::string& filename, const io::file& file, co
     _file.read(_record_size); // Record size
 
     // Storage content index (32 bytes)
-    _file.read(_first_index); // first index
-    _file.skip<4>(); // Unused
-    _file.read(_min_index); // min index
-    _file.read(_min_position); // min position
-    _file.read(_max_index); // max index
-    _file.read(_max_position); // max position
-    _file.skip<8>(); // Unused
+    if(_record_options & _record_option_wide_index)
+    {
+        _index_limit = record::absolute_max_index();
+    }
+    read_index_content();
 
     // Field descriptions
     _fields.reserve(_field_count);
@@ -476,116 +573,274 @@ void file_table_impl::open(const std::string& filename, const io::file& file, co
     }
 
     // TODO Additionnal header content
+
+    initialize_layout(_record_header_size, _record_size,
+            (_record_options & _record_option_timestamped) ? _record_header_size - (uint32_t) sizeof(record_time_t) : 0);
+    if(_record_options & _record_option_pow2_capacity)
+    {
+        initialize_pow2_capacity();
+    }
+    map_records();
+}
+
+void file_table_impl::map_records()
+{
+    // Records are read directly from the page cache when possible,
+    // it stays coherent with writes done with the file descriptor.
+    try
+    {
+        _records = io::mapping(_file, _table_header_size, (size_t) _record_size * _record_capacity);
+    }
+    catch(io::io_exception&)
+    {
+        // Fallback to explicit reads.
+        _records.unmap();
+    }
 }
 
 void file_table_impl::read_table_index_descriptor()
 {
-    _file.seek(_table_index_descriptor_position)
-            .read(_first_index) // first index
-            .skip<4>() // Unused
-            .read(_min_index) // min index
-            .read(_min_position) // min position
-            .read(_max_index) // max index
-            .read(_max_position) // max position
-            ;
+    io::range_lock lock{_file, _table_index_descriptor_position, _table_index_descriptor_size, false};
+    _file.seek(_table_index_descriptor_position);
+    read_index_content();
 }
 
 void file_table_impl::write_table_index_descriptor()
 {
-    _file.seek(_table_index_descriptor_position)
-            .write(_first_index) // first index
-            .write((uint32_t)0) // Unused
-            .write(_min_index) // min index
-            .write(_min_position) // min position
-            .write(_max_index) // max index
-            .write(_max_position) // max position
-            ;
+    io::range_lock lock{_file, _table_index_descriptor_position, _table_index_descriptor_size, true};
+    ++_change_counter;
+    _file.seek(_table_index_descriptor_position);
+    write_index_content();
 }
 
-uint16_t file_table_impl::field_size(data_type type)
+/**
+ * Convert an index stored on 32 bits to a record index.
+ * @param index Stored index.
+ * @return Record index, invalid one if the invalid index was stored.
+ */
+static record_index_t widen_index(uint32_t index)
 {
-    switch(type)
-    {
-    case CDB_DT_BOOLEAN:
-    case CDB_DT_SIGNED_8:
-    case CDB_DT_UNSIGNED_8:
-        return 1;
-    case CDB_DT_SIGNED_16:
-    case CDB_DT_UNSIGNED_16:
-        return 2;
-    case CDB_DT_SIGNED_32:
-    case CDB_DT_UNSIGNED_32:
-        return 4;
-    case CDB_DT_SIGNED_64:
-    case CDB_DT_UNSIGNED_64:
-        return 8;
-    case CDB_DT_FLOAT_4:
-        return 4;
-    case CDB_DT_FLOAT_8:
-        return 8;
-    case CDB_DT_VOID:
-    case CDB_DT_UNSPECIFIED:
-    default:
-        return 0;
+    return index == (uint32_t) record::invalid_index() ? record::invalid_index() : index;
+}
+
+void file_table_impl::read_index_content()
+{
+    if(_record_options & _record_option_wide_index)
+    {
+        _file.read(_first_index) // first index
+                .read(_min_index) // min index
+                .read(_max_index) // max index
+                ;
+        // Positions are not stored, records are always at their index modulo capacity.
+        bool empty = _min_index == record::invalid_index();
+        _min_position = empty ? record::invalid_index() : _min_index % _record_capacity;
+        _max_position = empty ? record::invalid_index() : _max_index % _record_capacity;
+    }
+    else
+    {
+        uint32_t first_index, min_index, min_position, max_index, max_position;
+        _file.read(first_index) // first index
+                .skip<4>() // Unused
+                .read(min_index) // min index
+                .read(min_position) // min position
+                .read(max_index) // max index
+                .read(max_position) // max position
+                ;
+        _first_index = widen_index(first_index);
+        _min_index = widen_index(min_index);
+        _min_position = widen_index(min_position);
+        _max_index = widen_index(max_index);
+        _max_position = widen_index(max_position);
     }
+    _file.read(_change_counter); // Change counter
 }
 
-raw_record file_table_impl::get_record_at_position(record_index_t pos) const
+void file_table_impl::write_index_content()
 {
-    if(pos < _record_capacity)
+    if(_record_options & _record_option_wide_index)
     {
-        std::vector<uint8_t> buff(_record_size);
-        _file.read_at(buff.data(), _record_size, _table_header_size + _record_size * pos);
-        const uint8_t* data = buff.data();
+        _file.write(_first_index) // first index
+                .write(_min_index) // min index
+                .write(_max_index) // max index
+                ;
+    }
+    else
+    {
+        // The invalid index is truncated to its 32 bits counterpart.
+        _file.write((uint32_t) _first_index) // first index
+                .write((uint32_t)0) // Unused
+                .write((uint32_t) _min_index) // min index
+                .write((uint32_t) _min_position) // min position
+                .write((uint32_t) _max_index) // max index
+                .write((uint32_t) _max_position) // max position
+                ;
+    }
+    _file.write(_change_counter); // Change counter
+}
+
+void file_table_impl::check_writable() const
+{
+    if(_read_only)
+    {
+        throw std::logic_error{"Table file is opened in read-only mode, it cannot be modified."};
+    }
+    if(!_writer)
+    {
+        throw std::logic_error{"Table file is written by another table instance, it cannot be modified."};
+    }
+}
+
+bool file_table_impl::writer()const
+{
+    return _writer;
+}
+
+bool file_table_impl::read_only()const
+{
+    return _read_only;
+}
+
+bool file_table_impl::refresh()
+{
+    lock_t lock{_mutex};
+    if(_writer)
+    {
+        // The writer view is always up to date.
+        return false;
+    }
 
-        raw_record rec {this, position_to_index(pos)};
+    uint64_t counter;
+    _file.read_at(&counter, sizeof(counter), _table_change_counter_position);
+    if(counter == _change_counter)
+    {
+        return false;
+    }
 
-        for(field_index_t f = 0; f < field_count(); ++f)
+    record_index_t previous = _max_index;
+    read_table_index_descriptor();
+    if(!_continuous_aggregates.empty() && _max_index != record::invalid_index()
+            && (previous == record::invalid_index() || previous < _max_index))
+    {
+        // Only appended records can be seen from another writer.
+        record_index_t first = previous == record::invalid_index() ? _min_index : std::max(previous + 1, _min_index);
+        for(record_index_t index = first; index <= _max_index; ++index)
         {
-            const field_impl& fld = field(f);
-            bool has = (*(data + (f / 8)) & (1 << (f % 8))) != 0;
-            if(!has)
+            update_continuous_aggregates(index);
+        }
+    }
+    notify_appended();
+    return true;
+}
+
+bool file_table_impl::wait_for_index(record_index_t index, std::chrono::milliseconds timeout)
+{
+    if(_writer)
+    {
+        // Records can only be appended by this instance.
+        return base_table_impl::wait_for_index(index, timeout);
+    }
+
+    // Records are appended by another instance, maybe in another process:
+    // wait for file modifications and refresh.
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    int notify_fd = -1;
+#ifdef __linux__
+    notify_fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(notify_fd != -1 && ::inotify_add_watch(notify_fd, _filename.c_str(), IN_MODIFY) == -1)
+    {
+        ::close(notify_fd);
+        notify_fd = -1;
+    }
+#endif
+    bool res = false;
+    for(;;)
+    {
+        refresh();
+        {
+            lock_t lock{_mutex};
+            if(_max_index != record::invalid_index() && _max_index >= index)
             {
-                rec[f].reset();
+                res = true;
+                break;
             }
-            else
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(now >= deadline)
+        {
+            break;
+        }
+        std::chrono::milliseconds remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now)
+                + std::chrono::milliseconds(1);
+#ifdef __linux__
+        if(notify_fd != -1)
+        {
+            struct pollfd pfd {notify_fd, POLLIN, 0};
+            if(::poll(&pfd, 1, (int) remaining.count()) > 0)
             {
-                const uint8_t* ptr = data + _record_header_size + fld._offset;
-                switch(fld.type())
-                {
-                case CDB_DT_BOOLEAN: rec[f] = (bool) (*(uint8_t*) ptr) != 0;
-                    break;
-                case CDB_DT_SIGNED_8: rec[f] = (int8_t) (*(int8_t*) ptr);
-                    break;
-                case CDB_DT_UNSIGNED_8: rec[f] = (uint8_t) (*(uint8_t*) ptr);
-                    break;
-                case CDB_DT_SIGNED_16: rec[f] = (int16_t) (*(int16_t*) ptr);
-                    break;
-                case CDB_DT_UNSIGNED_16: rec[f] = (uint16_t) (*(uint16_t*) ptr);
-                    break;
-                case CDB_DT_SIGNED_32: rec[f] = (int32_t) (*(int32_t*) ptr);
-                    break;
-                case CDB_DT_UNSIGNED_32: rec[f] = (uint32_t) (*(uint32_t*) ptr);
-                    break;
-                case CDB_DT_SIGNED_64: rec[f] = (int64_t) (*(int64_t*) ptr);
-                    break;
-                case CDB_DT_UNSIGNED_64: rec[f] = (uint64_t) (*(uint64_t*) ptr);
-                    break;
-                case CDB_DT_FLOAT_4: rec[f] = (float) (*(float*) ptr);
-                    break;
-                case CDB_DT_FLOAT_8: rec[f] = (double) (*(double*) ptr);
-                    break;
-                default: rec[f].reset();
-                    break;
-                }
+                // Drain events, only the notification matters.
+                char buffer[4096];
+                while(::read(notify_fd, buffer, sizeof(buffer)) > 0);
             }
+            continue;
         }
-        return rec;
+#endif
+        // Fallback to polling.
+        std::this_thread::sleep_for(std::min(remaining, std::chrono::milliseconds(10)));
+    }
+    if(notify_fd != -1)
+    {
+        ::close(notify_fd);
+    }
+    return res;
+}
+
+const uint8_t* file_table_impl::slot_data(record_index_t pos) const
+{
+    if(pos >= _record_capacity)
+    {
+        throw std::range_error{"Internal getting record position error"};
+    }
+    return _records ? _records.data() + (size_t) _record_size * pos : nullptr;
+}
+
+void file_table_impl::read_slot(record_index_t pos, uint8_t* data) const
+{
+    if(const uint8_t* slot = slot_data(pos))
+    {
+        std::memcpy(data, slot, _record_size);
     }
     else
+    {
+        _file.read_at(data, _record_size, _table_header_size + (size_t) _record_size * pos);
+    }
+}
+
+void file_table_impl::read_slots(record_index_t pos, record_index_t count, uint8_t* data) const
+{
+    if(pos + count > _record_capacity)
     {
         throw std::range_error{"Internal getting record position error"};
     }
+    if(const uint8_t* slot = slot_data(pos))
+    {
+        std::memcpy(data, slot, (size_t) count * _record_size);
+    }
+    else
+    {
+        _file.read_at(data, (size_t) count * _record_size, _table_header_size + (size_t) _record_size * pos);
+    }
+}
+
+raw_record file_table_impl::get_record_at_position(record_index_t pos) const
+{
+    if(const uint8_t* slot = slot_data(pos))
+    {
+        return decode_record(slot, position_to_index(pos));
+    }
+    std::vector<uint8_t> buff(_record_size);
+    read_slot(pos, buff.data());
+    return decode_record(buff.data(), position_to_index(pos));
 }
 
 void file_table_impl::reset_record_at_position(record_index_t pos)
@@ -600,65 +855,49 @@ void file_table_impl::reset_record_at_position(record_index_t pos)
     }
 }
 
-void file_table_impl::set_record_at_position(record_index_t pos, const record& rec)
+void file_table_impl::write_slot(record_index_t pos, const uint8_t* data)
 {
     if(pos < _record_capacity)
     {
-        std::vector<uint8_t> buff(_record_size, 0);
-        uint8_t* data = buff.data();
+        _file.write_at(data, _record_size, _table_header_size + (size_t) _record_size * pos);
+    }
+    else
+    {
+        throw std::range_error{"Internal setting record position error"};
+    }
+}
 
-        for(field_index_t f = 0; f < field_count(); ++f)
-        {
-            const field_impl& fld = field(f);
-            if(rec.has(f))
-            {
-                uint8_t* hdr = data + (f / 8);
-                *hdr |= (1 << (f % 8));
-
-                uint8_t* ptr = data + _record_header_size + fld._offset;
-
-                switch(fld.type())
-                {
-                case CDB_DT_BOOLEAN:
-                    *ptr = rec[f].value<bool>() ? 1 : 0;
-                    break;
-                case CDB_DT_SIGNED_8:
-                    (*(int8_t*) ptr) = rec[f].value<int8_t>();
-                    break;
-                case CDB_DT_UNSIGNED_8:
-                    (*(uint8_t*) ptr) = rec[f].value<uint8_t>();
-                    break;
-                case CDB_DT_SIGNED_16:
-                    (*(int16_t*) ptr) = rec[f].value<int16_t>();
-                    break;
-                case CDB_DT_UNSIGNED_16:
-                    (*(uint16_t*) ptr) = rec[f].value<uint16_t>();
-                    break;
-                case CDB_DT_SIGNED_32:
-                    (*(int32_t*) ptr) = rec[f].value<int32_t>();
-                    break;
-                case CDB_DT_UNSIGNED_32:
-                    (*(uint32_t*) ptr) = rec[f].value<uint32_t>();
-                    break;
-                case CDB_DT_SIGNED_64:
-                    (*(int64_t*) ptr) = rec[f].value<int64_t>();
-                    break;
-                case CDB_DT_UNSIGNED_64:
-                    (*(uint64_t*) ptr) = rec[f].value<uint64_t>();
-                    break;
-                case CDB_DT_FLOAT_4:
-                    (*(float*) ptr) = rec[f].value<float>();
-                    break;
-                case CDB_DT_FLOAT_8:
-                    (*(double*) ptr) = rec[f].value<double>();
-                    break;
-                default:
-                    // Unsupported type
-                    break;
-                }
-            }
-        }
-        _file.write_at(data, _record_size, _table_header_size + _record_size * pos);
+void file_table_impl::read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const
+{
+    if(const uint8_t* slot = slot_data(pos))
+    {
+        std::memcpy(data, slot + offset, size);
+    }
+    else
+    {
+        _file.read_at(data, size, _table_header_size + (size_t) _record_size * pos + offset);
+    }
+}
+
+void file_table_impl::write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    if(pos < _record_capacity)
+    {
+        _file.write_at(data, size, _table_header_size + (size_t) _record_size * pos + offset);
+    }
+    else
+    {
+        throw std::range_error{"Internal setting record position error"};
+    }
+}
+
+void file_table_impl::set_record_at_position(record_index_t pos, const record& rec)
+{
+    if(pos < _record_capacity)
+    {
+        std::vector<uint8_t> buff(_record_size);
+        encode_record(rec, buff.data());
+        _file.write_at(buff.data(), _record_size, _table_header_size + (size_t) _record_size * pos);
     }
     else
     {
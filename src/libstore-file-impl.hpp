@@ -51,18 +51,34 @@ protected:
 
     /** File default current version. */
     const char _version_marker[2] {'0', '1'};
-    uint16_t _global_options;
+    uint16_t _global_options = 0;
 
     uint32_t _table_header_size = 8 + 40 + 32; // See file spec
     uint32_t _table_size;
 
-    uint32_t _record_options;
+    uint32_t _record_options = 0;
     uint32_t _record_header_size;
     uint32_t _record_size;
 
     // _field_details // TODO
 
     static constexpr uint32_t _table_index_descriptor_position = 48; // See file spec
+    static constexpr uint32_t _table_index_descriptor_size = 32; // See file spec
+    static constexpr uint32_t _table_change_counter_position = 72; // See file spec
+    static constexpr uint32_t _table_writer_lock_position = 0; // See file spec
+    static constexpr uint32_t _table_writer_lock_size = 8; // See file spec
+    static constexpr uint32_t _record_option_timestamped = 0x1; // See file spec
+    static constexpr uint32_t _record_option_pow2_capacity = 0x2; // See file spec
+    static constexpr uint32_t _record_option_wide_index = 0x4; // See file spec
+
+    /** Change counter of the table index descriptor, as last read or written. */
+    uint64_t _change_counter = 0;
+    /** True if this instance holds the writer lock of the file. */
+    bool _writer = false;
+    /** True if the table file is opened for reading only. */
+    bool _read_only = false;
+    /** Shared read-only mapping of record slots, if the file can be mapped. */
+    io::mapping _records;
 
 public:
     file_table_impl() = default;
@@ -75,32 +91,72 @@ public:
      * @param record_capacity Table capacity in record number.
      * @param origin Table time origin.
      * @param duration Table time duration.
+     * @param timestamped True if records carry their own time point.
+     * @param options Table creation options, saved in the file.
      * @throw std::invalid_argument Fields list is empty.
      * This is a non-sense to create a table without fields.
      * @throw std::invalid_argument Record capacity of 0.
      * This is a non-sense to create a table without storage capacity.
      * @throw std::invalid_argument Invalid record capacity.
+     * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
      * @throw cyclic::io::io_exception An I/O exception occurs.
      */
     void create(const std::string& filename, const std::vector<field_st>& fields,
-        record_index_t record_capacity, record_time_t origin, record_time_t duration);
+        record_index_t record_capacity, record_time_t origin, record_time_t duration, bool timestamped = false,
+        table_options options = TABLE_DEFAULT);
 
     /**
      * Open a table from a file.
      * @param filename Name of table file to open.
+     * @param file Opened file, positioned just after the version marker, taken over by the table.
+     * @param version File version marker.
+     * @param read_only True if the file is opened for reading only.
      * @throw std::invalid_argument Filename shall be specified.
      * @throw cyclic::io::io_exception An I/O exception occurs.
      */
-    void open(const std::string& filename, const io::file& file, const std::string& version);
+    void open(const std::string& filename, io::file&& file, const std::string& version, bool read_only = false);
 
-protected:
-    static uint16_t field_size(data_type type);
+    /**
+     * Test if this instance is the writer of the table file.
+     * Only one instance, in all processes, can write a table file at a time,
+     * other ones are readers which shall refresh() their view.
+     * @return True if this instance can modify the table.
+     */
+    bool writer()const;
+
+    /**
+     * Test if the table file is opened for reading only.
+     * @return True if the table is read-only.
+     */
+    bool read_only()const;
 
+    bool refresh() override;
+    bool wait_for_index(record_index_t index, std::chrono::milliseconds timeout) override;
+
+protected:
     void initialize_on_creation(const std::vector<field_st>& fields);
     void create_table_file();
 
     void read_table_index_descriptor();
-    void write_table_index_descriptor();
+    void write_table_index_descriptor() override;
+    /**
+     * Read the storage content index, the file being positioned at its beginning.
+     * Indexes are read on 64 bits for wide index tables, on 32 bits otherwise.
+     */
+    void read_index_content();
+    /**
+     * Write the storage content index, the file being positioned at its beginning.
+     */
+    void write_index_content();
+    void check_writable() const override;
+    void map_records();
+
+    const uint8_t* slot_data(record_index_t pos) const override;
+    void read_slot(record_index_t pos, uint8_t* data) const override;
+    void read_slots(record_index_t pos, record_index_t count, uint8_t* data) const override;
+    void write_slot(record_index_t pos, const uint8_t* data) override;
+    void read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const override;
+    void write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size) override;
 
     raw_record get_record_at_position(record_index_t pos) const override;
     void reset_record_at_position(record_index_t pos) override;
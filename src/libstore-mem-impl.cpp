@@ -20,6 +20,7 @@
 
 #include "libstore-mem-impl.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -79,20 +80,24 @@ namespace impl
 // memory_table_impl
 //
 
+memory_table_impl::~memory_table_impl()
+{
+    stop_append_flusher();
+}
+
 void memory_table_impl::create(const std::vector<field_st>& fields, record_index_t record_capacity,
-        record_time_t origin, record_time_t duration)
+        record_time_t origin, record_time_t duration, bool timestamped, table_options options)
 {
-    base_table_impl::create(fields, record_capacity, origin, duration);
+    base_table_impl::create(fields, record_capacity, origin, duration, timestamped, options);
     _data.clear();
-    _data.reserve(record_capacity);
-    _data.resize(record_capacity, raw_record{this});
+    _data.resize((size_t) _layout.record_size * record_capacity, 0);
 }
 
-raw_record memory_table_impl::get_record_at_position(record_index_t pos) const
+const uint8_t* memory_table_impl::slot_data(record_index_t pos) const
 {
     if(pos < _record_capacity)
     {
-        return _data[pos];
+        return _data.data() + (size_t) _layout.record_size * pos;
     }
     else
     {
@@ -100,11 +105,21 @@ raw_record memory_table_impl::get_record_at_position(record_index_t pos) const
     }
 }
 
+void memory_table_impl::read_slot(record_index_t pos, uint8_t* data) const
+{
+    std::memcpy(data, slot_data(pos), _layout.record_size);
+}
+
+raw_record memory_table_impl::get_record_at_position(record_index_t pos) const
+{
+    return decode_record(slot_data(pos), position_to_index(pos));
+}
+
 void memory_table_impl::reset_record_at_position(record_index_t pos)
 {
     if(pos < _record_capacity)
     {
-        _data[pos] = raw_record{this};
+        std::memset(_data.data() + (size_t) _layout.record_size * pos, 0, _layout.record_size);
     }
     else
     {
@@ -112,17 +127,45 @@ void memory_table_impl::reset_record_at_position(record_index_t pos)
     }
 }
 
-void memory_table_impl::set_record_at_position(record_index_t pos, const record& rec)
+void memory_table_impl::write_slot(record_index_t pos, const uint8_t* data)
 {
     if(pos < _record_capacity)
     {
-        _data[pos] = rec;
+        std::memcpy(_data.data() + (size_t) _layout.record_size * pos, data, _layout.record_size);
     }
     else
     {
         throw std::range_error{"Internal setting record position error"};
     }
+}
 
+void memory_table_impl::read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const
+{
+    std::memcpy(data, slot_data(pos) + offset, size);
+}
+
+void memory_table_impl::write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size)
+{
+    if(pos < _record_capacity)
+    {
+        std::memcpy(_data.data() + (size_t) _layout.record_size * pos + offset, data, size);
+    }
+    else
+    {
+        throw std::range_error{"Internal setting record position error"};
+    }
+}
+
+void memory_table_impl::set_record_at_position(record_index_t pos, const record& rec)
+{
+    if(pos < _record_capacity)
+    {
+        encode_record(rec, _data.data() + (size_t) _layout.record_size * pos);
+    }
+    else
+    {
+        throw std::range_error{"Internal setting record position error"};
+    }
 }
 
 }
@@ -46,17 +46,20 @@ namespace impl
 class memory_table_impl : public base_table_impl
 {
 protected:
-    std::vector<raw_record> _data;
+    /** Encoded record slots, see record layout. */
+    std::vector<uint8_t> _data;
 
 public:
     memory_table_impl() = default;
-    virtual ~memory_table_impl() = default;
+    virtual ~memory_table_impl();
     /**
      * Create a cyclic table stored in memory.
      * This table is accessible for the current process only.
      * It will be alive until no client access it.
      * @param origin Table time origin.
      * @param duration Table time duration.
+     * @param timestamped True if records carry their own time point.
+     * @param options Table creation options.
      * @param fields Field descriptors for create table.
      * @param record_capacity Table capacity in record number.
      * @throw std::invalid_argument Fields list is empty.
@@ -64,11 +67,18 @@ public:
      * @throw std::invalid_argument Record capacity of 0.
      * This is a non-sense to create a table without storage capacity.
      * @throw std::invalid_argument Invalid record capacity.
+     * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
      */
     virtual void create(const std::vector<field_st>& fields, record_index_t record_capacity,
-        record_time_t origin =0, record_time_t duration =0) override;
+        record_time_t origin =0, record_time_t duration =0, bool timestamped =false,
+        table_options options =TABLE_DEFAULT) override;
 
 protected:
+    const uint8_t* slot_data(record_index_t pos) const override;
+    void read_slot(record_index_t pos, uint8_t* data) const override;
+    void write_slot(record_index_t pos, const uint8_t* data) override;
+    void read_slot_bytes(record_index_t pos, uint32_t offset, uint8_t* data, uint32_t size) const override;
+    void write_slot_bytes(record_index_t pos, uint32_t offset, const uint8_t* data, uint32_t size) override;
     raw_record get_record_at_position(record_index_t pos) const override;
     void reset_record_at_position(record_index_t pos) override;
     void set_record_at_position(record_index_t pos, const record& rec) override;
@@ -0,0 +1,412 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * src/libstore-typed.hpp
+ * Copyright (C) 2017 Emilien Kia <emilien.kia@gmail.com>
+ *
+ * cyclicdb/libcyclicstore is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of the License,
+ * or (at your option) any later version.
+ *
+ * cyclicdb is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the COPYING file at the root of the source distribution for more details.
+ * See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CYCLIC_LIBSTORE_TYPED_HPP_
+#define _CYCLIC_LIBSTORE_TYPED_HPP_
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "libstore.hpp"
+
+/**
+ * Declare a field descriptor for typed tables.
+ * CYCLIC_TYPED_FIELD(cpu, float) declares the type 'cpu', describing a field named "cpu" holding float values.
+ * @see cyclic::store::typed_table
+ */
+#define CYCLIC_TYPED_FIELD(field_name, value_type) \
+    struct field_name \
+    { \
+        typedef value_type type; \
+        static constexpr const char* name = #field_name; \
+    }
+
+namespace cyclic
+{
+namespace store
+{
+/**
+ * Implementation details of typed tables.
+ */
+namespace typed_detail
+{
+    /** Position of a field descriptor in a field descriptor list. */
+    template<typename F, typename... Fields> struct index_of;
+    template<typename F, typename... Rest> struct index_of<F, F, Rest...> : std::integral_constant<size_t, 0> {};
+    template<typename F, typename G, typename... Rest> struct index_of<F, G, Rest...> :
+        std::integral_constant<size_t, 1 + index_of<F, Rest...>::value> {};
+
+    /** Storage size of values of a type, booleans are stored on one byte. */
+    template<typename T> constexpr uint32_t size_of() {return std::is_same<T, bool>::value ? 1 : (uint32_t) sizeof(T);}
+
+    /** Store a value at a possibly unaligned address. */
+    template<typename T> inline void store(uint8_t* ptr, T value)
+    {
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            *ptr = value ? 1 : 0;
+        }
+        else
+        {
+            std::memcpy(ptr, &value, sizeof(T));
+        }
+    }
+
+    /** Load a value from a possibly unaligned address. */
+    template<typename T> inline T load(const uint8_t* ptr)
+    {
+        if constexpr (std::is_same<T, bool>::value)
+        {
+            return *ptr != 0;
+        }
+        else
+        {
+            T value;
+            std::memcpy(&value, ptr, sizeof(T));
+            return value;
+        }
+    }
+} // namespace typed_detail
+
+/**
+ * Table whose schema is known at compile time.
+ * Fields are described by types declared with CYCLIC_TYPED_FIELD, so that:
+ * @code
+ * CYCLIC_TYPED_FIELD(cpu, float);
+ * CYCLIC_TYPED_FIELD(mem, uint64_t);
+ * typedef cyclic::store::typed_table<cpu, mem> usage_table;
+ *
+ * usage_table table = usage_table::create(3600);
+ * table.append(usage_table::row{}.set<cpu>(0.5f).set<mem>(1024));
+ * float last = table.get(table.table().max_index()).get<cpu>();
+ * @endcode
+ * The record layout (header bitmap and field offsets) is computed at compile time and
+ * records are encoded and decoded by straight-line code, without value_t nor type switches.
+ * A typed table is a front end of a memory or file table, which stays accessible through table().
+ */
+template<typename... Fields>
+class typed_table
+{
+public:
+    static_assert(sizeof...(Fields) > 0, "A typed table shall have at least one field.");
+
+    /** Number of fields. */
+    static constexpr size_t field_count = sizeof...(Fields);
+    /** Position of a field in the schema. */
+    template<typename F> static constexpr size_t index_of = typed_detail::index_of<F, Fields...>::value;
+    /** Size of the record header bitmap, in bytes. */
+    static constexpr uint32_t header_size = (uint32_t) (field_count - 1) / 8 + 1;
+    /** Size of an encoded record, in bytes. */
+    static constexpr uint32_t record_size = header_size + (typed_detail::size_of<typename Fields::type>() + ...);
+    /** Maximum size of storage slots, file tables reserve 8 bytes per field. */
+    static constexpr uint32_t max_slot_size = header_size + (uint32_t) field_count * 8;
+
+    /**
+     * Offsets of encoded field values from the begining of records.
+     * Fields are packed, in definition order, after the header bitmap.
+     */
+    static constexpr std::array<uint32_t, field_count> offsets()
+    {
+        constexpr uint32_t sizes[] = {typed_detail::size_of<typename Fields::type>()...};
+        std::array<uint32_t, field_count> res{};
+        uint32_t offset = header_size;
+        for(size_t n = 0; n < field_count; ++n)
+        {
+            res[n] = offset;
+            offset += sizes[n];
+        }
+        return res;
+    }
+
+    /**
+     * Field descriptors of the schema.
+     * @return Field descriptors, in definition order.
+     */
+    static std::vector<field_st> fields()
+    {
+        return {field_st{Fields::name, data_type_of<typename Fields::type>::value}...};
+    }
+
+    /**
+     * Typed record.
+     */
+    class row
+    {
+    public:
+        /** Create a record without any value. */
+        row() = default;
+
+        /**
+         * Test if the record has a value for a field.
+         * @tparam F Field descriptor.
+         * @return True if the field has a value.
+         */
+        template<typename F> bool has()const
+        {
+            constexpr size_t n = index_of<F>;
+            return (_header[n / 8] & (1 << (n % 8))) != 0;
+        }
+
+        /**
+         * Get the value of a field.
+         * @tparam F Field descriptor.
+         * @return Value of the field.
+         * @throw cyclic::no_value_exception if the field has no value.
+         */
+        template<typename F> typename F::type get()const
+        {
+            if(!has<F>())
+            {
+                throw no_value_exception{"Field has no value."};
+            }
+            return std::get<index_of<F>>(_values);
+        }
+
+        /**
+         * Get the value of a field, or a default value if it has none.
+         * @tparam F Field descriptor.
+         * @param default_value Value to return if the field has no value.
+         * @return Value of the field.
+         */
+        template<typename F> typename F::type get_or(typename F::type default_value)const
+        {
+            return has<F>() ? std::get<index_of<F>>(_values) : default_value;
+        }
+
+        /**
+         * Set the value of a field.
+         * @tparam F Field descriptor.
+         * @param value Value to set.
+         * @return The record itself.
+         */
+        template<typename F> row& set(typename F::type value)
+        {
+            constexpr size_t n = index_of<F>;
+            _header[n / 8] |= (uint8_t) (1 << (n % 8));
+            std::get<n>(_values) = value;
+            return *this;
+        }
+
+        /**
+         * Remove the value of a field.
+         * @tparam F Field descriptor.
+         * @return The record itself.
+         */
+        template<typename F> row& reset()
+        {
+            constexpr size_t n = index_of<F>;
+            _header[n / 8] &= (uint8_t) ~(1 << (n % 8));
+            std::get<n>(_values) = typename F::type{};
+            return *this;
+        }
+
+        /**
+         * Retrieve the index of the record.
+         * @return Index of the record, invalid_index() if not retrieved from a table.
+         */
+        record_index_t index()const {return _index;}
+
+    private:
+        friend class typed_table;
+
+        std::array<uint8_t, header_size> _header{};
+        std::tuple<typename Fields::type...> _values{};
+        record_index_t _index = record::invalid_index();
+    };
+
+    /**
+     * Create a typed table stored in memory.
+     * @param record_capacity Table capacity in record number.
+     * @param origin Table time origin.
+     * @param duration Table time duration.
+     * @return Created table.
+     * @see memory::create
+     */
+    static typed_table create(record_index_t record_capacity, record_time_t origin = 0, record_time_t duration = 0)
+    {
+        return typed_table{memory::create(fields(), record_capacity, origin, duration)};
+    }
+
+    /**
+     * Create a typed table stored in a file.
+     * @param filename Name of file to create to store table.
+     * @param record_capacity Table capacity in record number.
+     * @param origin Table time origin.
+     * @param duration Table time duration.
+     * @return Created table.
+     * @see file::create
+     */
+    static typed_table create(const std::string& filename, record_index_t record_capacity,
+            record_time_t origin = 0, record_time_t duration = 0)
+    {
+        return typed_table{file::create(filename, file::COMPACT, fields(), record_capacity, origin, duration)};
+    }
+
+    /**
+     * Open a typed table from a file.
+     * @param filename Name of table file to open.
+     * @param mode Access mode.
+     * @return Opened table.
+     * @throw std::invalid_argument The table does not match the schema.
+     * @see file::open
+     */
+    static typed_table open(const std::string& filename, file::open_mode mode = file::open_mode::read_write)
+    {
+        return typed_table{file::open(filename, mode)};
+    }
+
+    /**
+     * Use an existing table through the schema.
+     * @param table Table to use, its fields and record layout shall match the schema
+     * (slots can be larger than record_size).
+     * @throw std::invalid_argument The table does not match the schema.
+     */
+    explicit typed_table(std::unique_ptr<cyclic::table> table):
+    _table(std::move(table))
+    {
+        if(!_table || _table->field_count() != field_count)
+        {
+            throw std::invalid_argument{"Table does not match the typed schema."};
+        }
+        const std::vector<field_st> descs = fields();
+        constexpr std::array<uint32_t, field_count> offs = offsets();
+        const record_layout& layout = _table->layout();
+        bool match = layout.header_size == header_size
+                && layout.record_size >= record_size && layout.record_size <= max_slot_size;
+        for(field_index_t n = 0; match && n < field_count; ++n)
+        {
+            match = _table->field(n).name() == descs[n].name
+                    && layout.fields[n].type == descs[n].type
+                    && layout.fields[n].offset == offs[n];
+        }
+        if(!match)
+        {
+            throw std::invalid_argument{"Table does not match the typed schema."};
+        }
+    }
+
+    /**
+     * Append a record.
+     * @param rec Record to append.
+     * @param index Index of record to append, invalid_index() to append after the last record.
+     * @throw std::out_of_range Append a record before end of table.
+     * @throw cyclic::table_is_full Table is full, no more record can be append.
+     */
+    void append(const row& rec, record_index_t index = record::invalid_index())
+    {
+        uint8_t data[max_slot_size] = {};
+        encode(rec, data);
+        _table->append_encoded(data, index);
+    }
+
+    /**
+     * Retrieve a record.
+     * @param index Index of the record to retrieve.
+     * @param rec Record to fill.
+     * @return True if a record is stored at this index.
+     */
+    bool get(record_index_t index, row& rec)const
+    {
+        record_view view = _table->get_record_view(index);
+        if(!view)
+        {
+            return false;
+        }
+        decode(view.data(), rec);
+        rec._index = index;
+        return true;
+    }
+
+    /**
+     * Retrieve a record.
+     * @param index Index of the record to retrieve.
+     * @return Record.
+     * @throw std::out_of_range No record is stored at this index.
+     */
+    row get(record_index_t index)const
+    {
+        row rec;
+        if(!get(index, rec))
+        {
+            throw std::out_of_range{"No record stored at this index."};
+        }
+        return rec;
+    }
+
+    /**
+     * Access the underlying table.
+     * @return Underlying table.
+     */
+    cyclic::table& table() {return *_table;}
+    /**
+     * Access the underlying table.
+     * @return Underlying table.
+     */
+    const cyclic::table& table()const {return *_table;}
+
+    /**
+     * Encode a record following the schema layout.
+     * @param rec Record to encode.
+     * @param data Buffer of record_size bytes.
+     */
+    static void encode(const row& rec, uint8_t* data)
+    {
+        std::memcpy(data, rec._header.data(), header_size);
+        encode_values(rec, data, std::index_sequence_for<Fields...>{});
+    }
+
+    /**
+     * Decode a record following the schema layout.
+     * @param data Encoded record.
+     * @param rec Record to fill.
+     */
+    static void decode(const uint8_t* data, row& rec)
+    {
+        std::memcpy(rec._header.data(), data, header_size);
+        decode_values(data, rec, std::index_sequence_for<Fields...>{});
+    }
+
+private:
+    std::unique_ptr<cyclic::table> _table;
+
+    template<size_t... I>
+    static void encode_values(const row& rec, uint8_t* data, std::index_sequence<I...>)
+    {
+        constexpr std::array<uint32_t, field_count> offs = offsets();
+        (typed_detail::store(data + offs[I], std::get<I>(rec._values)), ...);
+    }
+
+    template<size_t... I>
+    static void decode_values(const uint8_t* data, row& rec, std::index_sequence<I...>)
+    {
+        constexpr std::array<uint32_t, field_count> offs = offsets();
+        ((std::get<I>(rec._values) = typed_detail::load<std::tuple_element_t<I, std::tuple<typename Fields::type...>>>(data + offs[I])), ...);
+    }
+};
+
+}} // namespace cyclic::store
+#endif // _CYCLIC_LIBSTORE_TYPED_HPP_
@@ -37,10 +37,18 @@ namespace store
 //
 
 std::unique_ptr<cyclic::table> memory::create(const std::vector<field_st>& fields, record_index_t record_capacity,
-        record_time_t origin, record_time_t duration)
+        record_time_t origin, record_time_t duration, table_options options)
 {
     std::unique_ptr<impl::memory_table_impl> tbl(new impl::memory_table_impl);
-    tbl->create(fields, record_capacity, origin, duration);
+    tbl->create(fields, record_capacity, origin, duration, false, options);
+    return tbl;
+}
+
+std::unique_ptr<cyclic::table> memory::create_timestamped(const std::vector<field_st>& fields, record_index_t record_capacity,
+        table_options options)
+{
+    std::unique_ptr<impl::memory_table_impl> tbl(new impl::memory_table_impl);
+    tbl->create(fields, record_capacity, 0, 0, true, options);
     return tbl;
 }
 
@@ -50,14 +58,22 @@ std::unique_ptr<cyclic::table> memory::create(const std::vector<field_st>& field
 
 std::unique_ptr<cyclic::table> file::create(const std::string& filename, table_type type,
         const std::vector<field_st>& fields, record_index_t record_capacity,
-        record_time_t origin, record_time_t duration)
+        record_time_t origin, record_time_t duration, table_options options)
+{
+    std::unique_ptr<impl::file_table_impl> tbl(new impl::file_table_impl);
+    tbl->create(filename, fields, record_capacity, origin, duration, false, options);
+    return tbl;
+}
+
+std::unique_ptr<cyclic::table> file::create_timestamped(const std::string& filename, table_type type,
+        const std::vector<field_st>& fields, record_index_t record_capacity, table_options options)
 {
     std::unique_ptr<impl::file_table_impl> tbl(new impl::file_table_impl);
-    tbl->create(filename, fields, record_capacity, origin, duration);
+    tbl->create(filename, fields, record_capacity, 0, 0, true, options);
     return tbl;
 }
 
-std::unique_ptr<cyclic::table> file::open(const std::string& filename)
+std::unique_ptr<cyclic::table> file::open(const std::string& filename, open_mode mode)
 {
     if(filename.empty())
     {
@@ -66,7 +82,7 @@ std::unique_ptr<cyclic::table> file::open(const std::string& filename)
     }
 
     io::file file;
-    file.open(filename);
+    file.open(filename, mode == open_mode::read_only);
     if(!file)
     {
         // Handle file problem.
@@ -94,7 +110,7 @@ std::unique_ptr<cyclic::table> file::open(const std::string& filename)
     }
 
     std::unique_ptr<impl::file_table_impl> tbl(new impl::file_table_impl);
-    tbl->open(filename, file, version);
+    tbl->open(filename, std::move(file), version, mode == open_mode::read_only);
     return tbl;
 }
 
@@ -26,6 +26,8 @@
 #include <vector>
 
 #include "common-base.hpp"
+#include "common-join.hpp"
+#include "common-predicate.hpp"
 
 namespace cyclic
 {
@@ -34,6 +36,19 @@ namespace cyclic
  */
 namespace store
 {
+    /**
+     * Table creation options, flags which can be combined.
+     */
+    enum table_option : uint32_t
+    {
+        TABLE_DEFAULT       = 0x0, ///< No option.
+        TABLE_POW2_CAPACITY = 0x1, ///< Capacity is a power of two, record slots are found by masking indexes.
+        TABLE_WIDE_INDEX    = 0x2  ///< Record indexes span 64 bits, instead of 32 bits by default.
+    };
+
+    /** Combination of table_option flags. */
+    typedef uint32_t table_options;
+
     /**
      * Interface for volatile table storage in memory.
      */
@@ -48,15 +63,32 @@ namespace store
          * @param record_capacity Table capacity in record number.
          * @param origin Table time origin.
          * @param duration Table time duration.
+         * @param options Table creation options.
          * @return Created memory table.
          * @throw std::invalid_argument Fields list is empty.
          * This is a non-sense to create a table without fields.
          * @throw std::invalid_argument Record capacity of 0.
          * This is a non-sense to create a table without storage capacity.
          * @throw std::invalid_argument Invalid record capacity.
+         * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
          **/
         static std::unique_ptr<cyclic::table> create(const std::vector<field_st>& fields, record_index_t record_capacity,
-                record_time_t origin = 0, record_time_t duration = 0);
+                record_time_t origin = 0, record_time_t duration = 0, table_options options = TABLE_DEFAULT);
+
+        /**
+         * Create a timestamped table stored in memory.
+         * Each record carries its own time point, records shall be appended in time order.
+         * @param fields Field descriptors for create table.
+         * @param record_capacity Table capacity in record number.
+         * @param options Table creation options.
+         * @return Created memory table.
+         * @throw std::invalid_argument Fields list is empty.
+         * @throw std::invalid_argument Record capacity of 0.
+         * @throw std::invalid_argument Invalid record capacity.
+         * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
+         **/
+        static std::unique_ptr<cyclic::table> create_timestamped(const std::vector<field_st>& fields, record_index_t record_capacity,
+                table_options options = TABLE_DEFAULT);
     };
 
 
@@ -73,6 +105,14 @@ namespace store
                 COMPACT = 0 ///< Compact file (one file)
         };
 
+        /**
+         * Access mode of opened table files.
+         */
+        enum class open_mode {
+                read_write = 0, ///< Read and write the table, if no other writer
+                read_only       ///< Only read the table, through a shared read-only mapping
+        };
+
         /**
          * Create a table stored in a file.
          * @param filename Name of file to create to store table.
@@ -81,24 +121,46 @@ namespace store
          * @param record_capacity Table capacity in record number.
          * @param origin Table time origin.
          * @param duration Table time duration.
+         * @param options Table creation options, saved in the file.
          * @return Created file table.
          * @throw std::invalid_argument Fields list is empty.
          * This is a non-sense to create a table without fields.
          * @throw std::invalid_argument Record capacity of 0.
          * This is a non-sense to create a table without storage capacity.
          * @throw std::invalid_argument Invalid record capacity.
+         * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
          */
         static std::unique_ptr<cyclic::table> create(const std::string& filename, table_type type,
             const std::vector<field_st>& fields, record_index_t record_capacity,
-            record_time_t origin = 0, record_time_t duration = 0);
+            record_time_t origin = 0, record_time_t duration = 0, table_options options = TABLE_DEFAULT);
+        /**
+         * Create a timestamped table stored in a file.
+         * Each record carries its own time point, records shall be appended in time order.
+         * @param filename Name of file to create to store table.
+         * @param type Type of table to create.
+         * @param fields Field descriptors for create table.
+         * @param record_capacity Table capacity in record number.
+         * @param options Table creation options, saved in the file.
+         * @return Created file table.
+         * @throw std::invalid_argument Fields list is empty.
+         * @throw std::invalid_argument Record capacity of 0.
+         * @throw std::invalid_argument Invalid record capacity.
+         * @throw std::invalid_argument Record capacity is not a power of two with TABLE_POW2_CAPACITY.
+         */
+        static std::unique_ptr<cyclic::table> create_timestamped(const std::string& filename, table_type type,
+            const std::vector<field_st>& fields, record_index_t record_capacity, table_options options = TABLE_DEFAULT);
         /**
          * Open a table from a file.
+         * In read-only mode, the file is opened for reading only and its records are
+         * read from a shared memory mapping, so that reader processes share page cache.
+         * All modification calls on a read-only table throw std::logic_error.
          * @param filename Name of table file to open.
+         * @param mode Access mode.
          * @return Opened file table.
          * @throw std::invalid_argument Filename shall be specified.
          * @throw cyclic::io::io_exception An I/O exception occurs.
          */
-        static std::unique_ptr<cyclic::table> open(const std::string& filename);
+        static std::unique_ptr<cyclic::table> open(const std::string& filename, open_mode mode = open_mode::read_write);
     };
 
 }} // namespace cyclic::store
@@ -22,6 +22,7 @@
 #include "store-parser-commands.hpp"
 
 #include <array>
+#include <map>
 
 namespace cyclicstore
 {
@@ -72,6 +73,209 @@ const std::array<std::string, cyclic::CDB_DT_MAX_TYPE> field_type_canonical_name
 
 namespace commands
 {
+    /*
+     * Compute the index range designated by start and end positions.
+     */
+    static void resolve_range(std::shared_ptr<cyclic::store::impl::file_table_impl> table,
+            const helpers::position& start, const helpers::position& end,
+            cyclic::record_index_t& min, cyclic::record_index_t& max)
+    {
+        if(start.state()==helpers::position::TIME)
+        {
+            // Records of timestamped tables begin at their own time,
+            // a range starting before the first stored record starts with it.
+            min = table->timestamped() && table->record_count()>0 && start.time() < table->record_time(table->min_index())
+                    ? table->min_index()
+                    : table->record_index(start.time());
+        }
+        else if(start.state()==helpers::position::INDEX)
+        {
+            min = start.index();
+        }
+        else
+        {
+            min = table->min_index();
+        }
+
+        if(end.state()==helpers::position::TIME)
+        {
+            max = table->record_index(end.time());
+        }
+        else if(end.state()==helpers::position::INDEX)
+        {
+            max = end.index();
+        }
+        else
+        {
+            max = cyclic::record::absolute_max_index();
+        }
+    }
+
+    /*
+     * Compute the joined record range designated by start and end positions.
+     */
+    static void resolve_range(const cyclic::time_join& join,
+            const helpers::position& start, const helpers::position& end,
+            cyclic::record_index_t& min, cyclic::record_index_t& max)
+    {
+        if(start.state()==helpers::position::TIME)
+        {
+            min = start.time() < join.record_origin() ? 0 : join.record_index(start.time());
+        }
+        else if(start.state()==helpers::position::INDEX)
+        {
+            min = start.index();
+        }
+        else
+        {
+            min = join.min_index();
+        }
+
+        if(end.state()==helpers::position::TIME)
+        {
+            max = end.time() < join.record_origin() ? 0 : join.record_index(end.time());
+        }
+        else if(end.state()==helpers::position::INDEX)
+        {
+            max = end.index();
+        }
+        else
+        {
+            max = cyclic::record::absolute_max_index();
+        }
+    }
+
+    /*
+     * Build the predicate corresponding to a condition, resolving field names.
+     */
+    static boost::optional<cyclic::predicate> resolve_condition(const cyclic::recordset& table,
+            const helpers::condition& cond)
+    {
+        if(cond.type==cyclic::predicate::AND || cond.type==cyclic::predicate::OR)
+        {
+            boost::optional<cyclic::predicate> left = resolve_condition(table, *cond.left);
+            boost::optional<cyclic::predicate> right = resolve_condition(table, *cond.right);
+            if(!left || !right)
+            {
+                return boost::none;
+            }
+            return cond.type==cyclic::predicate::AND ? *left && *right : *left || *right;
+        }
+
+        cyclic::field_index_t f = table.field_index(cond.column);
+        if(f==cyclic::field::invalid_index())
+        {
+            std::cerr << "Cannot find field '" << cond.column << "'." << std::endl;
+            return boost::none;
+        }
+
+        switch(cond.type)
+        {
+        case cyclic::predicate::IS_NULL:
+            return cyclic::predicate::is_null(f);
+        case cyclic::predicate::IS_NOT_NULL:
+            return cyclic::predicate::is_not_null(f);
+        default:
+            return cyclic::predicate::compare(f, cond.op, cond.value);
+        }
+    }
+
+    /*
+     * Values of a column for a block of records.
+     * Values are read in their stored type and formatted by a kernel
+     * instantiated for this type, without going through value_t.
+     */
+    struct column_block
+    {
+        virtual ~column_block() = default;
+
+        /*
+         * Read values of records [first, last] and format those at specified offsets.
+         */
+        virtual void format(const cyclic::table& table, cyclic::field_index_t field,
+                cyclic::record_index_t first, cyclic::record_index_t last,
+                const std::vector<cyclic::record_index_t>& offsets, std::vector<std::string>& out) = 0;
+    };
+
+    template<typename T>
+    struct typed_column_block : public column_block
+    {
+        std::unique_ptr<T[]> values;
+        std::vector<uint8_t> validity;
+        size_t capacity = 0;
+
+        void format(const cyclic::table& table, cyclic::field_index_t field,
+                cyclic::record_index_t first, cyclic::record_index_t last,
+                const std::vector<cyclic::record_index_t>& offsets, std::vector<std::string>& out) override
+        {
+            size_t count = (size_t) last - first + 1;
+            if(count > capacity)
+            {
+                values.reset(new T[count]);
+                validity.resize((count - 1) / 8 + 1);
+                capacity = count;
+            }
+            table.read_column<T>(field, first, last, values.get(), validity.data());
+
+            intrnal::to_string str;
+            out.resize(offsets.size());
+            for(size_t n=0; n<offsets.size(); ++n)
+            {
+                cyclic::record_index_t o = offsets[n];
+                out[n] = (validity[o / 8] & (1 << (o % 8))) ? str(values[o]) : str(std::monostate{});
+            }
+        }
+    };
+
+    static std::unique_ptr<column_block> make_column_block(cyclic::data_type type)
+    {
+        switch(type)
+        {
+        case cyclic::CDB_DT_BOOLEAN: return std::unique_ptr<column_block>(new typed_column_block<bool>);
+        case cyclic::CDB_DT_SIGNED_8: return std::unique_ptr<column_block>(new typed_column_block<int8_t>);
+        case cyclic::CDB_DT_UNSIGNED_8: return std::unique_ptr<column_block>(new typed_column_block<uint8_t>);
+        case cyclic::CDB_DT_SIGNED_16: return std::unique_ptr<column_block>(new typed_column_block<int16_t>);
+        case cyclic::CDB_DT_UNSIGNED_16: return std::unique_ptr<column_block>(new typed_column_block<uint16_t>);
+        case cyclic::CDB_DT_SIGNED_32: return std::unique_ptr<column_block>(new typed_column_block<int32_t>);
+        case cyclic::CDB_DT_UNSIGNED_32: return std::unique_ptr<column_block>(new typed_column_block<uint32_t>);
+        case cyclic::CDB_DT_SIGNED_64: return std::unique_ptr<column_block>(new typed_column_block<int64_t>);
+        case cyclic::CDB_DT_UNSIGNED_64: return std::unique_ptr<column_block>(new typed_column_block<uint64_t>);
+        case cyclic::CDB_DT_FLOAT_4: return std::unique_ptr<column_block>(new typed_column_block<float>);
+        case cyclic::CDB_DT_FLOAT_8:
+        default: return std::unique_ptr<column_block>(new typed_column_block<double>);
+        }
+    }
+
+    /*
+     * Format an aggregation result.
+     */
+    static std::string aggregate_to_str(const cyclic::aggregate_result& res, cyclic::aggregate_op op)
+    {
+        if(op==cyclic::AGGREGATE_COUNT)
+        {
+            return std::to_string(res.count);
+        }
+        if(res.count==0)
+        {
+            return "<null>";
+        }
+        return std::to_string(res.value(op));
+    }
+
+    /*
+     * Operations computed on counters, and not by aggregation of values.
+     */
+    static const cyclic::aggregate_ops COUNTER_OPS = cyclic::AGGREGATE_INCREASE | cyclic::AGGREGATE_RATE;
+
+    static std::string counter_to_str(const cyclic::counter_result& res, cyclic::aggregate_op op)
+    {
+        if(op==cyclic::AGGREGATE_INCREASE)
+        {
+            return res.count==0 ? "<null>" : std::to_string(res.increase);
+        }
+        return res.elapsed==0 ? "<null>" : std::to_string(res.rate());
+    }
+
     //
     // query_with_colnames
     //
@@ -90,13 +294,13 @@ namespace commands
     }
 
 
-    bool query_with_colnames::deduce_columns(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
+    bool query_with_colnames::deduce_columns(const cyclic::recordset& table)
     {
         _columns.clear();
         if(_colnames.empty())
         {
-            _columns.reserve(table->field_count());
-            for(cyclic::field_index_t f=0; f<table->field_count(); ++f)
+            _columns.reserve(table.field_count());
+            for(cyclic::field_index_t f=0; f<table.field_count(); ++f)
             {
                 _columns.push_back(f);
             }
@@ -107,21 +311,13 @@ namespace commands
             _columns.reserve(_colnames.size());
             for(size_t n=0; n<_colnames.size(); ++n)
             {
-                bool found = false;
-                for(cyclic::field_index_t f=0; f<table->field_count(); ++f)
-                {
-                    if(table->field(f).name()==_colnames[n])
-                    {
-                        _columns.push_back(f);
-                        found = true;
-                        break;
-                    }
-                }
-                if(!found)
+                cyclic::field_index_t f = table.field_index(_colnames[n]);
+                if(f==cyclic::field::invalid_index())
                 {
                     std::cerr << "Cannot find field '" << _colnames[n] << "'." << std::endl;
                     return false;
                 }
+                _columns.push_back(f);
             }
             return true;
         }
@@ -156,16 +352,22 @@ namespace commands
     //
     select::select(const boost::optional<std::vector<std::string>>& colnames,
             const helpers::position& start,
-            const helpers::position& end):
+            const helpers::position& end,
+            const helpers::condition_ptr& where):
     query_with_colnames(colnames),
     _start(start),
-    _end(end)
+    _end(end),
+    _where(where)
     {
     }
 
     bool select::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
     {
-        if(!deduce_columns(table))
+        if(!deduce_columns(*table))
+            return false;
+
+        boost::optional<cyclic::predicate> where;
+        if(_where && !(where = resolve_condition(*table, *_where)))
             return false;
 
         if(table->record_count()==0)
@@ -174,7 +376,7 @@ namespace commands
             return false;
         }
 
-        if(table->record_duration()==0 && (
+        if(table->record_duration()==0 && !table->timestamped() && (
                 start().state()==helpers::position::TIME
                 || end().state()==helpers::position::TIME
                 ))
@@ -197,44 +399,442 @@ namespace commands
         std::cout << std::endl;
 
         cyclic::record_index_t min, max;
+        resolve_range(table, start(), end(), min, max);
+        min = std::max(min, table->min_index());
+        max = std::min(max, table->max_index());
+
+        // Records are processed by blocks: matching records are selected by the storage,
+        // then each column is read and formatted for the whole block at once.
+        static constexpr cyclic::record_index_t block_size = 4096;
+        std::vector<std::unique_ptr<column_block>> blocks;
+        for(cyclic::field_index_t column : _columns)
+        {
+            blocks.push_back(make_column_block(table->field(column).type()));
+        }
+        std::vector<std::vector<std::string>> cells(_columns.size());
+        std::vector<cyclic::record_index_t> offsets;
 
-        if(start().state()==helpers::position::TIME)
+        for(uint64_t first = min; first <= max; first += block_size)
         {
-            min = table->record_index(start().time());
+            cyclic::record_index_t last = (cyclic::record_index_t) std::min<uint64_t>(max, first + block_size - 1);
+            offsets.clear();
+            if(where)
+            {
+                for(cyclic::record_index_t r : table->filter(*where, first, last))
+                {
+                    offsets.push_back(r - first);
+                }
+            }
+            else
+            {
+                for(cyclic::record_index_t o = 0; o <= last - first; ++o)
+                {
+                    offsets.push_back(o);
+                }
+            }
+            if(offsets.empty())
+            {
+                continue;
+            }
+
+            for(size_t n=0; n<_columns.size(); ++n)
+            {
+                blocks[n]->format(*table, _columns[n], first, last, offsets, cells[n]);
+            }
+            for(size_t row=0; row<offsets.size(); ++row)
+            {
+                std::cout << first + offsets[row];
+                for(size_t n=0; n<_columns.size(); ++n)
+                {
+                    std::cout << "\t" << cells[n][row];
+                }
+                std::cout << '\n';
+            }
         }
-        else if(start().state()==helpers::position::INDEX)
+        std::cout.flush();
+        return true;
+    }
+
+    bool select::execute_joined(const cyclic::time_join& join)
+    {
+        if(!deduce_columns(join))
+            return false;
+
+        boost::optional<cyclic::predicate> where;
+        if(_where && !(where = resolve_condition(join, *_where)))
+            return false;
+
+        if(join.record_count()==0)
         {
-            min = start().index();
+            std::cerr << "Table is empty." << std::endl;
+            return false;
         }
-        else
+
+        // Print headers
+        std::cout << "index";
+        for(size_t n=0; n<_columns.size(); ++n)
         {
-            min = table->min_index();
+                std::cout << "\t" << n;
         }
+        std::cout << std::endl;
+        for(size_t n=0; n<_columns.size(); ++n)
+        {
+                std::cout << "\t" << join.field(_columns[n]).name();
+        }
+        std::cout << std::endl;
 
-        if(end().state()==helpers::position::TIME)
+        cyclic::record_index_t min, max;
+        resolve_range(join, start(), end(), min, max);
+        if(min <= max)
         {
-            max = table->record_index(end().time());
+            join.scan(min, max, [&](const cyclic::record& rec) {
+                if(where && !where->matches(rec))
+                {
+                    return;
+                }
+                std::cout << rec.index();
+                for(cyclic::field_index_t column : _columns)
+                {
+                    std::cout << "\t" << val_to_str(rec.get(column));
+                }
+                std::cout << '\n';
+            });
         }
-        else if(end().state()==helpers::position::INDEX)
+        std::cout.flush();
+        return true;
+    }
+
+    //
+    // select_aggregate
+    //
+    select_aggregate::select_aggregate(const std::vector<helpers::aggregate_item>& items,
+            const helpers::position& start,
+            const helpers::position& end,
+            const helpers::position& group):
+    _items(items),
+    _start(start),
+    _end(end),
+    _group(group)
+    {
+    }
+
+    bool select_aggregate::resolve_items(const cyclic::recordset& rs)
+    {
+        // Resolve columns and group requested operations per column.
+        _columns.clear();
+        _ops.clear();
+        for(const helpers::aggregate_item& item : _items)
         {
-            max = end().index();
+            cyclic::field_index_t f = rs.field_index(item.column);
+            if(f==cyclic::field::invalid_index())
+            {
+                std::cerr << "Cannot find field '" << item.column << "'." << std::endl;
+                return false;
+            }
+            if(item.op & COUNTER_OPS)
+            {
+                if(dynamic_cast<const cyclic::table*>(&rs)==nullptr)
+                {
+                    std::cerr << "Counter operations are not supported on joined tables." << std::endl;
+                    return false;
+                }
+                cyclic::data_type type = rs.field(f).type();
+                if(type!=cyclic::CDB_DT_UNSIGNED_8 && type!=cyclic::CDB_DT_UNSIGNED_16
+                        && type!=cyclic::CDB_DT_UNSIGNED_32 && type!=cyclic::CDB_DT_UNSIGNED_64)
+                {
+                    std::cerr << "Field '" << item.column << "' is not a counter (unsigned integer)." << std::endl;
+                    return false;
+                }
+            }
+            _columns.push_back(f);
+            _ops[f] |= item.op;
         }
-        else
+
+        if(rs.record_count()==0)
         {
-            max = cyclic::record::absolute_max_index();
+            std::cerr << "Table is empty." << std::endl;
+            return false;
         }
+        return true;
+    }
 
-        for(cyclic::record_index_t r = std::max(min, table->min_index());
-                r <= std::min(max, table->max_index()); ++r)
+    bool select_aggregate::output(const cyclic::recordset& rs, cyclic::record_index_t min, cyclic::record_index_t max,
+            cyclic::record_index_t bucket_size)
+    {
+        min = std::max(min, rs.min_index());
+        max = std::min(max, rs.max_index());
+
+        // Print headers
+        std::cout << "index";
+        for(size_t n=0; n<_items.size(); ++n)
         {
-            std::cout << r;
-            auto rec = table->get_record(r);
-            for(size_t n=0; n<_columns.size(); ++n)
+                std::cout << "\t" << n;
+        }
+        std::cout << std::endl;
+        for(size_t n=0; n<_items.size(); ++n)
+        {
+                std::cout << "\t" << cyclic::aggregate_op_name(_items[n].op) << "(" << _items[n].column << ")";
+        }
+        std::cout << std::endl;
+
+        // Counter operations are only resolved on tables.
+        const cyclic::table* table = dynamic_cast<const cyclic::table*>(&rs);
+
+        if(bucket_size != 0)
+        {
+            // One row per bucket, all columns share the same buckets.
+            std::map<cyclic::field_index_t, std::vector<cyclic::aggregate_bucket>> buckets;
+            std::map<cyclic::field_index_t, std::vector<cyclic::counter_bucket>> counters;
+            std::vector<cyclic::record_index_t> rows;
+            if(min <= max)
             {
-                std::cout << "\t" << val_to_str((*rec)[_columns[n]]);
+                for(const auto& op : _ops)
+                {
+                    if(op.second & cyclic::AGGREGATE_ALL)
+                    {
+                        buckets[op.first] = rs.group_by(op.first, min, max, bucket_size, op.second & cyclic::AGGREGATE_ALL);
+                        rows.clear();
+                        for(const cyclic::aggregate_bucket& bucket : buckets[op.first])
+                        {
+                            rows.push_back(bucket.first);
+                        }
+                    }
+                    if(op.second & COUNTER_OPS)
+                    {
+                        counters[op.first] = table->counter_by(op.first, min, max, bucket_size);
+                        rows.clear();
+                        for(const cyclic::counter_bucket& bucket : counters[op.first])
+                        {
+                            rows.push_back(bucket.first);
+                        }
+                    }
+                }
+            }
+            for(size_t row=0; row<rows.size(); ++row)
+            {
+                std::cout << rows[row];
+                for(size_t n=0; n<_items.size(); ++n)
+                {
+                    if(_items[n].op & COUNTER_OPS)
+                    {
+                        std::cout << "\t" << counter_to_str(counters[_columns[n]][row].result, _items[n].op);
+                    }
+                    else
+                    {
+                        std::cout << "\t" << aggregate_to_str(buckets[_columns[n]][row].result, _items[n].op);
+                    }
+                }
+                std::cout << std::endl;
             }
-            std::cout << std::endl;
+            return true;
         }
+
+        std::map<cyclic::field_index_t, cyclic::aggregate_result> results;
+        std::map<cyclic::field_index_t, cyclic::counter_result> counters;
+        if(min <= max)
+        {
+            for(const auto& op : _ops)
+            {
+                if(op.second & cyclic::AGGREGATE_ALL)
+                {
+                    results[op.first] = rs.aggregate(op.first, min, max, op.second & cyclic::AGGREGATE_ALL);
+                }
+                if(op.second & COUNTER_OPS)
+                {
+                    counters[op.first] = table->counter(op.first, min, max);
+                }
+            }
+        }
+
+        std::cout << min;
+        for(size_t n=0; n<_items.size(); ++n)
+        {
+            if(_items[n].op & COUNTER_OPS)
+            {
+                std::cout << "\t" << counter_to_str(counters[_columns[n]], _items[n].op);
+            }
+            else
+            {
+                std::cout << "\t" << aggregate_to_str(results[_columns[n]], _items[n].op);
+            }
+        }
+        std::cout << std::endl;
+        return true;
+    }
+
+    bool select_aggregate::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
+    {
+        if(!resolve_items(*table))
+            return false;
+
+        if(table->record_duration()==0 && !table->timestamped() && (
+                start().state()==helpers::position::TIME
+                || end().state()==helpers::position::TIME
+                || group().state()==helpers::position::TIME
+                ))
+        {
+            std::cerr << "Table does not support time." << std::endl;
+            return false;
+        }
+
+        // Resolve bucket size, in records.
+        cyclic::record_index_t bucket_size = 0;
+        if(group().state()==helpers::position::INDEX)
+        {
+            bucket_size = group().index();
+        }
+        else if(group().state()==helpers::position::TIME)
+        {
+            if(table->timestamped())
+            {
+                std::cerr << "Timestamped table records cannot be grouped by time interval." << std::endl;
+                return false;
+            }
+            if(group().time() > 0 && group().time() % table->record_duration() == 0)
+            {
+                bucket_size = group().time() / table->record_duration();
+            }
+        }
+        if(group().state()!=helpers::position::NONE && bucket_size==0)
+        {
+            std::cerr << "Group interval must be a positive multiple of record duration ("
+                    << table->record_duration() << ")." << std::endl;
+            return false;
+        }
+
+        cyclic::record_index_t min, max;
+        resolve_range(table, start(), end(), min, max);
+        return output(*table, min, max, bucket_size);
+    }
+
+    bool select_aggregate::execute_joined(const cyclic::time_join& join)
+    {
+        if(!resolve_items(join))
+            return false;
+
+        // Resolve bucket size, in joined records.
+        cyclic::record_index_t bucket_size = 0;
+        if(group().state()==helpers::position::INDEX)
+        {
+            bucket_size = group().index();
+        }
+        else if(group().state()==helpers::position::TIME
+                && group().time() > 0 && group().time() % join.record_duration() == 0)
+        {
+            bucket_size = group().time() / join.record_duration();
+        }
+        if(group().state()!=helpers::position::NONE && bucket_size==0)
+        {
+            std::cerr << "Group interval must be a positive multiple of joined record duration ("
+                    << join.record_duration() << ")." << std::endl;
+            return false;
+        }
+
+        cyclic::record_index_t min, max;
+        resolve_range(join, start(), end(), min, max);
+        return output(join, min, max, bucket_size);
+    }
+
+    /*
+     * Check positions of a single column query and resolve its column and range.
+     */
+    static bool resolve_column_range(std::shared_ptr<cyclic::store::impl::file_table_impl> table,
+            const std::string& column, const helpers::position& start, const helpers::position& end,
+            cyclic::field_index_t& field, cyclic::record_index_t& min, cyclic::record_index_t& max)
+    {
+        field = table->field_index(column);
+        if(field==cyclic::field::invalid_index())
+        {
+            std::cerr << "Cannot find field '" << column << "'." << std::endl;
+            return false;
+        }
+
+        if(table->record_count()==0)
+        {
+            std::cerr << "Table is empty." << std::endl;
+            return false;
+        }
+
+        if(table->record_duration()==0 && !table->timestamped() && (
+                start.state()==helpers::position::TIME
+                || end.state()==helpers::position::TIME
+                ))
+        {
+            std::cerr << "Table does not support time." << std::endl;
+            return false;
+        }
+
+        resolve_range(table, start, end, min, max);
+        min = std::max(min, table->min_index());
+        max = std::min(max, table->max_index());
+        return true;
+    }
+
+    //
+    // select_top
+    //
+    select_top::select_top(bool largest, const std::string& column, cyclic::record_index_t count,
+            const helpers::position& start,
+            const helpers::position& end):
+    _largest(largest),
+    _column(column),
+    _count(count),
+    _start(start),
+    _end(end)
+    {
+    }
+
+    bool select_top::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
+    {
+        cyclic::field_index_t field;
+        cyclic::record_index_t min, max;
+        if(!resolve_column_range(table, _column, _start, _end, field, min, max))
+            return false;
+
+        std::cout << "index\t0" << std::endl;
+        std::cout << "\t" << (_largest ? "top" : "bottom") << "(" << _column << ")" << std::endl;
+        if(min <= max)
+        {
+            for(const cyclic::ranked_value& val : table->top_k(field, min, max, _count, _largest))
+            {
+                std::cout << val.index << "\t" << std::to_string(val.value) << '\n';
+            }
+        }
+        std::cout.flush();
+        return true;
+    }
+
+    //
+    // select_crossings
+    //
+    select_crossings::select_crossings(const std::string& column, double threshold,
+            const helpers::position& start,
+            const helpers::position& end):
+    _column(column),
+    _threshold(threshold),
+    _start(start),
+    _end(end)
+    {
+    }
+
+    bool select_crossings::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
+    {
+        cyclic::field_index_t field;
+        cyclic::record_index_t min, max;
+        if(!resolve_column_range(table, _column, _start, _end, field, min, max))
+            return false;
+
+        std::cout << "index\t0\t1" << std::endl;
+        std::cout << "\t" << _column << "\tcrossing" << std::endl;
+        if(min <= max)
+        {
+            for(const cyclic::threshold_crossing& cross : table->crossings(field, min, max, _threshold))
+            {
+                std::cout << cross.index << "\t" << std::to_string(cross.value)
+                        << "\t" << (cross.rising ? "rising" : "falling") << '\n';
+            }
+        }
+        std::cout.flush();
         return true;
     }
 
@@ -250,7 +850,7 @@ namespace commands
 
     bool insert::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
     {
-        if(!deduce_columns(table))
+        if(!deduce_columns(*table))
             return false;
 
         cyclic::raw_record rec;
@@ -294,7 +894,7 @@ namespace commands
 
     bool set::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
     {
-        if(!deduce_columns(table))
+        if(!deduce_columns(*table))
             return false;
 
         cyclic::raw_record rec;
@@ -340,7 +940,7 @@ namespace commands
 
     bool append::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
     {
-        if(!deduce_columns(table))
+        if(!deduce_columns(*table))
             return false;
 
         cyclic::raw_record rec;
@@ -378,7 +978,7 @@ namespace commands
 
     bool reset::execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table)
     {
-        if(!deduce_columns(table))
+        if(!deduce_columns(*table))
             return false;
 
         // TODO
@@ -434,6 +1034,15 @@ namespace commands
         return select::execute(table);
     }
 
+    //
+    // query
+    //
+    bool query::execute_joined(const cyclic::time_join& /*join*/)
+    {
+        std::cerr << "This command is not supported on joined tables." << std::endl;
+        return false;
+    }
+
     //
     // status
     //
@@ -463,6 +1072,8 @@ namespace commands
             std::cout
                             << "Definition" << std::endl
                             << "  Fields      : " << table->field_count() << std::endl;
+            if(table->timestamped())
+                std::cout   << "  Time        : timestamped records" << std::endl;
 
             for(cyclic::field_index_t f=0; f<table->field_count(); ++f)
             {
@@ -544,14 +1155,50 @@ bool command_executor::parse_and_execute(const std::string& command)
 }
 
 
+bool command_executor::open_join()
+{
+    std::vector<cyclic::time_join::source> sources;
+    std::vector<std::string> filenames{filename};
+    filenames.insert(filenames.end(), joined_filenames.begin(), joined_filenames.end());
+    for(const std::string& name : filenames)
+    {
+        std::shared_ptr<cyclic::recordset> tbl = cyclic::store::file::open(name, mode);
+        if(!tbl)
+        {
+            std::cerr << "Cannot open file '" << name << "'" << std::endl;
+            return false;
+        }
+        // Fields are prefixed by the file name, without directory and extension.
+        std::string prefix = name.substr(name.find_last_of('/') + 1);
+        prefix = prefix.substr(0, prefix.find_last_of('.')) + ".";
+        sources.push_back({std::dynamic_pointer_cast<const cyclic::table>(tbl), prefix});
+    }
+    join.reset(new cyclic::time_join(sources));
+    return true;
+}
+
 bool command_executor::execute(commands::command* command)
 {
+    if(!joined_filenames.empty())
+    {
+        commands::query* query = dynamic_cast<commands::query*>(command);
+        if(!query)
+        {
+            std::cerr << "This command is not supported on joined tables." << std::endl;
+            return false;
+        }
+        if(!join && !open_join())
+        {
+            return false;
+        }
+        return query->execute_joined(*join);
+    }
     if(commands::query* query = dynamic_cast<commands::query*>(command))
     {
         // Open table if not already done
         if(!table)
         {
-            std::shared_ptr<cyclic::recordset> tbl = cyclic::store::file::open(filename);
+            std::shared_ptr<cyclic::recordset> tbl = cyclic::store::file::open(filename, mode);
             if(!tbl)
             {
                 std::cerr << "Cannot open file '" << filename << "'" << std::endl;
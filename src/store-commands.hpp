@@ -22,6 +22,7 @@
 #define _CYCLIC_STORE_COMMANDS_HPP_
 
 #include <iostream>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -73,6 +74,31 @@ public:
     cyclic::record_index_t index()const{return _index;}
     cyclic::record_time_t time()const{return _time;}
 };
+
+/**
+ * Aggregation of a column, as in 'avg(cpu)'.
+ */
+struct aggregate_item
+{
+    cyclic::aggregate_op op;
+    std::string column;
+};
+
+/**
+ * Condition of a 'where' clause, as in 'errors > 0 and host is not null'.
+ * Fields are referenced by name, resolved against the table at execution.
+ */
+struct condition
+{
+    cyclic::predicate::kind type;
+    std::string column;
+    cyclic::predicate::comparison op = cyclic::predicate::EQUAL;
+    double value = 0;
+    std::shared_ptr<condition> left, right;
+};
+
+typedef std::shared_ptr<condition> condition_ptr;
+
 } // namespace helpers
 
 /**
@@ -92,6 +118,11 @@ class query : public command
 public:
     virtual ~query() = default;
     virtual bool execute(std::shared_ptr<cyclic::store::impl::file_table_impl> table) = 0;
+    /**
+     * Execute the query over tables joined on time.
+     * Only reading queries support it, others report an error.
+     */
+    virtual bool execute_joined(const cyclic::time_join& join);
 };
 
 
@@ -105,7 +136,7 @@ protected:
     query_with_colnames(const boost::optional<std::vector<std::string>>& colnames);
     query_with_colnames(const std::vector<std::string>& colnames);
 
-    bool deduce_columns(std::shared_ptr<cyclic::store::impl::file_table_impl>);
+    bool deduce_columns(const cyclic::recordset& table);
 public:
     virtual ~query_with_colnames() = default;
 
@@ -118,18 +149,107 @@ class select : public query_with_colnames
 {
 protected:
     helpers::position _start , _end;
+    /** Condition records shall match, nullptr if none. */
+    helpers::condition_ptr _where;
 
     select() = default;
 
 public:
     select(const boost::optional<std::vector<std::string>>& colnames,
         const helpers::position& start,
-        const helpers::position& end);
+        const helpers::position& end,
+        const helpers::condition_ptr& where = nullptr);
     virtual ~select() = default;
     virtual bool execute(std::shared_ptr<cyclic::store::impl::file_table_impl>) override;
+    virtual bool execute_joined(const cyclic::time_join& join) override;
 
     const helpers::position& start()const {return _start;}
     const helpers::position& end()const {return _end;}
+    const helpers::condition_ptr& where()const {return _where;}
+};
+
+
+class select_aggregate : public query
+{
+protected:
+    std::vector<helpers::aggregate_item> _items;
+    helpers::position _start , _end;
+    /** Bucket size, as a number of records (INDEX) or an interval (TIME), NONE if not grouped. */
+    helpers::position _group;
+    /** Resolved column of each item. */
+    std::vector<cyclic::field_index_t> _columns;
+    /** Requested operations per resolved column. */
+    std::map<cyclic::field_index_t, cyclic::aggregate_ops> _ops;
+
+    /** Resolve item columns against a recordset, which shall not be empty. */
+    bool resolve_items(const cyclic::recordset& rs);
+    /** Compute and print aggregates over a record range, per bucket if bucket_size is not 0. */
+    bool output(const cyclic::recordset& rs, cyclic::record_index_t min, cyclic::record_index_t max,
+            cyclic::record_index_t bucket_size);
+
+public:
+    select_aggregate(const std::vector<helpers::aggregate_item>& items,
+        const helpers::position& start,
+        const helpers::position& end,
+        const helpers::position& group = helpers::position{});
+    virtual ~select_aggregate() = default;
+    virtual bool execute(std::shared_ptr<cyclic::store::impl::file_table_impl>) override;
+    virtual bool execute_joined(const cyclic::time_join& join) override;
+
+    const std::vector<helpers::aggregate_item>& items()const {return _items;}
+    const helpers::position& start()const {return _start;}
+    const helpers::position& end()const {return _end;}
+    const helpers::position& group()const {return _group;}
+};
+
+
+/**
+ * Largest or smallest values of a column, as in 'select top(cpu, 10)'.
+ */
+class select_top : public query
+{
+protected:
+    bool _largest;
+    std::string _column;
+    cyclic::record_index_t _count;
+    helpers::position _start , _end;
+
+public:
+    select_top(bool largest, const std::string& column, cyclic::record_index_t count,
+        const helpers::position& start,
+        const helpers::position& end);
+    virtual ~select_top() = default;
+    virtual bool execute(std::shared_ptr<cyclic::store::impl::file_table_impl>) override;
+
+    bool largest()const {return _largest;}
+    const std::string& column()const {return _column;}
+    cyclic::record_index_t count()const {return _count;}
+    const helpers::position& start()const {return _start;}
+    const helpers::position& end()const {return _end;}
+};
+
+
+/**
+ * Crossings of a threshold by a column, as in 'select crossings(cpu, 90)'.
+ */
+class select_crossings : public query
+{
+protected:
+    std::string _column;
+    double _threshold;
+    helpers::position _start , _end;
+
+public:
+    select_crossings(const std::string& column, double threshold,
+        const helpers::position& start,
+        const helpers::position& end);
+    virtual ~select_crossings() = default;
+    virtual bool execute(std::shared_ptr<cyclic::store::impl::file_table_impl>) override;
+
+    const std::string& column()const {return _column;}
+    double threshold()const {return _threshold;}
+    const helpers::position& start()const {return _start;}
+    const helpers::position& end()const {return _end;}
 };
 
 
@@ -281,12 +401,32 @@ class command_executor
 protected:
 
     std::string filename;
+    cyclic::store::file::open_mode mode;
 
     std::shared_ptr<cyclic::store::impl::file_table_impl> table;
 
+    /** Files joined to the main one, on time. */
+    std::vector<std::string> joined_filenames;
+    /** Join of main and joined files, opened at first query. */
+    std::unique_ptr<cyclic::time_join> join;
+
+    /** Open the main file and the joined ones, and join them. */
+    bool open_join();
 
 public:
-    command_executor(const std::string& filename):filename(filename){}
+    command_executor(const std::string& filename,
+            cyclic::store::file::open_mode mode = cyclic::store::file::open_mode::read_write):
+        filename(filename), mode(mode){}
+
+    /**
+     * Execute commands over several files joined on time.
+     * Fields are prefixed by their file name, without directory and extension (as in 'cpu.load').
+     * @param filenames Files to join, the first one being the main file.
+     * @param mode Open mode of files.
+     */
+    command_executor(const std::vector<std::string>& filenames,
+            cyclic::store::file::open_mode mode = cyclic::store::file::open_mode::read_only):
+        filename(filenames.front()), mode(mode), joined_filenames(filenames.begin() + 1, filenames.end()){}
 
     bool parse_and_execute(const std::string& command);
 
@@ -38,6 +38,12 @@ BOOST_FUSION_ADAPT_STRUCT(
     (cyclic::data_type, type)
 )
 
+BOOST_FUSION_ADAPT_STRUCT(
+    cyclicstore::helpers::aggregate_item,
+    (cyclic::aggregate_op, op)
+    (std::string, column)
+)
+
 
 namespace cyclicstore
 {
@@ -101,6 +107,68 @@ struct types_ : qi::symbols<char, cyclic::data_type>
 
 };
 
+struct aggregates_ : qi::symbols<char, cyclic::aggregate_op>
+{
+    aggregates_()
+    {
+        add
+            ("count"  , cyclic::AGGREGATE_COUNT)
+            ("sum"    , cyclic::AGGREGATE_SUM)
+            ("min"    , cyclic::AGGREGATE_MIN)
+            ("max"    , cyclic::AGGREGATE_MAX)
+            ("avg"    , cyclic::AGGREGATE_AVG)
+            ("mean"   , cyclic::AGGREGATE_AVG)
+            ("stddev" , cyclic::AGGREGATE_STDDEV)
+            ("increase", cyclic::AGGREGATE_INCREASE)
+            ("rate"   , cyclic::AGGREGATE_RATE)
+        ;
+    }
+
+};
+
+struct top_orders_ : qi::symbols<char, bool>
+{
+    top_orders_()
+    {
+        add
+            ("top"     , true)
+            ("bottom"  , false)
+        ;
+    }
+};
+
+struct time_units_ : qi::symbols<char, cyclic::record_time_t>
+{
+    time_units_()
+    {
+        add
+            ("s" , 1)
+            ("m" , 60)
+            ("h" , 3600)
+            ("d" , 86400)
+        ;
+    }
+
+};
+
+struct comparisons_ : qi::symbols<char, cyclic::predicate::comparison>
+{
+    comparisons_()
+    {
+        add
+            ("="  , cyclic::predicate::EQUAL)
+            ("==" , cyclic::predicate::EQUAL)
+            ("!=" , cyclic::predicate::NOT_EQUAL)
+            ("<>" , cyclic::predicate::NOT_EQUAL)
+            ("<"  , cyclic::predicate::LESS)
+            ("<=" , cyclic::predicate::LESS_EQUAL)
+            (">"  , cyclic::predicate::GREATER)
+            (">=" , cyclic::predicate::GREATER_EQUAL)
+        ;
+    }
+
+};
+
 inline void adapt_position_opt(helpers::position& res, boost::optional<helpers::position> opt_pos)
 {
     if(opt_pos)
@@ -113,6 +181,38 @@ inline void adapt_position_opt(helpers::position& res, boost::optional<helpers::
     }
 }
 
+inline void adapt_condition_opt(helpers::condition_ptr& res, boost::optional<helpers::condition_ptr> opt_cond)
+{
+    res = opt_cond ? *opt_cond : nullptr;
+}
+
+inline helpers::condition_ptr make_comparison(const std::string& column, cyclic::predicate::comparison op, double value)
+{
+    helpers::condition_ptr res = std::make_shared<helpers::condition>();
+    res->type = cyclic::predicate::COMPARE;
+    res->column = column;
+    res->op = op;
+    res->value = value;
+    return res;
+}
+
+inline helpers::condition_ptr make_null_test(const std::string& column, cyclic::predicate::kind type)
+{
+    helpers::condition_ptr res = std::make_shared<helpers::condition>();
+    res->type = type;
+    res->column = column;
+    return res;
+}
+
+inline helpers::condition_ptr make_combination(cyclic::predicate::kind type, helpers::condition_ptr left, helpers::condition_ptr right)
+{
+    helpers::condition_ptr res = std::make_shared<helpers::condition>();
+    res->type = type;
+    res->left = left;
+    res->right = right;
+    return res;
+}
+
 inline void adapt_position_index(helpers::position& res, cyclic::record_index_t index)
 {
     res = helpers::position{index};
@@ -123,6 +223,11 @@ inline void adapt_position_time(helpers::position& res, cyclic::record_time_t ti
     res = helpers::position{time};
 }
 
+inline void adapt_position_interval(helpers::position& res, cyclic::record_time_t count, cyclic::record_time_t unit)
+{
+    res = helpers::position{count * unit};
+}
+
 template <typename Iterator>
 struct query_parser : qi::grammar<Iterator, commands::command*(), ascii::space_type>
 {
@@ -143,10 +248,12 @@ struct query_parser : qi::grammar<Iterator, commands::command*(), ascii::space_t
         using qi::_1;
         using qi::_2;
         using qi::_3;
+        using qi::_4;
+        using qi::_5;
 
         quoted_string %= lexeme[+alnum] | lexeme['"' >> +(char_ - '"') >> '"'];
 
-        column_name %= quoted_string;
+        column_name %= lexeme[alnum >> *(alnum | char_('_') | char_('.'))] | quoted_string;
         column_names %= column_name % ',';
 
         start %= no_case[lit("start")] >> position;
@@ -154,8 +261,39 @@ struct query_parser : qi::grammar<Iterator, commands::command*(), ascii::space_t
         opt_start = (-(start))[phoenix::bind(adapt_position_opt, _val, _1)];
         opt_end   = (-(end))[phoenix::bind(adapt_position_opt, _val, _1)];
 
-        select = (no_case[lit("select")] >> (lit("*")|column_names) >> opt_start >> opt_end )
-                [_val = phoenix::new_<commands::select>(_1, _2, _3)];
+        compare_condition = (column_name >> comparison >> double_)
+                [_val = phoenix::bind(make_comparison, _1, _2, _3)];
+        null_condition = (column_name >> no_case[lit("is")] >> no_case[lit("null")])
+                [_val = phoenix::bind(make_null_test, _1, cyclic::predicate::IS_NULL)];
+        not_null_condition = (column_name >> no_case[lit("is")] >> no_case[lit("not")] >> no_case[lit("null")])
+                [_val = phoenix::bind(make_null_test, _1, cyclic::predicate::IS_NOT_NULL)];
+        primary_condition %= not_null_condition | null_condition | compare_condition | ('(' >> condition >> ')');
+        and_condition = primary_condition[_val = _1]
+                >> *(no_case[lit("and")] >> primary_condition[_val = phoenix::bind(make_combination, cyclic::predicate::AND, _val, _1)]);
+        condition = and_condition[_val = _1]
+                >> *(no_case[lit("or")] >> and_condition[_val = phoenix::bind(make_combination, cyclic::predicate::OR, _val, _1)]);
+        opt_where = (-(no_case[lit("where")] >> condition))[phoenix::bind(adapt_condition_opt, _val, _1)];
+
+        select = (no_case[lit("select")] >> (lit("*")|column_names) >> opt_start >> opt_end >> opt_where )
+                [_val = phoenix::new_<commands::select>(_1, _2, _3, _4)];
+
+        aggregate_item %= no_case[aggregate] >> '(' >> column_name >> ')';
+        aggregate_items %= aggregate_item % ',';
+        group_time = lexeme[(long_long >> time_unit)
+                [phoenix::bind(adapt_position_interval, _val, _1, _2)]];
+        group_records = ulong_
+                [phoenix::bind(adapt_position_index, _val, _1)];
+        group %= no_case[lit("group")] >> no_case[lit("by")] >> (group_time | group_records);
+        opt_group = (-(group))[phoenix::bind(adapt_position_opt, _val, _1)];
+        select_aggregate = (no_case[lit("select")] >> aggregate_items >> opt_start >> opt_end >> opt_group )
+                [_val = phoenix::new_<commands::select_aggregate>(_1, _2, _3, _4)];
+
+        select_top = (no_case[lit("select")] >> no_case[top_order] >> '(' >> column_name >> ',' >> ulong_ >> ')'
+                    >> opt_start >> opt_end)
+                [_val = phoenix::new_<commands::select_top>(_1, _2, _3, _4, _5)];
+        select_crossings = (no_case[lit("select")] >> no_case[lit("crossings")] >> '(' >> column_name >> ',' >> double_ >> ')'
+                    >> opt_start >> opt_end)
+                [_val = phoenix::new_<commands::select_crossings>(_1, _2, _3, _4)];
 
         dump = no_case[lit("dump")][_val = phoenix::new_<commands::dump>()];
         status = no_case[lit("status")][_val = phoenix::new_<commands::status>()];
@@ -197,7 +335,7 @@ struct query_parser : qi::grammar<Iterator, commands::command*(), ascii::space_t
                    >> opt_at
                 )[_val = phoenix::new_<commands::reset>(_1, _2)];
 
-        query %= select | dump | status | details | create | insert | set | append | reset;
+        query %= select_top | select_crossings | select_aggregate | select | dump | status | details | create | insert | set | append | reset;
 
     }
 
@@ -212,7 +350,29 @@ struct query_parser : qi::grammar<Iterator, commands::command*(), ascii::space_t
     qi::rule<Iterator, helpers::position(), ascii::space_type> opt_end;
 
 
+    comparisons_ comparison;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> compare_condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> null_condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> not_null_condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> primary_condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> and_condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> condition;
+    qi::rule<Iterator, helpers::condition_ptr(), ascii::space_type> opt_where;
+
     qi::rule<Iterator, commands::command*(), ascii::space_type> select;
+
+    aggregates_ aggregate;
+    qi::rule<Iterator, helpers::aggregate_item(), ascii::space_type> aggregate_item;
+    qi::rule<Iterator, std::vector<helpers::aggregate_item>(), ascii::space_type> aggregate_items;
+    time_units_ time_unit;
+    qi::rule<Iterator, helpers::position(), ascii::space_type> group_time;
+    qi::rule<Iterator, helpers::position(), ascii::space_type> group_records;
+    qi::rule<Iterator, helpers::position(), ascii::space_type> group;
+    qi::rule<Iterator, helpers::position(), ascii::space_type> opt_group;
+    qi::rule<Iterator, commands::command*(), ascii::space_type> select_aggregate;
+    top_orders_ top_order;
+    qi::rule<Iterator, commands::command*(), ascii::space_type> select_top;
+    qi::rule<Iterator, commands::command*(), ascii::space_type> select_crossings;
     qi::rule<Iterator, commands::command*(), ascii::space_type> dump;
     qi::rule<Iterator, commands::command*(), ascii::space_type> status;
     qi::rule<Iterator, commands::command*(), ascii::space_type> details;
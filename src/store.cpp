@@ -48,12 +48,29 @@ void display_help(po::options_description& options)
 {
     std::cout
         << "Usage : " << CYCLICSTORE_NAME << " [options] <file> [<command> [<args>...]]" << std::endl
+        << "If other files are specified with --join, their tables are joined on time and can only be selected." << std::endl
+        << "Records are aligned on the coarsest record duration, fields are prefixed by their file name" << std::endl
+        << "without directory and extension (as in 'cpu.load')." << std::endl
         << "Available commands:" << std::endl
-        << "  select [*|<field>[,<field>...]] [start <start>] [end <end>]" << std::endl
+        << "  select [*|<field>[,<field>...]] [start <start>] [end <end>] [where <condition>]" << std::endl
         << "          : Extract a part of the table." << std::endl
         << "            If '*' is specified, retrieve all fields." << std::endl
         << "            If <start> is not specified, retrieve records from begining of stored range." << std::endl
         << "            If <end> is not specified, retrieve records to end of stored range." << std::endl
+        << "            If <condition> is specified, retrieve only matching records." << std::endl
+        << "            <condition> combines '<field> <op> <value>' (<op> is =, !=, <, <=, > or >=)," << std::endl
+        << "            '<field> is [not] null' and parentheses with 'and' and 'or'." << std::endl
+        << "  select <fn>(<field>)[,<fn>(<field>)...] [start <start>] [end <end>] [group by <interval>]" << std::endl
+        << "          : Aggregate fields over a part of the table." << std::endl
+        << "            <fn> is one of count, sum, min, max, avg and stddev, or increase and rate" << std::endl
+        << "            for counters (unsigned integers), handling wraps and resets, rate being per time unit." << std::endl
+        << "            If <interval> is specified, aggregate per bucket of <interval>, one row per bucket." << std::endl
+        << "            <interval> is a number of records, or a duration suffixed by s, m, h or d" << std::endl
+        << "            (table times being expressed in seconds), multiple of the record duration." << std::endl
+        << "  select top|bottom(<field>, <count>) [start <start>] [end <end>]" << std::endl
+        << "          : Retrieve the <count> largest (or smallest) values of a field, best first." << std::endl
+        << "  select crossings(<field>, <threshold>) [start <start>] [end <end>]" << std::endl
+        << "          : Retrieve records where a field crosses <threshold>, rising above or falling back." << std::endl
         << "  append [(<field>[,<field>...])] values (<value[,<value>...]) [at <index>]" << std::endl
         << "          : Append a record at specified index, the record shall not already exists." << std::endl
         << "            If no <field> is specified, retrieve all fields in the table definition order." << std::endl
@@ -81,7 +98,13 @@ void display_help(po::options_description& options)
 int main(int argc, const char** argv)
 {
     std::vector<std::string> extras;
+    std::vector<std::string> joined;
 
+    po::options_description general("General options");
+    general.add_options()
+            ("read-only,r", "open the table file for reading only")
+            ("join,j", po::value<std::vector<std::string>>(&joined), "join the table of another file, can be repeated")
+    ;
 
     po::options_description others("Other options");
     others.add_options()
@@ -99,10 +122,10 @@ int main(int argc, const char** argv)
     pd.add("input-file", 1)/*.add("command", 1)*/.add("extra", -1);
 
     po::options_description cmdline_options;
-    cmdline_options.add(others).add(hidden);
+    cmdline_options.add(general).add(others).add(hidden);
 
     po::options_description help_options;
-    help_options.add(others);
+    help_options.add(general).add(others);
 
     po::variables_map vm;
     po::store(po::command_line_parser(argc, argv).options(cmdline_options).positional(pd).run(), vm);
@@ -127,12 +150,30 @@ int main(int argc, const char** argv)
         return -1;
     }
 
+    std::vector<std::string> filenames{filename};
+    filenames.insert(filenames.end(), joined.begin(), joined.end());
+
     std::ostringstream stm;
-    for(std::string s : extras)
+    for(const std::string& extra : extras)
     {
-        stm << ' ' << s;
+        stm << ' ' << extra;
     }
 
-    cyclicstore::command_executor executor(filename);
-    return executor.parse_and_execute(stm.str()) ? 0 : -1;
+    try
+    {
+        if(filenames.size() > 1)
+        {
+            cyclicstore::command_executor executor(filenames);
+            return executor.parse_and_execute(stm.str()) ? 0 : -1;
+        }
+        cyclicstore::command_executor executor(filename, vm.count("read-only")
+                ? cyclic::store::file::open_mode::read_only
+                : cyclic::store::file::open_mode::read_write);
+        return executor.parse_and_execute(stm.str()) ? 0 : -1;
+    }
+    catch(std::exception& ex)
+    {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return -1;
+    }
 }
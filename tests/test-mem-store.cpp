@@ -19,10 +19,14 @@
  */
 #include "catch.hpp"
 
+#include <algorithm>
 #include <limits>
 #include <cmath>
+#include <future>
+#include <thread>
 
 #include "libstore.hpp"
+#include "libstore-typed.hpp"
 #include "common-file.hpp"
 
 
@@ -132,3 +136,1438 @@ TEST_CASE("Memory storage", "[memory]") {
         REQUIRE( rec->get(6).value<uint32_t>() == 6 ); // Record at idx 5 field 6 value
     }
 }
+
+TEST_CASE("Memory storage asynchronous append", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"producer", cyclic::CDB_DT_UNSIGNED_8},
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 1000);
+    table->configure_append_queue(16, cyclic::table::APPEND_BLOCK);
+
+    std::vector<std::thread> producers;
+    for(uint8_t p = 0; p < 4; ++p)
+    {
+        producers.emplace_back([&table, p]() {
+            for(int32_t v = 0; v < 50; ++v)
+            {
+                table->append_async(cyclic::raw_record::raw({p, v}));
+            }
+        });
+    }
+    for(std::thread& t : producers)
+    {
+        t.join();
+    }
+    table->flush();
+
+    REQUIRE( table->record_count() == 200 ); // All queued records are appended
+    REQUIRE( table->min_index() == 0 );
+    REQUIRE( table->max_index() == 199 );
+
+    auto future = table->append_async(cyclic::raw_record::raw({(uint8_t)9, 42}));
+    REQUIRE( future.get() == 200 ); // Future gives the appended index
+    auto rec = table->get_record((cyclic::record_index_t)200);
+    REQUIRE( rec->get<int32_t>(1) == 42 );
+}
+
+TEST_CASE("Memory storage asynchronous append on a full queue", "[memory]") {
+
+    for(cyclic::table::append_policy policy : {cyclic::table::APPEND_DROP_OLDEST, cyclic::table::APPEND_FAIL})
+    {
+        std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({{"value", cyclic::CDB_DT_SIGNED_32}}, 100);
+        table->configure_append_queue(2, policy);
+
+        // The flusher is held off by a subscriber, notified while writing the first record.
+        std::promise<void> entered, release;
+        std::shared_future<void> released = release.get_future().share();
+        bool first = true;
+        auto sub = table->subscribe([&](cyclic::record_index_t, cyclic::record_index_t) {
+            if(first)
+            {
+                first = false;
+                entered.set_value();
+                released.wait();
+            }
+        });
+        auto held = table->append_async(cyclic::raw_record::raw({0}));
+        entered.get_future().wait();
+
+        auto oldest = table->append_async(cyclic::raw_record::raw({1}));
+        auto queued = table->append_async(cyclic::raw_record::raw({2}));
+        if(policy == cyclic::table::APPEND_FAIL)
+        {
+            REQUIRE_THROWS_AS( table->append_async(cyclic::raw_record::raw({3})), cyclic::queue_is_full ); // Rejected
+            release.set_value();
+            REQUIRE( held.get() == 0 );
+            REQUIRE( oldest.get() == 1 ); // Queued ones are kept
+            REQUIRE( queued.get() == 2 );
+        }
+        else
+        {
+            auto newest = table->append_async(cyclic::raw_record::raw({3}));
+            release.set_value();
+            REQUIRE( held.get() == 0 );
+            REQUIRE_THROWS_AS( oldest.get(), cyclic::queue_is_full ); // Dropped for the new one
+            REQUIRE( queued.get() == 1 );
+            REQUIRE( newest.get() == 2 );
+            REQUIRE( table->get_record((cyclic::record_index_t)2)->get<int32_t>(0) == 3 );
+        }
+        table->flush();
+        REQUIRE( table->record_count() == 3 );
+        table->unsubscribe(sub);
+    }
+}
+
+TEST_CASE("Memory storage subscription", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 10);
+    table->append_record((cyclic::record_index_t)2);
+
+    std::vector<std::pair<cyclic::record_index_t, cyclic::record_index_t>> notified;
+    auto sub = table->subscribe([&notified](cyclic::record_index_t first, cyclic::record_index_t last) {
+        notified.emplace_back(first, last);
+    }, 1);
+
+    REQUIRE( notified.size() == 1 ); // Already stored records are notified
+    REQUIRE( notified[0].first == 1 );
+    REQUIRE( notified[0].second == 2 );
+
+    table->append_record((cyclic::record_index_t)5);
+    REQUIRE( notified.size() == 2 ); // Appended records are notified
+    REQUIRE( notified[1].first == 3 );
+    REQUIRE( notified[1].second == 5 );
+
+    table->insert_record((cyclic::record_index_t)4);
+    REQUIRE( notified.size() == 2 ); // Insert without advancing max index is not notified
+
+    table->unsubscribe(sub);
+    table->append_record();
+    REQUIRE( notified.size() == 2 ); // No more notification after unsubscription
+
+    REQUIRE( table->wait_for_index(6, std::chrono::milliseconds(0)) ); // Already appended
+    REQUIRE( !table->wait_for_index(7, std::chrono::milliseconds(10)) ); // Timeout
+
+    std::thread appender([&table]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        table->append_record();
+    });
+    REQUIRE( table->wait_for_index(7, std::chrono::seconds(10)) ); // Woken up by appender
+    appender.join();
+}
+
+TEST_CASE("Memory storage record view", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"flag", cyclic::CDB_DT_BOOLEAN},
+        {"count", cyclic::CDB_DT_UNSIGNED_16},
+        {"temp", cyclic::CDB_DT_FLOAT_4},
+        {"total", cyclic::CDB_DT_SIGNED_64}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 4, 1000, 10);
+    for(int64_t n = 0; n < 6; ++n)
+    {
+        cyclic::raw_record rec = cyclic::raw_record::raw({n % 2 == 0, (uint16_t) n, cyclic::value_t{}, n * 1000});
+        rec.set(2, 0.5f * n);
+        table->append_record(rec);
+    }
+
+    REQUIRE( !table->get_record_view((cyclic::record_index_t)1) ); // Evicted record has no view
+    REQUIRE( !table->get_record_view((cyclic::record_index_t)6) ); // Not yet appended record has no view
+
+    cyclic::record_view view = table->get_record_view((cyclic::record_index_t)5);
+    REQUIRE( view );
+    REQUIRE( view.index() == 5 );
+    REQUIRE( view.time() == 1050 );
+    REQUIRE( view.size() == 4 );
+    REQUIRE( view.type(2) == cyclic::CDB_DT_FLOAT_4 );
+    REQUIRE( view.has(0) );
+    REQUIRE( view.get<bool>(0) == false );
+    REQUIRE( view.get<uint16_t>(1) == 5 );
+    REQUIRE( view.get<double>(1) == 5.0 ); // Converted on access
+    REQUIRE( view.get<float>(2) == 2.5f );
+    REQUIRE( view.get<int64_t>(3) == 5000 );
+    REQUIRE( view[3].type() == cyclic::CDB_DT_SIGNED_64 );
+    REQUIRE_THROWS_AS( view.has(4), std::out_of_range );
+
+    table->set_record((cyclic::record_index_t)4, *table->get_record());
+    view = table->get_record_view((cyclic::record_time_t)1040);
+    REQUIRE( view );
+    REQUIRE( !view.has(1) );
+    REQUIRE( !view[1] );
+    REQUIRE( view.get_or<uint16_t>(1, 42) == 42 );
+    REQUIRE_THROWS_AS( view.get<uint16_t>(1), cyclic::no_value_exception );
+
+    auto rec = table->get_record((cyclic::record_index_t)5);
+    REQUIRE( rec->get(2).type() == cyclic::CDB_DT_FLOAT_4 ); // Values are stored with their field type
+}
+
+TEST_CASE("Memory storage latest records", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 8, 1000, 10);
+    std::vector<cyclic::record_view> views;
+    REQUIRE( table->latest(5, views) == 0 );
+    REQUIRE( views.empty() );
+
+    for(int32_t n = 0; n < 3; ++n)
+    {
+        table->append_record(cyclic::raw_record::raw({n}));
+    }
+    REQUIRE( table->latest(5, views) == 3 ); // Fewer records than requested
+    REQUIRE( views[0].index() == 2 );
+    REQUIRE( views[2].get<int32_t>(0) == 0 );
+
+    for(int32_t n = 3; n < 13; ++n)
+    {
+        table->append_record(cyclic::raw_record::raw({n}));
+    }
+    REQUIRE( table->latest(6, views) == 6 ); // Across the storage wrap
+    for(int32_t n = 0; n < 6; ++n)
+    {
+        REQUIRE( views[n].index() == (cyclic::record_index_t)(12 - n) );
+        REQUIRE( views[n].time() == 1000 + (12 - n) * 10 );
+        REQUIRE( views[n].get<int32_t>(0) == 12 - n );
+    }
+    REQUIRE( table->latest(100, views) == 8 );
+    REQUIRE( views.back().index() == 5 );
+
+    std::vector<int32_t> reversed;
+    cyclic::record_range range = table->records();
+    for(auto it = range.rbegin(); it != range.rend() && reversed.size() < 3; ++it)
+    {
+        reversed.push_back(it->get<int32_t>(0));
+    }
+    REQUIRE( reversed == std::vector<int32_t>{12, 11, 10} );
+}
+
+TEST_CASE("Memory storage timestamped table", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create_timestamped(fields, 8);
+    REQUIRE( table->timestamped() );
+    REQUIRE( table->record_duration() == 0 );
+    REQUIRE_THROWS_AS( table->record_index((cyclic::record_time_t)0), std::out_of_range ); // Empty table
+    REQUIRE_THROWS_AS( table->append_record(), std::logic_error ); // Time is required
+
+    // Irregular time points, stored densely, wrapping the storage.
+    std::vector<cyclic::record_time_t> times{10, 11, 15, 40, 41, 41, 100, 250, 251, 300, 1000, 1001};
+    for(size_t n = 0; n < times.size(); ++n)
+    {
+        table->append_record(times[n], cyclic::raw_record::raw({(int32_t) n}));
+    }
+    REQUIRE( table->record_count() == 8 );
+    REQUIRE( table->min_index() == 4 );
+    REQUIRE( table->record_time(4) == 41 );
+    REQUIRE( table->record_time(11) == 1001 );
+    REQUIRE_THROWS_AS( table->record_time(3), std::out_of_range ); // Evicted
+
+    REQUIRE( table->record_index((cyclic::record_time_t)41) == 5 ); // Last record at this time
+    REQUIRE( table->record_index((cyclic::record_time_t)99) == 5 );
+    REQUIRE( table->record_index((cyclic::record_time_t)100) == 6 );
+    REQUIRE( table->record_index((cyclic::record_time_t)299) == 8 );
+    REQUIRE( table->record_index((cyclic::record_time_t)5000) == 11 );
+    REQUIRE_THROWS_AS( table->record_index((cyclic::record_time_t)40), std::out_of_range ); // Before first stored record
+
+    REQUIRE( table->get_record((cyclic::record_time_t)260)->get<int32_t>(0) == 8 );
+    REQUIRE( table->get_record((cyclic::record_index_t)9)->time() == 300 );
+    REQUIRE( table->get_record_view((cyclic::record_time_t)1000).time() == 1000 );
+    REQUIRE( table->aggregate(0, (cyclic::record_time_t)100, (cyclic::record_time_t)300).sum == 6 + 7 + 8 + 9 );
+
+    REQUIRE_THROWS_AS( table->append_record((cyclic::record_time_t)900, cyclic::raw_record::raw({0})), std::invalid_argument ); // Out of order
+    REQUIRE_THROWS_AS( table->append_record((cyclic::record_index_t)20, cyclic::raw_record::raw({0})), std::out_of_range ); // Gap
+
+    table->set_record((cyclic::record_index_t)10, cyclic::raw_record::raw({42}));
+    REQUIRE( table->record_time(10) == 1000 ); // Set records keep their time
+    REQUIRE( table->get_record((cyclic::record_index_t)10)->get<int32_t>(0) == 42 );
+
+    table->insert_record((cyclic::record_time_t)1001, cyclic::raw_record::raw({43}));
+    REQUIRE( table->max_index() == 11 );
+    REQUIRE( table->get_record((cyclic::record_index_t)11)->get<int32_t>(0) == 43 );
+    table->insert_record((cyclic::record_time_t)2000, cyclic::raw_record::raw({44}));
+    REQUIRE( table->max_index() == 12 );
+    REQUIRE( table->record_time(12) == 2000 );
+
+    std::unique_ptr<cyclic::mutable_record> rec = table->get_record();
+    rec->time(2000); // Same time as the last record
+    rec->set(0, 45);
+    table->append_async(*rec).get();
+    REQUIRE( table->record_index((cyclic::record_time_t)2000) == 13 );
+}
+
+TEST_CASE("Memory storage field lookup", "[memory]") {
+
+    std::vector<cyclic::field_st> fields;
+    for(int n = 0; n < 2000; ++n)
+    {
+        fields.push_back({"series." + std::to_string(n), n % 2 ? cyclic::CDB_DT_FLOAT_8 : cyclic::CDB_DT_SIGNED_32});
+    }
+    fields.push_back({"series.7", cyclic::CDB_DT_BOOLEAN}); // Duplicated name
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 4);
+    REQUIRE( table->field_index("series.0") == 0 );
+    REQUIRE( table->field_index("series.1999") == 1999 );
+    REQUIRE( table->field_index("series.7") == 7 ); // First field of this name
+    REQUIRE( table->field_index("series.2000") == cyclic::field::invalid_index() );
+    REQUIRE( table->field_index("") == cyclic::field::invalid_index() );
+    REQUIRE( table->field("series.1234").index() == 1234 );
+    REQUIRE_THROWS_AS( table->field("unknown"), cyclic::unknown_field );
+
+    cyclic::field_handle handle = table->resolve("series.1001");
+    REQUIRE( handle.valid() );
+    REQUIRE( handle.index() == 1001 );
+    REQUIRE( handle.type() == cyclic::CDB_DT_FLOAT_8 );
+    REQUIRE_THROWS_AS( table->resolve("unknown"), cyclic::unknown_field );
+    REQUIRE( !cyclic::field_handle{}.valid() );
+
+    std::unique_ptr<cyclic::mutable_record> rec = table->get_record();
+    rec->set(handle, 2.5);
+    rec->set("series.1000", 12);
+    table->append_record(*rec);
+
+    cyclic::record_view view = table->get_record_view((cyclic::record_index_t)0);
+    REQUIRE( view.get<double>(handle) == 2.5 );
+    REQUIRE( view.get<int32_t>(table->resolve("series.1000")) == 12 );
+    REQUIRE( !view.has(table->resolve("series.999")) );
+}
+
+TEST_CASE("Memory storage record range", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 8, 1000, 10);
+    REQUIRE( table->records().empty() );
+    REQUIRE( table->records().begin() == table->records().end() );
+
+    for(int32_t n = 0; n < 12; ++n)
+    {
+        table->append_record(n == 9 ? cyclic::raw_record::raw({cyclic::value_t{}}) : cyclic::raw_record::raw({n * 10}));
+    }
+
+    cyclic::record_range range = table->records();
+    REQUIRE( range.size() == 8 );
+    REQUIRE( std::distance(range.begin(), range.end()) == 8 );
+    REQUIRE( range.begin()->index() == 4 );
+    REQUIRE( range[7].get<int32_t>(0) == 110 );
+
+    cyclic::table_iterator it = range.begin() + 5;
+    REQUIRE( it->index() == 9 );
+    REQUIRE( !it->has(0) ); // Null value
+    REQUIRE( (it - 2)->get<int32_t>(0) == 70 );
+    REQUIRE( it[2].get<int32_t>(0) == 110 );
+    REQUIRE( range.end() - it == 3 );
+    REQUIRE( it > range.begin() );
+    it -= 5;
+    REQUIRE( it == range.begin() );
+
+    std::vector<int32_t> reversed;
+    for(auto rit = range.rbegin(); rit != range.rend(); ++rit)
+    {
+        reversed.push_back(rit->get_or<int32_t>(0, -1));
+    }
+    REQUIRE( reversed == std::vector<int32_t>{110, 100, -1, 80, 70, 60, 50, 40} );
+
+    auto found = std::find_if(range.begin(), range.end(), [](const cyclic::record_view& view){ return view.has(0) && view.get<int32_t>(0) > 75; });
+    REQUIRE( found.index() == 8 );
+    REQUIRE( std::count_if(range.begin(), range.end(), [](const cyclic::record_view& view){ return !view.has(0); }) == 1 );
+
+    int32_t sum = 0;
+    for(cyclic::record_view view : table->records(2, 6))
+    {
+        sum += view.get<int32_t>(0);
+    }
+    REQUIRE( sum == 40 + 50 + 60 ); // Clipped to stored records
+    REQUIRE( table->records(12, 20).empty() );
+    REQUIRE( table->records(6, 5).empty() );
+}
+
+TEST_CASE("Memory storage column read", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"id", cyclic::CDB_DT_UNSIGNED_32},
+        {"value", cyclic::CDB_DT_FLOAT_4}
+    };
+
+    // Table looping over its storage: records 3 to 9 are stored, split at position 0.
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 7);
+    for(uint32_t n = 0; n < 10; ++n)
+    {
+        cyclic::raw_record rec = cyclic::raw_record::raw({n});
+        if(n % 3 != 0)
+        {
+            rec.set(1, 1.5f * n);
+        }
+        table->append_record(rec);
+    }
+
+    double values[12];
+    uint8_t valid[2];
+    REQUIRE( table->read_column<double>(1, 0, 11, values, valid) == 4 ); // Records 4, 5, 7 and 8 have a value
+    REQUIRE( valid[0] == 0xB0 ); // Bits 4, 5 and 7
+    REQUIRE( valid[1] == 0x01 ); // Bit 8
+    REQUIRE( values[0] == 0.0 ); // Not stored
+    REQUIRE( values[3] == 0.0 ); // No value
+    REQUIRE( values[4] == 6.0 );
+    REQUIRE( values[8] == 12.0 );
+    REQUIRE( values[9] == 0.0 ); // No value
+    REQUIRE( values[10] == 0.0 ); // Not stored
+
+    uint64_t ids[3];
+    REQUIRE( table->read_column<uint64_t>(0, 6, 8, ids) == 3 );
+    REQUIRE( ids[0] == 6 );
+    REQUIRE( ids[2] == 8 );
+
+    REQUIRE_THROWS_AS( table->read_column<uint64_t>(2, 6, 8, ids), std::out_of_range );
+    REQUIRE_THROWS_AS( table->read_column<uint64_t>(0, 8, 6, ids), std::invalid_argument );
+}
+
+TEST_CASE("Memory storage aggregation", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"small", cyclic::CDB_DT_SIGNED_16},
+        {"large", cyclic::CDB_DT_FLOAT_8}
+    };
+
+    // Table looping over its storage with more records than aggregated at once.
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 10000, 0, 10);
+    for(int32_t n = 0; n < 12345; ++n)
+    {
+        cyclic::raw_record rec = cyclic::raw_record::raw({(int16_t) (n % 100 - 50)});
+        if(n % 7 != 0)
+        {
+            rec.set(1, 1.0e9 + n);
+        }
+        table->append_record(rec);
+    }
+
+    cyclic::record_index_t first = 2000, last = 12344;
+    cyclic::aggregate_result ref0, ref1;
+    for(cyclic::record_index_t n = std::max(first, table->min_index()); n <= last; ++n)
+    {
+        ref0.add(n % 100 - 50.0);
+        if(n % 7 != 0)
+        {
+            ref1.add(1.0e9 + n);
+        }
+    }
+
+    INFO( "Aggregation kernel: " << cyclic::aggregate_kernel() );
+    cyclic::aggregate_result res0 = table->aggregate(0, first, last);
+    REQUIRE( res0.count == ref0.count );
+    REQUIRE( res0.sum == ref0.sum );
+    REQUIRE( res0.min == -50.0 );
+    REQUIRE( res0.max == 49.0 );
+    REQUIRE( std::abs(res0.avg() - ref0.avg()) < 1e-9 );
+    REQUIRE( std::abs(res0.stddev() - ref0.stddev()) < 1e-9 );
+
+    cyclic::aggregate_result res1 = table->aggregate(1, first, last, cyclic::AGGREGATE_AVG | cyclic::AGGREGATE_STDDEV);
+    REQUIRE( res1.count == ref1.count ); // Null values are ignored
+    REQUIRE( std::abs(res1.avg() - ref1.avg()) < 1e-3 );
+    REQUIRE( std::abs(res1.stddev() - ref1.stddev()) < 1e-3 ); // Accurate despite large values
+
+    cyclic::aggregate_result by_time = table->aggregate(1, (cyclic::record_time_t) 20000, (cyclic::record_time_t) 123449);
+    REQUIRE( by_time.count == res1.count );
+    REQUIRE( by_time.max == res1.max );
+
+    REQUIRE( table->aggregate(1, (cyclic::record_index_t) 0, (cyclic::record_index_t) 100).count == 0 ); // Not stored anymore
+    REQUIRE( std::isnan(table->aggregate(1, (cyclic::record_index_t) 0, (cyclic::record_index_t) 100).value(cyclic::AGGREGATE_AVG)) );
+    REQUIRE( table->aggregate(1, (cyclic::record_index_t) 7000, (cyclic::record_index_t) 7000).count == 0 ); // Null value
+    REQUIRE_THROWS_AS( table->aggregate(2, first, last), std::out_of_range );
+}
+
+TEST_CASE("Memory storage group by", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 10000, 0, 10);
+    for(int32_t n = 0; n < 12345; ++n)
+    {
+        cyclic::raw_record rec;
+        if(n % 7 != 0)
+        {
+            rec.set(0, n);
+        }
+        table->append_record(rec);
+    }
+
+    // Buckets of 5 records, not aligned on validity bitmap bytes.
+    std::vector<cyclic::aggregate_bucket> buckets = table->group_by(0, (cyclic::record_index_t) 3000, (cyclic::record_index_t) 9002, (cyclic::record_index_t) 5);
+    REQUIRE( buckets.size() == 1201 );
+    REQUIRE( buckets.front().first == 3000 );
+    REQUIRE( buckets.front().last == 3004 );
+    REQUIRE( buckets.back().first == 9000 );
+    REQUIRE( buckets.back().last == 9002 ); // Partial last bucket
+    for(const cyclic::aggregate_bucket& bucket : buckets)
+    {
+        cyclic::aggregate_result ref;
+        for(cyclic::record_index_t n = bucket.first; n <= bucket.last; ++n)
+        {
+            if(n % 7 != 0)
+            {
+                ref.add(n);
+            }
+        }
+        REQUIRE( bucket.result.count == ref.count );
+        REQUIRE( bucket.result.sum == ref.sum );
+        REQUIRE( bucket.result.max == ref.max );
+    }
+
+    // Buckets larger than decoded chunks, range clipped to stored records.
+    buckets = table->group_by(0, (cyclic::record_index_t) 0, (cyclic::record_index_t) 20000, (cyclic::record_index_t) 5000);
+    REQUIRE( buckets.size() == 3 );
+    REQUIRE( buckets[0].first == 2345 );
+    REQUIRE( buckets[0].last == 4999 );
+    REQUIRE( buckets[1].first == 5000 );
+    REQUIRE( buckets[1].last == 9999 );
+    REQUIRE( buckets[2].first == 10000 );
+    REQUIRE( buckets[2].last == 12344 );
+    REQUIRE( buckets[0].result.count + buckets[1].result.count + buckets[2].result.count
+            == table->aggregate(0, (cyclic::record_index_t) 0, (cyclic::record_index_t) 20000).count );
+
+    // Time buckets of 10 records.
+    buckets = table->group_by(0, (cyclic::record_time_t) 50000, (cyclic::record_time_t) 50999, (cyclic::record_time_t) 100, cyclic::AGGREGATE_AVG);
+    REQUIRE( buckets.size() == 10 );
+    REQUIRE( buckets[1].first == 5010 );
+    REQUIRE( buckets[1].result.count == 8 ); // 5012 and 5019 are null
+    REQUIRE( buckets[1].result.avg() == Approx((5010 + 5011 + 5013 + 5014 + 5015 + 5016 + 5017 + 5018) / 8.0) );
+
+    REQUIRE( table->group_by(0, (cyclic::record_index_t) 0, (cyclic::record_index_t) 100, (cyclic::record_index_t) 10).empty() ); // Not stored anymore
+    REQUIRE_THROWS_AS( table->group_by(0, (cyclic::record_index_t) 3000, (cyclic::record_index_t) 4000, (cyclic::record_index_t) 0), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->group_by(0, (cyclic::record_time_t) 30000, (cyclic::record_time_t) 40000, (cyclic::record_time_t) 15), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->group_by(1, (cyclic::record_index_t) 3000, (cyclic::record_index_t) 4000, (cyclic::record_index_t) 10), std::out_of_range );
+}
+
+TEST_CASE("Memory storage continuous aggregates", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 50, 0, 10);
+    for(int32_t n = 0; n < 5; ++n)
+    {
+        table->append_record(cyclic::raw_record::raw({n}));
+    }
+    cyclic::table::continuous_aggregate_t last10 = table->add_continuous_aggregate(0, (cyclic::record_index_t)10);
+    cyclic::table::continuous_aggregate_t whole = table->add_continuous_aggregate(0, (cyclic::record_index_t)1000); // Limited to capacity
+    cyclic::table::continuous_aggregate_t minute = table->add_continuous_aggregate(0, (cyclic::record_time_t)60, cyclic::AGGREGATE_MAX);
+    REQUIRE( table->continuous_aggregate(last10).count == 5 ); // Initialized with stored records
+    REQUIRE( table->continuous_aggregate(last10).sum == 10 );
+    REQUIRE_THROWS_AS( table->add_continuous_aggregate(0, (cyclic::record_time_t)15), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->add_continuous_aggregate(0, (cyclic::record_index_t)0), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->add_continuous_aggregate(1, (cyclic::record_index_t)10), std::out_of_range );
+
+    for(int32_t n = 5; n < 200; ++n)
+    {
+        if(n % 7 == 0)
+        {
+            table->append_record(cyclic::raw_record::raw({cyclic::value_t{}}));
+        }
+        else
+        {
+            table->append_record(cyclic::raw_record::raw({(n * 37) % 101 - 50}));
+        }
+
+        cyclic::record_index_t max = table->max_index();
+        cyclic::aggregate_result ref = table->aggregate(0, std::max<cyclic::record_index_t>(max, 9) - 9, max);
+        cyclic::aggregate_result res = table->continuous_aggregate(last10);
+        REQUIRE( res.count == ref.count );
+        REQUIRE( res.sum == ref.sum );
+        REQUIRE( res.min == ref.min );
+        REQUIRE( res.max == ref.max );
+        REQUIRE( std::abs(res.stddev() - ref.stddev()) < 1e-9 );
+        REQUIRE( table->continuous_aggregate(minute).max == table->aggregate(0, std::max<cyclic::record_index_t>(max, 5) - 5, max).max );
+    }
+    cyclic::aggregate_result stored = table->aggregate(0, table->min_index(), table->max_index());
+    REQUIRE( table->continuous_aggregate(whole).count == stored.count ); // Evicted records are subtracted
+    REQUIRE( table->continuous_aggregate(whole).sum == stored.sum );
+
+    table->set_record((cyclic::record_index_t)195, cyclic::raw_record::raw({1000}));
+    REQUIRE( table->continuous_aggregate(last10).max == 1000 );
+    table->set_record((cyclic::record_index_t)195, cyclic::raw_record::raw({-1000}));
+    REQUIRE( table->continuous_aggregate(last10).max == table->aggregate(0, (cyclic::record_index_t)190, (cyclic::record_index_t)199).max );
+    REQUIRE( table->continuous_aggregate(last10).min == -1000 );
+
+    table->append_record((cyclic::record_index_t)205, cyclic::raw_record::raw({3})); // Skipped records are null
+    REQUIRE( table->continuous_aggregate(last10).count == table->aggregate(0, (cyclic::record_index_t)196, (cyclic::record_index_t)205).count );
+    REQUIRE( table->continuous_aggregate(last10).sum == table->aggregate(0, (cyclic::record_index_t)196, (cyclic::record_index_t)205).sum );
+    table->append_record((cyclic::record_index_t)300, cyclic::raw_record::raw({4})); // Whole window slides out
+    REQUIRE( table->continuous_aggregate(last10).count == 1 );
+    REQUIRE( table->continuous_aggregate(last10).min == 4 );
+
+    table->remove_continuous_aggregate(last10);
+    REQUIRE_THROWS_AS( table->continuous_aggregate(last10), std::invalid_argument );
+    REQUIRE( table->continuous_aggregate(whole).count == 1 );
+}
+
+TEST_CASE("Memory storage quantile sketches", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"latency", cyclic::CDB_DT_FLOAT_8}
+    };
+
+    // Skewed values, with a few negative and zero ones, every 13th record is null.
+    auto value_of = [](cyclic::record_index_t n) { return n % 101 == 0 ? 0.0 : (n % 97 == 0 ? -1.5 * n : std::pow(1.001, n % 5000)); };
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 20000, 0, 10);
+    for(cyclic::record_index_t n = 0; n < 25000; ++n)
+    {
+        cyclic::raw_record rec;
+        if(n % 13 != 0)
+        {
+            rec.set(0, value_of(n));
+        }
+        table->append_record(rec);
+    }
+
+    const double accuracy = 0.01;
+    std::vector<cyclic::sketch_bucket> buckets = table->sketch_by(0, (cyclic::record_index_t) 0, (cyclic::record_index_t) 30000, (cyclic::record_index_t) 1000, accuracy);
+    REQUIRE( buckets.size() == 20 );
+    REQUIRE( buckets.front().first == 5000 );
+    REQUIRE( buckets.back().last == 24999 );
+
+    // Quantiles merged from bucket sketches stay within relative accuracy of exact ones.
+    cyclic::quantile_sketch merged(accuracy);
+    for(const cyclic::sketch_bucket& bucket : buckets)
+    {
+        merged.merge(bucket.sketch);
+    }
+    std::vector<double> exact;
+    for(cyclic::record_index_t n = 5000; n < 25000; ++n)
+    {
+        if(n % 13 != 0)
+        {
+            exact.push_back(value_of(n));
+        }
+    }
+    std::sort(exact.begin(), exact.end());
+    REQUIRE( merged.count() == exact.size() );
+    REQUIRE( merged.min() == exact.front() );
+    REQUIRE( merged.max() == exact.back() );
+    for(double q : {0.0, 0.01, 0.25, 0.5, 0.9, 0.99, 0.999, 1.0})
+    {
+        double ref = exact[(size_t) (q * (exact.size() - 1))];
+        REQUIRE( std::abs(merged.quantile(q) - ref) <= accuracy * std::abs(ref) * 1.0001 );
+    }
+
+    // Merging bucket sketches is the same as sketching the whole range at once.
+    std::vector<cyclic::sketch_bucket> whole = table->sketch_by(0, (cyclic::record_index_t) 5000, (cyclic::record_index_t) 24999, (cyclic::record_index_t) 25000, accuracy);
+    REQUIRE( whole.size() == 1 );
+    REQUIRE( whole.front().sketch.count() == merged.count() );
+    for(double q : {0.0, 0.1, 0.5, 0.95, 0.999})
+    {
+        REQUIRE( whole.front().sketch.quantile(q) == merged.quantile(q) );
+    }
+
+    // Serialized sketches can be persisted and restored.
+    std::vector<uint8_t> data = merged.encode();
+    cyclic::quantile_sketch restored = cyclic::quantile_sketch::decode(data.data(), data.size());
+    REQUIRE( restored.count() == merged.count() );
+    REQUIRE( restored.quantile(0.99) == merged.quantile(0.99) );
+    REQUIRE_THROWS_AS( cyclic::quantile_sketch::decode(data.data(), data.size() - 1), std::invalid_argument );
+
+    // Time buckets of 100 records.
+    buckets = table->sketch_by(0, (cyclic::record_time_t) 100000, (cyclic::record_time_t) 109999, (cyclic::record_time_t) 1000);
+    REQUIRE( buckets.size() == 10 );
+    REQUIRE( buckets[2].first == 10200 );
+    REQUIRE( buckets[2].sketch.count() == table->aggregate(0, (cyclic::record_index_t) 10200, (cyclic::record_index_t) 10299).count );
+
+    REQUIRE( cyclic::quantile_sketch().empty() );
+    REQUIRE( std::isnan(cyclic::quantile_sketch().quantile(0.5)) );
+
+    // Values which cannot be binned are ignored, keys of huge values are clamped.
+    cyclic::quantile_sketch finite(accuracy);
+    finite.add(std::numeric_limits<double>::infinity());
+    finite.add(-std::numeric_limits<double>::infinity());
+    finite.add(std::numeric_limits<double>::quiet_NaN());
+    REQUIRE( finite.empty() );
+    finite.add(2.0);
+    REQUIRE( finite.count() == 1 );
+    REQUIRE( finite.quantile(1) == 2.0 );
+    cyclic::quantile_sketch tiny(1e-12);
+    tiny.add(1e300);
+    REQUIRE( tiny.count() == 1 );
+    REQUIRE( tiny.quantile(0.5) == 1e300 );
+
+    // Far apart magnitudes with a fine accuracy collapse the lowest bins, keeping memory bounded.
+    cyclic::quantile_sketch wide(1e-9);
+    wide.add(1e-300);
+    wide.add(1e300);
+    wide.add(-1e-300);
+    wide.add(-1e300);
+    REQUIRE( wide.count() == 4 );
+    REQUIRE( wide.quantile(0) == Approx(-1e300).epsilon(1e-9) );
+    REQUIRE( wide.quantile(1) == Approx(1e300).epsilon(1e-9) );
+    REQUIRE( wide.quantile(0.75) == Approx(1e300).epsilon(1e-5) ); // Lowest magnitudes counted in the lowest kept bin
+    REQUIRE( wide.encode().size() <= 5 * 8 + 2 * 12 + 2 * 2048 * 8 );
+    cyclic::quantile_sketch wide_copy(1e-9);
+    wide_copy.add(1e-300);
+    wide_copy.merge(wide);
+    REQUIRE( wide_copy.count() == 5 );
+    REQUIRE( wide_copy.quantile(1) == Approx(1e300).epsilon(1e-9) );
+    std::vector<uint8_t> encoded = wide_copy.encode();
+    REQUIRE( cyclic::quantile_sketch::decode(encoded.data(), encoded.size()).count() == 5 );
+    REQUIRE_THROWS_AS( cyclic::quantile_sketch(1e-17), std::invalid_argument ); // Keys would not be representable
+    REQUIRE_THROWS_AS( merged.quantile(1.5), std::invalid_argument );
+    REQUIRE_THROWS_AS( merged.merge(cyclic::quantile_sketch(0.05)), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->sketch_by(0, (cyclic::record_index_t) 5000, (cyclic::record_index_t) 6000, (cyclic::record_index_t) 0), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->sketch_by(1, (cyclic::record_index_t) 5000, (cyclic::record_index_t) 6000, (cyclic::record_index_t) 10), std::out_of_range );
+}
+
+TEST_CASE("Memory storage time join", "[memory]") {
+
+    // Every 10s, from 0 to 1190.
+    std::shared_ptr<cyclic::table> fine = cyclic::store::memory::create({{"cpu", cyclic::CDB_DT_SIGNED_32}}, 1000, 0, 10);
+    for(int32_t n = 0; n < 120; ++n)
+    {
+        fine->append_record(cyclic::raw_record::raw({n}));
+    }
+    // Every 60s, from 600 to 1740, null before.
+    std::shared_ptr<cyclic::table> coarse = cyclic::store::memory::create({{"cpu", cyclic::CDB_DT_FLOAT_8}}, 1000, 0, 60);
+    coarse->append_record((cyclic::record_index_t) 0, cyclic::raw_record{});
+    for(int32_t n = 10; n < 30; ++n)
+    {
+        coarse->append_record((cyclic::record_index_t) n, cyclic::raw_record::raw({n * 0.5}));
+    }
+    // At irregular time points.
+    std::shared_ptr<cyclic::table> events = cyclic::store::memory::create_timestamped({{"code", cyclic::CDB_DT_UNSIGNED_16}}, 100);
+    events->append_record((cyclic::record_time_t) 130, cyclic::raw_record::raw({(uint16_t) 1}));
+    events->append_record((cyclic::record_time_t) 500, cyclic::raw_record::raw({(uint16_t) 2}));
+
+    REQUIRE_THROWS_AS( cyclic::time_join({}), std::invalid_argument );
+    REQUIRE_THROWS_AS( cyclic::time_join({{events, "e."}}), cyclic::time_not_supported );
+
+    cyclic::time_join join({{fine, "fine."}, {coarse, "coarse."}, {events, ""}});
+    REQUIRE( join.record_duration() == 60 ); // Aligned on the coarsest table
+    REQUIRE( join.record_origin() == 0 );
+    REQUIRE( join.field_count() == 3 );
+    REQUIRE( join.field(1).name() == "coarse.cpu" );
+    REQUIRE( join.field_index("code") == 2 );
+    REQUIRE( join.source_field(1) == std::make_pair((size_t) 1, (cyclic::field_index_t) 0) );
+    REQUIRE( join.min_index() == 0 );
+    REQUIRE( join.max_index() == 29 ); // Union of table ranges
+    REQUIRE( join.record_count() == 30 );
+
+    std::unique_ptr<cyclic::record> rec = join.get_record(3); // 180s
+    REQUIRE( rec->time() == 180 );
+    REQUIRE( rec->get<int32_t>(0) == 18 );
+    REQUIRE_FALSE( rec->has(1) );
+    REQUIRE( rec->get<uint16_t>(2) == 1 ); // Event at 130
+    REQUIRE_FALSE( join.get_record(2)->has(2) ); // Before the event
+    REQUIRE_FALSE( join.get_record(4)->has(2) ); // Event is older than a joined record
+    rec = join.get_record(25);
+    REQUIRE_FALSE( rec->has(0) );
+    REQUIRE( rec->get<double>(1) == 12.5 );
+
+    // Streamed rows are the same as accessed ones.
+    std::vector<cyclic::record_index_t> indexes;
+    join.scan(0, 100, [&](const cyclic::record& row) {
+        std::unique_ptr<cyclic::record> ref = join.get_record(row.index());
+        for(cyclic::field_index_t f = 0; f < join.field_count(); ++f)
+        {
+            REQUIRE( row.has(f) == ref->has(f) );
+            if(row.has(f))
+            {
+                REQUIRE( row.get<double>(f) == ref->get<double>(f) );
+            }
+        }
+        indexes.push_back(row.index());
+    });
+    REQUIRE( indexes.size() == 30 );
+    REQUIRE( indexes.front() == 0 );
+    REQUIRE( indexes.back() == 29 );
+
+    // Join is a recordset, it can be aggregated.
+    cyclic::aggregate_result res = join.aggregate(0, (cyclic::record_index_t) 0, (cyclic::record_index_t) 29);
+    REQUIRE( res.count == 20 );
+    REQUIRE( res.sum == 6 * (19 * 20 / 2) );
+
+    // The join follows the tables.
+    fine->append_record(cyclic::raw_record::raw({120}));
+    coarse->append_record(cyclic::raw_record::raw({15.0}));
+    REQUIRE( join.max_index() == 30 );
+
+    // Streamed by several blocks, with sparse table records read by ranges.
+    std::shared_ptr<cyclic::table> sparse = cyclic::store::memory::create({{"v", cyclic::CDB_DT_UNSIGNED_64}}, 100000, 0, 1);
+    std::shared_ptr<cyclic::table> dense = cyclic::store::memory::create({{"v", cyclic::CDB_DT_BOOLEAN}}, 3000, 0, 100);
+    for(uint64_t n = 0; n < 100000; ++n)
+    {
+        sparse->append_record(n % 7 == 0 ? cyclic::raw_record{} : cyclic::raw_record::raw({n}));
+    }
+    for(int32_t n = 0; n < 2500; ++n)
+    {
+        dense->append_record(cyclic::raw_record::raw({n % 2 == 0}));
+    }
+    cyclic::time_join wide({{sparse, "s."}, {dense, "d."}});
+    uint64_t count = 0;
+    wide.scan(0, 3000, [&](const cyclic::record& row) {
+        uint64_t index = row.index() * 100;
+        REQUIRE( row.has(0) == (index < 100000 && index % 7 != 0) );
+        if(row.has(0))
+        {
+            REQUIRE( row.get<uint64_t>(0) == index );
+        }
+        REQUIRE( row.get<bool>(1) == (row.index() % 2 == 0) );
+        ++count;
+    });
+    REQUIRE( count == 2500 );
+}
+
+TEST_CASE("Memory storage resampling", "[memory]") {
+
+    // Every 10s, record n valued n, except every 4th which is null.
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({{"value", cyclic::CDB_DT_SIGNED_32}}, 10000, 0, 10);
+    for(int32_t n = 0; n < 10000; ++n)
+    {
+        cyclic::raw_record rec;
+        if(n % 4 != 3)
+        {
+            rec.set(0, n);
+        }
+        table->append_record(rec);
+    }
+
+    // Collect resampled points, checking chunks are contiguous.
+    auto resample = [&](cyclic::record_time_t start, cyclic::record_time_t end, cyclic::record_time_t duration,
+            cyclic::resample_method method) {
+        cyclic::column_chunk all;
+        all.clear(start, duration);
+        table->resample(0, start, end, duration, method, [&](const cyclic::column_chunk& chunk) {
+            REQUIRE( chunk.step == duration );
+            REQUIRE( chunk.start == all.time(all.size()) );
+            for(size_t n = 0; n < chunk.size(); ++n)
+            {
+                all.push_back(chunk.valid(n), chunk.values[n]);
+            }
+        });
+        REQUIRE( all.size() == (size_t) ((end - start) / duration + 1) );
+        return all;
+    };
+
+    // Upsampling over several decoded chunks, linear interpolation fills gaps.
+    cyclic::column_chunk points = resample(0, 99985, 5, cyclic::resample_method::linear);
+    for(size_t n = 0; n < points.size() - 1; ++n)
+    {
+        REQUIRE( points.valid(n) );
+        REQUIRE( points.values[n] == Approx(points.time(n) / 10.0) );
+    }
+    REQUIRE_FALSE( points.valid(points.size() - 1) ); // After the last value (record 9999 is null)
+
+    points = resample(20, 45, 5, cyclic::resample_method::previous);
+    REQUIRE( points.values == std::vector<double>{2, 2, 2, 2, 4, 4} );
+
+    points = resample(20, 45, 5, cyclic::resample_method::nearest);
+    REQUIRE( points.values == std::vector<double>{2, 2, 2, 4, 4, 4} );
+
+    points = resample(20, 45, 5, cyclic::resample_method::none);
+    REQUIRE( points.valid(1) );
+    REQUIRE_FALSE( points.valid(2) ); // Record 3 is null
+    REQUIRE_FALSE( points.valid(3) );
+    REQUIRE( points.values[4] == 4 );
+
+    // Starting on a null record, the previous value is looked for.
+    points = resample(35, 35, 10, cyclic::resample_method::previous);
+    REQUIRE( points.valid(0) );
+    REQUIRE( points.values[0] == 2 );
+
+    // Past the last record, values are held.
+    points = resample(99980, 100100, 60, cyclic::resample_method::previous);
+    REQUIRE( points.values == std::vector<double>{9998, 9998, 9998} );
+
+    // Downsampled chunks chain with aggregations.
+    cyclic::aggregate_result res;
+    table->resample(0, (cyclic::record_time_t) 0, (cyclic::record_time_t) 99999, (cyclic::record_time_t) 100, cyclic::resample_method::previous,
+            [&](const cyclic::column_chunk& chunk) {
+        cyclic::aggregate_values(chunk.values.data(), chunk.validity.data(), chunk.size(), cyclic::AGGREGATE_ALL, res);
+    });
+    REQUIRE( res.count == 1000 );
+    REQUIRE( res.sum == 10 * (999 * 1000 / 2) );
+
+    // Resamplers chain too.
+    cyclic::resampler fine(0, 1000, 5, cyclic::resample_method::linear), coarse(0, 1000, 100, cyclic::resample_method::previous);
+    std::vector<int64_t> times{0, 1000};
+    std::vector<double> values{0, 100};
+    cyclic::column_chunk out;
+    fine.push(times.data(), values.data(), nullptr, times.size(), [&](const cyclic::column_chunk& chunk) {
+        coarse.push(chunk, [&](const cyclic::column_chunk& points) {
+            out = points;
+        });
+    });
+    REQUIRE( fine.done() );
+    REQUIRE( out.size() == 11 );
+    REQUIRE( out.values[3] == 30 );
+
+    // Gaps and trailing points are emitted by bounded chunks.
+    cyclic::resampler bounded(0, 100000, 1, cyclic::resample_method::previous, 0, 1000);
+    std::vector<size_t> sizes;
+    int64_t next = 0;
+    auto collect = [&](const cyclic::column_chunk& chunk) {
+        REQUIRE( chunk.start == next );
+        next += (int64_t) chunk.size();
+        sizes.push_back(chunk.size());
+    };
+    bounded.push(times.data(), values.data(), nullptr, times.size(), collect);
+    REQUIRE( sizes == std::vector<size_t>{1000, 1} ); // Points 0 to 1000
+    bounded.finish(collect);
+    REQUIRE( sizes.size() == 2 + 99 );
+    REQUIRE( *std::max_element(sizes.begin(), sizes.end()) == 1000 );
+    REQUIRE( next == 100001 );
+    REQUIRE( bounded.done() );
+
+    REQUIRE_THROWS_AS( cyclic::resampler(0, 10, 0, cyclic::resample_method::linear), std::invalid_argument );
+    REQUIRE_THROWS_AS( cyclic::resampler(0, 10, 1, cyclic::resample_method::linear, 0, 0), std::invalid_argument );
+    REQUIRE_THROWS_AS( table->resample(1, 0, 10, 5, cyclic::resample_method::linear, [](const cyclic::column_chunk&) {}), std::out_of_range );
+}
+
+TEST_CASE("Memory storage top-k and crossings", "[memory]") {
+
+    // Every 10s, record n valued n % 1000, except every 7th which is null.
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({{"value", cyclic::CDB_DT_SIGNED_32}}, 10000, 0, 10);
+    for(int32_t n = 0; n < 10000; ++n)
+    {
+        cyclic::raw_record rec;
+        if(n % 7 != 6)
+        {
+            rec.set(0, n % 1000);
+        }
+        table->append_record(rec);
+    }
+
+    // Ties are ranked in index order, null values are ignored (record 1000 is null).
+    std::vector<cyclic::ranked_value> top = table->top_k(0, (cyclic::record_index_t) 0, 9999, 3);
+    REQUIRE( top.size() == 3 );
+    REQUIRE( top[0].index == 999 );
+    REQUIRE( top[1].index == 1999 );
+    REQUIRE( top[2].index == 2999 );
+    REQUIRE( top[2].value == 999 );
+
+    top = table->top_k(0, (cyclic::record_index_t) 0, 9999, 3, false);
+    REQUIRE( top.size() == 3 );
+    REQUIRE( top[0].index == 0 );
+    REQUIRE( top[1].index == 2000 );
+    REQUIRE( top[2].index == 3000 );
+    REQUIRE( top[2].value == 0 );
+
+    // Values are sorted from the best one, over a range.
+    top = table->top_k(0, (cyclic::record_index_t) 100, 104, 10);
+    REQUIRE( top.size() == 4 ); // Record 104 is null
+    REQUIRE( top[0].value == 103 );
+    REQUIRE( top[3].value == 100 );
+
+    top = table->top_k(0, (cyclic::record_time_t) 1000, (cyclic::record_time_t) 1049, 2, false);
+    REQUIRE( top.size() == 2 );
+    REQUIRE( top[0].index == 100 );
+    REQUIRE( top[1].index == 101 );
+
+    REQUIRE( table->top_k(0, (cyclic::record_index_t) 0, 9999, 0).empty() );
+    REQUIRE_THROWS_AS( table->top_k(1, (cyclic::record_index_t) 0, 9999, 3), std::out_of_range );
+
+    // Crossings over several decoded chunks match a plain scan.
+    std::vector<cyclic::threshold_crossing> crosses = table->crossings(0, (cyclic::record_index_t) 0, 9999, 500.5);
+    std::vector<cyclic::threshold_crossing> expected;
+    int side = -1;
+    for(int32_t n = 0; n < 10000; ++n)
+    {
+        if(n % 7 == 6)
+        {
+            continue;
+        }
+        int above = n % 1000 > 500.5;
+        if(side != -1 && above != side)
+        {
+            expected.push_back(cyclic::threshold_crossing{(cyclic::record_index_t) n, (double) (n % 1000), above == 1});
+        }
+        side = above;
+    }
+    REQUIRE( crosses.size() == expected.size() );
+    for(size_t n = 0; n < crosses.size(); ++n)
+    {
+        REQUIRE( crosses[n].index == expected[n].index );
+        REQUIRE( crosses[n].value == expected[n].value );
+        REQUIRE( crosses[n].rising == expected[n].rising );
+    }
+
+    // Crossings are detected between valid values, over nulls.
+    std::unique_ptr<cyclic::table> small = cyclic::store::memory::create({{"value", cyclic::CDB_DT_FLOAT_8}}, 16, 0, 10);
+    std::vector<double> values{1, 5, -1, 8, 2, 2, 9};
+    for(double val : values)
+    {
+        cyclic::raw_record rec;
+        if(val >= 0)
+        {
+            rec.set(0, val);
+        }
+        small->append_record(rec);
+    }
+    crosses = small->crossings(0, (cyclic::record_index_t) 0, 6, 4);
+    REQUIRE( crosses.size() == 3 );
+    REQUIRE( crosses[0].index == 1 );
+    REQUIRE( crosses[0].rising );
+    REQUIRE( crosses[1].index == 4 );
+    REQUIRE_FALSE( crosses[1].rising );
+    REQUIRE( crosses[2].index == 6 );
+    REQUIRE( crosses[2].value == 9 );
+
+    crosses = small->crossings(0, (cyclic::record_time_t) 30, (cyclic::record_time_t) 60, 4);
+    REQUIRE( crosses.size() == 2 );
+    REQUIRE( crosses[0].index == 4 );
+    REQUIRE( crosses[1].index == 6 );
+}
+
+
+TEST_CASE("Memory storage counters", "[memory]") {
+
+    // 8-bit counter: wrap below half of the range, reset above.
+    uint64_t samples[] = {250, 4, 2, 200};
+    uint64_t deltas[4];
+    uint8_t resets[4];
+    REQUIRE( cyclic::counter_deltas(samples, 4, 240, 8, deltas, resets) == 1 );
+    REQUIRE( deltas[0] == 10 );
+    REQUIRE( deltas[1] == 10 ); // Wrap
+    REQUIRE( deltas[2] == 2 ); // Reset
+    REQUIRE( resets[2] == 1 );
+    REQUIRE( deltas[3] == 198 );
+    REQUIRE_THROWS_AS( cyclic::counter_deltas(samples, 4, 240, 65, deltas, resets), std::invalid_argument );
+
+    // Every 10s, a 32-bit counter increases by 5, wrapping at record 100 and reset to 3 at record 5000.
+    // Every 9th record is null.
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({
+            {"bytes", cyclic::CDB_DT_UNSIGNED_32},
+            {"gauge", cyclic::CDB_DT_SIGNED_32}
+        }, 10000, 0, 10);
+    for(uint32_t n = 0; n < 10000; ++n)
+    {
+        cyclic::raw_record rec;
+        if(n % 9 != 8)
+        {
+            rec.set(0, n < 5000 ? (uint32_t) (4294966796u + 5 * n) : 3 + 5 * (n - 5000));
+            rec.set(1, (int32_t) n);
+        }
+        table->append_record(rec);
+    }
+
+    cyclic::counter_result res = table->counter(0, (cyclic::record_index_t) 0, 9999);
+    REQUIRE( res.count == 8889 );
+    REQUIRE( res.resets == 1 );
+    REQUIRE( res.increase == 5 * 4999 + 3 + 5 * 4999 );
+    REQUIRE( res.elapsed == 99990 );
+    REQUIRE( res.rate() == Approx(49993.0 / 99990) );
+
+    // Increases are attributed to the bucket of their later value, so buckets add up.
+    std::vector<cyclic::counter_bucket> buckets = table->counter_by(0, (cyclic::record_index_t) 0, 9999, 1000);
+    REQUIRE( buckets.size() == 10 );
+    REQUIRE( buckets[0].result.increase == 4995 );
+    REQUIRE( buckets[1].result.increase == 5000 );
+    REQUIRE( buckets[1].result.elapsed == 10000 );
+    REQUIRE( buckets[1].result.rate() == Approx(0.5) );
+    REQUIRE( buckets[5].result.increase == 3 + 5 * 999 );
+    REQUIRE( buckets[5].result.resets == 1 );
+    cyclic::counter_result merged;
+    for(const cyclic::counter_bucket& bucket : buckets)
+    {
+        merged.merge(bucket.result);
+    }
+    REQUIRE( merged.increase == res.increase );
+    REQUIRE( merged.elapsed == res.elapsed );
+    REQUIRE( merged.count == res.count );
+
+    buckets = table->counter_by(0, (cyclic::record_time_t) 0, (cyclic::record_time_t) 99990, 10000);
+    REQUIRE( buckets.size() == 10 );
+    REQUIRE( buckets[5].result.increase == 3 + 5 * 999 );
+    REQUIRE_THROWS_AS( table->counter_by(0, (cyclic::record_time_t) 0, (cyclic::record_time_t) 99990, 15), std::invalid_argument );
+
+    res = table->counter(0, (cyclic::record_time_t) 950, (cyclic::record_time_t) 1050);
+    REQUIRE( res.increase == 50 ); // Over the wrap
+    REQUIRE( res.resets == 0 );
+
+    // Derivatives are instant rates, null for the first value and missing records.
+    std::vector<double> rates;
+    std::vector<bool> valid;
+    table->derivative(0, (cyclic::record_index_t) 95, 5000, [&](const cyclic::column_chunk& chunk) {
+        REQUIRE( chunk.step == 10 );
+        REQUIRE( chunk.start == 950 + 10 * (cyclic::record_time_t) rates.size() );
+        for(size_t n = 0; n < chunk.size(); ++n)
+        {
+            rates.push_back(chunk.values[n]);
+            valid.push_back(chunk.valid(n));
+        }
+    });
+    REQUIRE( rates.size() == 4906 );
+    REQUIRE_FALSE( valid[0] );
+    REQUIRE( valid[1] );
+    REQUIRE( rates[1] == Approx(0.5) );
+    REQUIRE_FALSE( valid[3] ); // Record 98 is null
+    REQUIRE( rates[4] == Approx(0.5) ); // Two records after the previous value
+    REQUIRE( rates[5] == Approx(0.5) ); // Wrap
+    REQUIRE( rates[4905] == Approx(0.3) ); // Reset
+
+    REQUIRE_THROWS_AS( table->counter(1, (cyclic::record_index_t) 0, 9999), std::invalid_argument );
+
+    std::unique_ptr<cyclic::table> untimed = cyclic::store::memory::create({{"bytes", cyclic::CDB_DT_UNSIGNED_64}}, 16);
+    REQUIRE_THROWS_AS( untimed->derivative(0, (cyclic::record_index_t) 0, 9, [](const cyclic::column_chunk&) {}),
+            cyclic::time_not_supported );
+}
+
+
+TEST_CASE("Memory storage field update", "[memory]") {
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({
+            {"host", cyclic::CDB_DT_UNSIGNED_16},
+            {"value", cyclic::CDB_DT_FLOAT_8},
+            {"flag", cyclic::CDB_DT_BOOLEAN}
+        }, 16, 0, 10);
+    for(int n = 0; n < 20; ++n)
+    {
+        table->append_record(cyclic::raw_record::raw({(uint16_t) n, n * 1.5}));
+    }
+
+    // Only the field is written, others keep their values.
+    table->set_field((cyclic::record_index_t) 10, 1, 42);
+    cyclic::record_view view = table->get_record_view((cyclic::record_index_t) 10);
+    REQUIRE( view.get<double>(1) == 42.0 ); // Converted to the field type
+    REQUIRE( view.get<uint16_t>(0) == 10 );
+    REQUIRE_FALSE( view.has(2) );
+
+    table->set_field((cyclic::record_time_t) 115, 2, true);
+    REQUIRE( table->get_record_view((cyclic::record_index_t) 11).get<bool>(2) );
+
+    table->reset_field((cyclic::record_index_t) 10, 0);
+    REQUIRE_FALSE( view.has(0) );
+    REQUIRE( view.get<double>(1) == 42.0 );
+    table->set_field((cyclic::record_index_t) 10, 1, cyclic::value_t{}); // Null value resets the field
+    REQUIRE_FALSE( view.has(1) );
+    table->reset_field((cyclic::record_time_t) 110, 1); // Already null
+    REQUIRE_FALSE( view.has(1) );
+
+    // Continuous aggregates follow field updates.
+    cyclic::table::continuous_aggregate_t id = table->add_continuous_aggregate(1, (cyclic::record_index_t) 2, cyclic::AGGREGATE_SUM);
+    REQUIRE( table->continuous_aggregate(id).sum == 18 * 1.5 + 19 * 1.5 );
+    table->set_field((cyclic::record_index_t) 19, 1, 100.0);
+    REQUIRE( table->continuous_aggregate(id).sum == 18 * 1.5 + 100 );
+
+    REQUIRE_THROWS_AS( table->set_field((cyclic::record_index_t) 2, 1, 1.0), std::out_of_range ); // Evicted record
+    REQUIRE_THROWS_AS( table->set_field((cyclic::record_index_t) 10, 3, 1.0), std::out_of_range ); // Unknown field
+    REQUIRE_THROWS_AS( table->reset_field(cyclic::record::invalid_index(), 0), std::invalid_argument );
+}
+
+
+TEST_CASE("Memory storage accumulate", "[memory]") {
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create({
+            {"events", cyclic::CDB_DT_UNSIGNED_32},
+            {"bytes", cyclic::CDB_DT_UNSIGNED_64},
+            {"low", cyclic::CDB_DT_FLOAT_8},
+            {"high", cyclic::CDB_DT_SIGNED_32},
+            {"last", cyclic::CDB_DT_SIGNED_16}
+        }, 16, 0, 10);
+    table->append_record((cyclic::record_index_t) 0);
+
+    for(int n = 0; n < 100; ++n)
+    {
+        table->accumulate((cyclic::record_time_t) 5, 0, cyclic::ACCUMULATE_COUNT);
+        table->accumulate((cyclic::record_time_t) 5, 1, cyclic::ACCUMULATE_ADD, (uint64_t) 1500);
+        table->accumulate((cyclic::record_time_t) 5, 2, cyclic::ACCUMULATE_MIN, (n * 7 % 100) / 10.0);
+        table->accumulate((cyclic::record_time_t) 5, 3, cyclic::ACCUMULATE_MAX, n * 7 % 100);
+        table->accumulate((cyclic::record_time_t) 5, 4, cyclic::ACCUMULATE_LAST, n);
+    }
+    table->accumulate((cyclic::record_time_t) 5, 2, cyclic::ACCUMULATE_MIN, cyclic::value_t{}); // Ignored
+
+    // Accumulations are combined in cache until written.
+    cyclic::record_view view = table->get_record_view((cyclic::record_index_t) 0);
+    REQUIRE_FALSE( view.has(0) );
+    table->flush();
+    REQUIRE( view.get<uint32_t>(0) == 100 );
+    REQUIRE( view.get<uint64_t>(1) == 150000 );
+    REQUIRE( view.get<double>(2) == 0 );
+    REQUIRE( view.get<int32_t>(3) == 99 );
+    REQUIRE( view.get<int16_t>(4) == 99 );
+
+    // Accumulating in a following record closes the previous one and appends the new one.
+    table->accumulate((cyclic::record_time_t) 7, 0, cyclic::ACCUMULATE_COUNT);
+    table->accumulate((cyclic::record_time_t) 35, 0, cyclic::ACCUMULATE_COUNT);
+    REQUIRE( table->max_index() == 3 );
+    REQUIRE( view.get<uint32_t>(0) == 101 );
+    REQUIRE_FALSE( table->get_record_view((cyclic::record_index_t) 2).has(0) );
+
+    // Other modifications write accumulations before applying.
+    table->set_field((cyclic::record_index_t) 3, 1, (uint64_t) 10);
+    REQUIRE( table->get_record_view((cyclic::record_index_t) 3).get<uint32_t>(0) == 1 );
+    REQUIRE( table->get_record_view((cyclic::record_index_t) 3).get<uint64_t>(1) == 10 );
+
+    // Without flush interval, each accumulation is written.
+    table->configure_accumulate(std::chrono::milliseconds(0));
+    table->accumulate((cyclic::record_index_t) 3, 1, cyclic::ACCUMULATE_ADD, 5);
+    REQUIRE( table->get_record_view((cyclic::record_index_t) 3).get<uint64_t>(1) == 15 );
+
+    // Continuous aggregates follow written accumulations.
+    cyclic::table::continuous_aggregate_t id = table->add_continuous_aggregate(0, (cyclic::record_index_t) 4, cyclic::AGGREGATE_SUM);
+    table->accumulate((cyclic::record_index_t) 3, 0, cyclic::ACCUMULATE_COUNT);
+    REQUIRE( table->continuous_aggregate(id).sum == 101 + 2 );
+
+    for(cyclic::record_index_t n = 4; n < 20; ++n)
+    {
+        table->accumulate(n, 0, cyclic::ACCUMULATE_COUNT);
+    }
+    REQUIRE_THROWS_AS( table->accumulate((cyclic::record_index_t) 2, 0, cyclic::ACCUMULATE_COUNT), std::out_of_range ); // Evicted
+    REQUIRE_THROWS_AS( table->accumulate((cyclic::record_index_t) 19, 5, cyclic::ACCUMULATE_COUNT), std::out_of_range );
+
+    // The last accumulation of a burst is written when the flush interval is elapsed.
+    table->configure_accumulate(std::chrono::milliseconds(20));
+    table->accumulate((cyclic::record_index_t) 19, 1, cyclic::ACCUMULATE_ADD, (uint64_t) 42);
+    REQUIRE_FALSE( table->get_record_view((cyclic::record_index_t) 19).has(1) );
+    for(int n = 0; n < 500 && !table->get_record_view((cyclic::record_index_t) 19).has(1); ++n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    REQUIRE( table->get_record_view((cyclic::record_index_t) 19).get<uint64_t>(1) == 42 );
+
+    std::unique_ptr<cyclic::table> stamped = cyclic::store::memory::create_timestamped({{"value", cyclic::CDB_DT_SIGNED_32}}, 16);
+    REQUIRE_THROWS_AS( stamped->accumulate((cyclic::record_index_t) 0, 0, cyclic::ACCUMULATE_COUNT), std::logic_error );
+}
+
+
+TEST_CASE("Memory storage filter", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32},
+        {"errors", cyclic::CDB_DT_UNSIGNED_8}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 10000, 0, 10);
+    for(int32_t n = 0; n < 12345; ++n)
+    {
+        cyclic::raw_record rec = cyclic::raw_record::raw({n});
+        if(n % 7 != 0)
+        {
+            rec.set(1, (uint8_t) (n % 1000 == 1 ? 3 : 0));
+        }
+        table->append_record(rec);
+    }
+
+    cyclic::predicate errors = cyclic::predicate::compare(1, cyclic::predicate::GREATER, 0);
+    std::vector<cyclic::record_index_t> found = table->filter(errors, 0, 20000);
+    REQUIRE( found.size() == 9 ); // 3001 to 12001 in stored range, except 8001 which is null
+    REQUIRE( found.front() == 3001 );
+    REQUIRE( found.back() == 12001 );
+
+    cyclic::predicate combined = (errors || cyclic::predicate::is_null(1))
+            && cyclic::predicate::compare(0, cyclic::predicate::LESS_EQUAL, 3010);
+    found = table->filter(combined, 2990, 5000);
+    REQUIRE( found.size() == 4 );
+    REQUIRE( found[0] == 2996 );
+    REQUIRE( found[1] == 3001 );
+    REQUIRE( found[2] == 3003 );
+    REQUIRE( found[3] == 3010 );
+    for(cyclic::record_index_t index : found)
+    {
+        REQUIRE( combined.matches(*table->get_record(index)) ); // Same result than record evaluation
+    }
+    REQUIRE( !combined.matches(*table->get_record((cyclic::record_index_t) 3004)) );
+    REQUIRE( combined.fields().size() == 2 );
+
+    REQUIRE( table->filter(cyclic::predicate::is_not_null(1), 0, 100).empty() ); // Not stored anymore
+    REQUIRE_THROWS_AS( table->filter(cyclic::predicate::is_null(2), 3000, 4000), std::out_of_range );
+    REQUIRE_THROWS_AS( table->filter(errors, 4000, 3000), std::invalid_argument );
+}
+
+TEST_CASE("Memory storage filter in stored types", "[memory]") {
+
+    std::vector<cyclic::field_st> fields{
+        {"id", cyclic::CDB_DT_SIGNED_64},
+        {"small", cyclic::CDB_DT_UNSIGNED_8},
+        {"ratio", cyclic::CDB_DT_FLOAT_4}
+    };
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 100);
+    const int64_t base = (int64_t) 1 << 60; // Not exactly comparable as double
+    for(int32_t n = 0; n < 20; ++n)
+    {
+        table->append_record(cyclic::raw_record::raw({(int64_t) (base + n), (uint8_t) (n * 10), n / 4.0f}));
+    }
+
+    using cyclic::predicate;
+    REQUIRE( table->filter(predicate::compare(0, predicate::GREATER, (double) base), 0, 19).size() == 19 );
+    REQUIRE( table->filter(predicate::compare(0, predicate::EQUAL, (double) base), 0, 19).size() == 1 );
+
+    REQUIRE( table->filter(predicate::compare(1, predicate::LESS, 25.5), 0, 19).size() == 3 ); // 0, 10, 20
+    REQUIRE( table->filter(predicate::compare(1, predicate::GREATER_EQUAL, 25.5), 0, 19).size() == 17 );
+    REQUIRE( table->filter(predicate::compare(1, predicate::EQUAL, 20.5), 0, 19).empty() );
+    REQUIRE( table->filter(predicate::compare(1, predicate::NOT_EQUAL, 20.5), 0, 19).size() == 20 );
+    REQUIRE( table->filter(predicate::compare(1, predicate::LESS, 300), 0, 19).size() == 20 ); // Out of type range
+    REQUIRE( table->filter(predicate::compare(1, predicate::GREATER, -1), 0, 19).size() == 20 );
+    REQUIRE( table->filter(predicate::compare(1, predicate::LESS_EQUAL, -0.5), 0, 19).empty() );
+
+    REQUIRE( table->filter(predicate::compare(2, predicate::EQUAL, 1.25), 0, 19).size() == 1 );
+    REQUIRE( table->filter(predicate::compare(2, predicate::LESS, 1.25), 0, 19).size() == 5 );
+
+    // Records are evaluated the same way, one by one.
+    predicate exact = predicate::compare(0, predicate::EQUAL, (double) base);
+    REQUIRE( exact.matches(*table->get_record((cyclic::record_index_t) 0)) );
+    REQUIRE( !exact.matches(*table->get_record((cyclic::record_index_t) 1)) );
+    REQUIRE( !predicate::compare(1, predicate::EQUAL, 20.5).matches(*table->get_record((cyclic::record_index_t) 2)) );
+    REQUIRE( predicate::compare(1, predicate::LESS, 300).matches(*table->get_record((cyclic::record_index_t) 19)) );
+    REQUIRE( table->cyclic::recordset::filter(exact, 0, 19).size() == 1 );
+    REQUIRE( table->cyclic::recordset::filter(predicate::compare(0, predicate::GREATER, (double) base), 0, 19).size() == 19 );
+
+    // Block evaluation is compiled once, and can be repeated.
+    std::vector<double> values{0.5, 1.5, 2.5};
+    const uint8_t valid = 0x7;
+    predicate less = predicate::compare(0, predicate::LESS, 2) && predicate::is_not_null(0);
+    for(int n = 0; n < 2; ++n)
+    {
+        uint8_t selection = 0;
+        less.evaluate(values.size(), [&](cyclic::field_index_t, const uint8_t*& validity) {
+            validity = &valid;
+            return values.data();
+        }, &selection);
+        REQUIRE( selection == 0x3 );
+    }
+}
+
+namespace
+{
+    CYCLIC_TYPED_FIELD(cpu, float);
+    CYCLIC_TYPED_FIELD(up, bool);
+    CYCLIC_TYPED_FIELD(mem, uint64_t);
+    typedef cyclic::store::typed_table<cpu, up, mem> usage_table;
+}
+
+TEST_CASE("Memory storage typed table", "[memory]") {
+
+    static_assert(usage_table::header_size == 1, "One byte of header");
+    static_assert(usage_table::record_size == 1 + 4 + 1 + 8, "Packed fields");
+    static_assert(usage_table::offsets()[2] == 6, "Packed offsets");
+
+    usage_table table = usage_table::create(10, 1000, 10);
+    for(int n = 0; n < 15; ++n)
+    {
+        usage_table::row rec;
+        rec.set<cpu>(n * 0.5f).set<mem>(((uint64_t) 1 << 40) + n);
+        if(n % 3 == 0)
+        {
+            rec.set<up>(n % 2 == 0);
+        }
+        table.append(rec);
+    }
+
+    REQUIRE( table.table().record_count() == 10 );
+    REQUIRE( table.table().min_index() == 5 );
+
+    usage_table::row rec = table.get(9);
+    REQUIRE( rec.index() == 9 );
+    REQUIRE( rec.get<cpu>() == 4.5f );
+    REQUIRE( rec.get<mem>() == ((uint64_t) 1 << 40) + 9 );
+    REQUIRE( rec.has<up>() );
+    REQUIRE( !rec.get<up>() );
+    REQUIRE( !table.get(10).has<up>() );
+    REQUIRE_THROWS_AS( table.get(10).get<up>(), cyclic::no_value_exception );
+    REQUIRE( table.get(10).get_or<up>(true) );
+    REQUIRE_THROWS_AS( table.get(2), std::out_of_range ); // Not stored anymore
+
+    // Typed records are stored like any other one
+    std::unique_ptr<cyclic::record> raw = table.table().get_record((cyclic::record_index_t) 12);
+    REQUIRE( raw->get<float>(0) == 6.0f );
+    REQUIRE( raw->get<bool>(1) == true );
+    REQUIRE( raw->get<uint64_t>(2) == ((uint64_t) 1 << 40) + 12 );
+    REQUIRE( table.get(12).reset<cpu>().has<cpu>() == false );
+
+    REQUIRE_THROWS_AS( usage_table{cyclic::store::memory::create({{"cpu", cyclic::CDB_DT_FLOAT_8}, {"up", cyclic::CDB_DT_BOOLEAN},
+            {"mem", cyclic::CDB_DT_UNSIGNED_64}}, 10)}, std::invalid_argument ); // Type mismatch
+}
+
+TEST_CASE("Memory storage power of two capacity", "[memory]")
+{
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+    REQUIRE_THROWS_AS( cyclic::store::memory::create(fields, 12, 0, 0, cyclic::store::TABLE_POW2_CAPACITY), std::invalid_argument );
+
+    std::unique_ptr<cyclic::table> table = cyclic::store::memory::create(fields, 8);
+    std::unique_ptr<cyclic::table> pow2 = cyclic::store::memory::create(fields, 8, 0, 0, cyclic::store::TABLE_POW2_CAPACITY);
+
+    INFO( "Same records as the state machine, through wraps and gaps" );
+    for(int32_t n = 0; n < 40; ++n)
+    {
+        cyclic::record_index_t index = n == 0 ? 0 : table->max_index() + 1 + (n % 7 == 0 ? 3 : 0);
+        table->append_record(index, cyclic::raw_record::raw({n}));
+        pow2->append_record(index, cyclic::raw_record::raw({n}));
+        REQUIRE( pow2->record_count() == table->record_count() );
+        REQUIRE( pow2->min_index() == table->min_index() );
+        REQUIRE( pow2->max_index() == table->max_index() );
+        for(cyclic::record_index_t idx = table->min_index(); idx <= table->max_index(); ++idx)
+        {
+            cyclic::record_view expected = table->get_record_view(idx);
+            cyclic::record_view view = pow2->get_record_view(idx);
+            REQUIRE( view.has(0) == expected.has(0) );
+            REQUIRE( (!expected.has(0) || view.get<int32_t>(0) == expected.get<int32_t>(0)) );
+        }
+        REQUIRE( !pow2->get_record((cyclic::record_index_t) (table->min_index() - 1)) );
+        REQUIRE( !pow2->get_record((cyclic::record_index_t) (table->max_index() + 1)) );
+    }
+
+    INFO( "Single record capacity" );
+    std::unique_ptr<cyclic::table> single = cyclic::store::memory::create(fields, 1, 0, 0, cyclic::store::TABLE_POW2_CAPACITY);
+    single->append_record((cyclic::record_index_t)0, cyclic::raw_record::raw({1}));
+    single->append_record(cyclic::raw_record::raw({2}));
+    REQUIRE( single->record_count() == 1 );
+    REQUIRE( single->min_index() == 1 );
+    REQUIRE( single->get_record((cyclic::record_index_t)1)->get<int32_t>(0) == 2 );
+}
+
+TEST_CASE("Memory storage wide indexes", "[memory]")
+{
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+
+    INFO( "Gaps larger than capacity are not walked" );
+    std::unique_ptr<cyclic::table> narrow = cyclic::store::memory::create(fields, 4, 0, 1);
+    narrow->append_record((cyclic::record_index_t)0, cyclic::raw_record::raw({0}));
+    narrow->append_record((cyclic::record_index_t)1000000, cyclic::raw_record::raw({1}));
+    REQUIRE( narrow->min_index() == 999997 );
+    REQUIRE( narrow->max_index() == 1000000 );
+    REQUIRE( !narrow->get_record_view((cyclic::record_index_t)999999).has(0) );
+    REQUIRE( narrow->get_record_view((cyclic::record_index_t)1000000).get<int32_t>(0) == 1 );
+
+    INFO( "Indexes are limited to 32 bits by default" );
+    cyclic::record_index_t limit = std::numeric_limits<uint32_t>::max() - 2;
+    narrow->append_record(limit, cyclic::raw_record::raw({2}));
+    REQUIRE( narrow->max_index() == limit );
+    REQUIRE( narrow->get_record_view(limit).get<int32_t>(0) == 2 );
+    REQUIRE_THROWS_AS( narrow->append_record(), cyclic::table_is_full );
+    REQUIRE_THROWS_AS( narrow->append_record(limit + 1, cyclic::raw_record::raw({3})), cyclic::table_is_full );
+    REQUIRE_THROWS_AS( narrow->record_index((cyclic::record_time_t)1 << 40), std::out_of_range );
+
+    for(cyclic::store::table_options options : std::vector<cyclic::store::table_options>{cyclic::store::TABLE_WIDE_INDEX,
+            cyclic::store::TABLE_WIDE_INDEX | cyclic::store::TABLE_POW2_CAPACITY})
+    {
+        INFO( "Indexes beyond 32 bits with wide indexes" );
+        std::unique_ptr<cyclic::table> wide = cyclic::store::memory::create(fields, 4, 0, 1, options);
+        cyclic::record_time_t time = (cyclic::record_time_t)1 << 40;
+        wide->append_record((cyclic::record_index_t)0, cyclic::raw_record::raw({0}));
+        wide->append_record(time, cyclic::raw_record::raw({1}));
+        wide->append_record(cyclic::raw_record::raw({2}));
+        REQUIRE( wide->min_index() == (cyclic::record_index_t)time - 2 );
+        REQUIRE( wide->max_index() == (cyclic::record_index_t)time + 1 );
+        REQUIRE( wide->record_count() == 4 );
+        REQUIRE( wide->get_record(time)->get<int32_t>(0) == 1 );
+        REQUIRE( wide->record_time(wide->max_index()) == time + 1 );
+        REQUIRE( wide->get_record_view(wide->max_index()).get<int32_t>(0) == 2 );
+    }
+}
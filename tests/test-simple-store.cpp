@@ -21,8 +21,14 @@
 
 #include <limits>
 #include <cmath>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "libstore.hpp"
+#include "libstore-typed.hpp"
 #include "common-file.hpp"
 
 std::string filename = "test-simple.cydb";
@@ -423,3 +429,365 @@ TEST_CASE("Another simple storage", "[simple]")
     }
     removeTable();
 }
+
+TEST_CASE("Simple storage shared between a writer and a reader", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> writer = createTable();
+        std::unique_ptr<cyclic::table> reader = openTable();
+
+        REQUIRE( reader->record_count() == 0 ); // Nothing written yet
+        REQUIRE( !reader->refresh() ); // Nothing changed yet
+
+        std::unique_ptr<cyclic::mutable_record> rec = writer->get_record();
+        *rec << row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25};
+        writer->append_record(*rec);
+        writer->append_record(*rec);
+
+        REQUIRE( reader->refresh() ); // Writer appended records
+        REQUIRE( reader->min_index() == 0 );
+        REQUIRE( reader->max_index() == 1 );
+        REQUIRE( !reader->refresh() ); // No change since last refresh
+
+        row r;
+        r << *reader->get_record((cyclic::record_index_t)1);
+        REQUIRE( r == row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25} ); // Reader sees written record
+
+        REQUIRE_THROWS_AS( reader->append_record(*rec), std::logic_error ); // Reader cannot write
+
+        std::thread appender([&writer, &rec]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            writer->append_record(*rec);
+        });
+        REQUIRE( reader->wait_for_index(2, std::chrono::milliseconds(5000)) ); // Reader is woken up by writer append
+        appender.join();
+        REQUIRE( reader->max_index() == 2 );
+        REQUIRE( !reader->wait_for_index(3, std::chrono::milliseconds(20)) ); // Nothing more appended
+
+        REQUIRE_THROWS_AS( createTable(), cyclic::io::io_exception ); // Cannot create over a written table
+        REQUIRE( openTable()->max_index() == 2 ); // Which is left untouched
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage opened by two writers", "[simple]")
+{
+    createTable();
+    {
+        std::unique_ptr<cyclic::table> first = openTable();
+        std::unique_ptr<cyclic::table> second = openTable();
+        first->append_record();
+        REQUIRE_THROWS_AS( second->append_record(), std::logic_error ); // Only one writer
+
+        // The writer lock (on the file header) is seen from another process.
+        pid_t pid = ::fork();
+        if(pid == 0)
+        {
+            int fd = ::open(filename.c_str(), O_RDWR);
+            struct flock fl = {};
+            fl.l_type = F_WRLCK;
+            fl.l_whence = SEEK_SET;
+            fl.l_start = 0;
+            fl.l_len = 8;
+            bool locked = fd != -1 && ::fcntl(fd, F_GETLK, &fl) == 0 && fl.l_type != F_UNLCK;
+            ::_exit(locked ? 0 : 1);
+        }
+        int status = -1;
+        REQUIRE( ::waitpid(pid, &status, 0) == pid );
+        REQUIRE( WIFEXITED(status) );
+        REQUIRE( WEXITSTATUS(status) == 0 );
+
+        second.reset();
+        std::unique_ptr<cyclic::table> third = openTable();
+        REQUIRE_THROWS_AS( third->append_record(), std::logic_error ); // Still held by the first one
+        first->append_record();
+        REQUIRE( third->refresh() );
+        REQUIRE( third->max_index() == 1 );
+    }
+    REQUIRE_NOTHROW( openTable()->append_record() ); // Released with the writer
+    removeTable();
+}
+
+TEST_CASE("Simple storage opened in read-only mode", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> writer = createTable();
+        std::unique_ptr<cyclic::mutable_record> rec = writer->get_record();
+        *rec << row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25};
+        writer->append_record(*rec);
+
+        std::unique_ptr<cyclic::table> reader = cyclic::store::file::open(filename, cyclic::store::file::open_mode::read_only);
+        REQUIRE( reader->max_index() == 0 );
+
+        row r;
+        r << *reader->get_record((cyclic::record_index_t)0);
+        REQUIRE( r == row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25} ); // Record read from mapping
+
+        REQUIRE_THROWS_AS( reader->append_record(*rec), std::logic_error ); // Read-only table cannot be appended
+        REQUIRE_THROWS_AS( reader->set_record((cyclic::record_index_t)0, *rec), std::logic_error ); // Read-only table cannot be modified
+
+        *rec << row{false, 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0};
+        writer->append_record(*rec);
+        REQUIRE( reader->refresh() ); // Writer appended a record
+        r << *reader->get_record((cyclic::record_index_t)1);
+        REQUIRE( r == row{false, 1, 2, 3, 4, 5, 6, 7, 8, 9.0f, 10.0} ); // Mapping follows writer modifications
+    }
+    {
+        // Read-only instances do not prevent another instance from writing.
+        std::unique_ptr<cyclic::table> reader = cyclic::store::file::open(filename, cyclic::store::file::open_mode::read_only);
+        std::unique_ptr<cyclic::table> writer = openTable();
+        std::unique_ptr<cyclic::mutable_record> rec = writer->get_record();
+        REQUIRE_NOTHROW( writer->append_record(*rec) );
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage record view", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> table = createTable();
+        std::unique_ptr<cyclic::mutable_record> rec = table->get_record();
+        *rec << row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25};
+        table->append_record(*rec);
+
+        cyclic::record_view view = table->get_record_view((cyclic::record_index_t)0);
+        REQUIRE( view );
+        REQUIRE( view.get<bool>(0) == true );
+        REQUIRE( view.get<int8_t>(1) == -1 );
+        REQUIRE( view.get<int16_t>(3) == -3 );
+        REQUIRE( view.get<uint64_t>(8) == 8 );
+        REQUIRE( view.get<float>(9) == 9.5f );
+        REQUIRE( view.get<double>(10) == 10.25 );
+
+        rec->set(10, 20.5);
+        table->set_record((cyclic::record_index_t)0, *rec);
+        REQUIRE( view.get<double>(10) == 20.5 ); // View follows the stored slot
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage field update", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> writer = createTable();
+        std::unique_ptr<cyclic::table> reader = openTable();
+        std::unique_ptr<cyclic::mutable_record> rec = writer->get_record();
+        *rec << row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25};
+        writer->append_record(*rec);
+        writer->append_record(*rec);
+
+        writer->set_field((cyclic::record_index_t)1, 10, 20.5);
+        writer->reset_field((cyclic::record_index_t)1, 3);
+        REQUIRE( reader->refresh() );
+
+        cyclic::record_view view = reader->get_record_view((cyclic::record_index_t)1);
+        REQUIRE( view.get<double>(10) == 20.5 ); // Reader sees updated fields
+        REQUIRE_FALSE( view.has(3) );
+        REQUIRE( view.get<int32_t>(5) == -5 ); // Other fields are untouched
+
+        row r;
+        r << *reader->get_record((cyclic::record_index_t)0);
+        REQUIRE( r == row{true, -1, 2, -3, 4, -5, 6, -7, 8, 9.5f, 10.25} ); // Other records are untouched
+
+        writer->set_field((cyclic::record_index_t)0, 7, (int64_t) 70);
+        writer->reset_field((cyclic::record_index_t)0, 0);
+        REQUIRE_FALSE( reader->refresh() ); // No index changed
+        view = reader->get_record_view((cyclic::record_index_t)0);
+        REQUIRE( view.get<int64_t>(7) == 70 ); // But updated fields are seen
+        REQUIRE_FALSE( view.has(0) );
+        REQUIRE( view.get<int8_t>(1) == -1 );
+
+        REQUIRE_THROWS_AS( reader->set_field((cyclic::record_index_t)0, 10, 1.0), std::logic_error ); // Reader cannot write
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage accumulate", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> table = createTable();
+        table->append_record((cyclic::record_index_t)0);
+        for(int n = 0; n < 1000; ++n)
+        {
+            table->accumulate((cyclic::record_index_t)1, 8, cyclic::ACCUMULATE_ADD, (uint64_t) n);
+        }
+        REQUIRE( table->max_index() == 1 ); // Record appended on first accumulation
+    }
+    {
+        // Accumulations are written when the table is closed.
+        std::unique_ptr<cyclic::table> table = openTable();
+        REQUIRE( table->get_record_view((cyclic::record_index_t)1).get<uint64_t>(8) == 499500 );
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage column read", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> table = createTable();
+        std::unique_ptr<cyclic::mutable_record> rec = table->get_record();
+        for(int n = 0; n < 25; ++n)
+        {
+            *rec << row{n % 2 == 0, (int8_t) -n, 2, -3, 4, -5, 6, (int64_t) n * 1000, 8, 0.5f * n, 0.25 * n};
+            table->append_record(*rec);
+        }
+
+        int64_t i64[20];
+        REQUIRE( table->read_column<int64_t>(7, 5, 24, i64) == 20 );
+        for(int n = 0; n < 20; ++n)
+        {
+            REQUIRE( i64[n] == (n + 5) * 1000 );
+        }
+
+        float f[20];
+        bool b[20];
+        REQUIRE( table->read_column<float>(10, 5, 24, f) == 20 );
+        REQUIRE( f[19] == 6.0f );
+        REQUIRE( table->read_column<bool>(0, 5, 24, b) == 20 );
+        REQUIRE( !b[0] );
+        REQUIRE( b[1] );
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage latest records", "[simple]")
+{
+    {
+        std::unique_ptr<cyclic::table> table = createTable();
+        std::unique_ptr<cyclic::mutable_record> rec = table->get_record();
+        for(int n = 0; n < 25; ++n)
+        {
+            *rec << row{true, (int8_t) -n, 2, -3, 4, -5, 6, (int64_t) n * 1000, 8, 0.5f * n, 0.25 * n};
+            table->append_record(*rec);
+        }
+
+        std::vector<cyclic::record_view> views;
+        REQUIRE( table->latest(4, views) == 4 );
+        REQUIRE( views[0].index() == 24 );
+        REQUIRE( views[0].get<int64_t>(7) == 24000 );
+        REQUIRE( views[3].get<double>(10) == 0.25 * 21 );
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage timestamped table", "[simple]")
+{
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_FLOAT_8}
+    };
+    {
+        std::unique_ptr<cyclic::table> table = cyclic::store::file::create_timestamped(filename, cyclic::store::file::COMPACT, fields, 4);
+        for(int n = 0; n < 6; ++n)
+        {
+            table->append_record((cyclic::record_time_t) (n * n), cyclic::raw_record::raw({0.5 * n}));
+        }
+    }
+    {
+        std::unique_ptr<cyclic::table> table = openTable();
+        REQUIRE( table->timestamped() );
+        REQUIRE( table->min_index() == 2 );
+        REQUIRE( table->record_time(2) == 4 );
+        REQUIRE( table->record_index((cyclic::record_time_t)15) == 3 );
+        REQUIRE( table->record_index((cyclic::record_time_t)16) == 4 );
+        REQUIRE( table->get_record((cyclic::record_time_t)30)->get<double>(0) == 2.5 );
+        REQUIRE( table->get_record_view((cyclic::record_index_t)4).time() == 16 );
+        REQUIRE( table->get_record_view((cyclic::record_index_t)4).get<double>(0) == 2.0 );
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage power of two capacity", "[simple]")
+{
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+    REQUIRE_THROWS_AS( cyclic::store::file::create(filename, cyclic::store::file::COMPACT, fields, 6, 0, 0,
+            cyclic::store::TABLE_POW2_CAPACITY), std::invalid_argument );
+    {
+        std::unique_ptr<cyclic::table> table = cyclic::store::file::create(filename, cyclic::store::file::COMPACT, fields, 4, 0, 0,
+                cyclic::store::TABLE_POW2_CAPACITY);
+        table->append_record((cyclic::record_index_t)0, cyclic::raw_record::raw({0}));
+        for(int32_t n = 1; n < 6; ++n)
+        {
+            table->append_record(cyclic::raw_record::raw({n}));
+        }
+    }
+    {
+        std::unique_ptr<cyclic::table> table = openTable();
+        REQUIRE( table->min_index() == 2 );
+        REQUIRE( table->max_index() == 5 );
+        table->append_record(cyclic::raw_record::raw({6}));
+        REQUIRE( table->min_index() == 3 );
+        for(cyclic::record_index_t idx = 3; idx <= 6; ++idx)
+        {
+            REQUIRE( table->get_record_view(idx).get<int32_t>(0) == (int32_t) idx );
+        }
+    }
+    removeTable();
+}
+
+TEST_CASE("Simple storage wide indexes", "[simple]")
+{
+    std::vector<cyclic::field_st> fields{
+        {"value", cyclic::CDB_DT_SIGNED_32}
+    };
+    cyclic::record_index_t first = (cyclic::record_index_t)1 << 36;
+    {
+        std::unique_ptr<cyclic::table> table = cyclic::store::file::create(filename, cyclic::store::file::COMPACT, fields, 3, 0, 0,
+                cyclic::store::TABLE_WIDE_INDEX);
+        table->append_record((cyclic::record_index_t)0, cyclic::raw_record::raw({0}));
+        table->append_record(first, cyclic::raw_record::raw({1}));
+        table->append_record(cyclic::raw_record::raw({2}));
+    }
+    {
+        std::unique_ptr<cyclic::table> table = openTable();
+        REQUIRE( table->min_index() == first - 1 );
+        REQUIRE( table->max_index() == first + 1 );
+        REQUIRE( !table->get_record_view(first - 1).has(0) );
+        REQUIRE( table->get_record_view(first).get<int32_t>(0) == 1 );
+        table->append_record(cyclic::raw_record::raw({3}));
+        REQUIRE( table->get_record_view(first + 2).get<int32_t>(0) == 3 );
+        REQUIRE( table->min_index() == first );
+    }
+    REQUIRE( openTable()->max_index() == first + 2 );
+    removeTable();
+}
+
+TEST_CASE("Simple storage unknown record options", "[simple]")
+{
+    createTable();
+    {
+        cyclic::io::file file;
+        file.open(filename);
+        file.write_at((uint32_t) 0x8, 12); // Record options, unknown flag
+    }
+    REQUIRE_THROWS_AS( openTable(), cyclic::io::io_exception );
+    removeTable();
+}
+
+namespace
+{
+    CYCLIC_TYPED_FIELD(temperature, double);
+    CYCLIC_TYPED_FIELD(sensor, uint16_t);
+    typedef cyclic::store::typed_table<temperature, sensor> sensor_table;
+}
+
+TEST_CASE("Simple storage typed table", "[simple]")
+{
+    {
+        sensor_table table = sensor_table::create(filename, 100);
+        table.append(sensor_table::row{}.set<temperature>(21.5).set<sensor>(3));
+        table.append(sensor_table::row{}.set<sensor>(4), 5);
+    }
+    {
+        sensor_table table = sensor_table::open(filename, cyclic::store::file::open_mode::read_only);
+        REQUIRE( table.table().max_index() == 5 );
+        REQUIRE( table.get(0).get<temperature>() == 21.5 );
+        REQUIRE( table.get(0).get<sensor>() == 3 );
+        REQUIRE( !table.get(5).has<temperature>() );
+        REQUIRE( table.get(5).get<sensor>() == 4 );
+        REQUIRE( !table.get(3).has<sensor>() ); // Empty records appended before
+    }
+    REQUIRE_THROWS_AS( cyclic::store::typed_table<temperature>::open(filename), std::invalid_argument );
+    removeTable();
+}
@@ -480,3 +480,159 @@ TEST_CASE("Test reset 04", "[command]")
     REQUIRE( reset->position().state()==helpers::position::TIME ); // Have a specified time
     REQUIRE( reset->position().time()==12 ); // Have correct specified time
 }
+
+TEST_CASE("Test select where 01", "[command]")
+{
+    commands::command* cmd = parse_command("select * start 10 where errors > 0");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select* select = dynamic_cast<commands::select*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse 'select' command
+    REQUIRE( select->start().index()==10 );
+    REQUIRE( select->where()!=nullptr ); // Have a condition
+    REQUIRE( select->where()->type==cyclic::predicate::COMPARE );
+    REQUIRE( select->where()->column=="errors" );
+    REQUIRE( select->where()->op==cyclic::predicate::GREATER );
+    REQUIRE( select->where()->value==0 );
+}
+
+TEST_CASE("Test select joined columns", "[command]")
+{
+    commands::command* cmd = parse_command("select cpu.load, mem.used_kb where mem.used_kb > 100");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select* select = dynamic_cast<commands::select*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse 'select' command
+    REQUIRE( select->colnames().size()==2 );
+    REQUIRE( select->colnames()[0]=="cpu.load" ); // Field prefixed by its file name
+    REQUIRE( select->colnames()[1]=="mem.used_kb" );
+    REQUIRE( select->where()->column=="mem.used_kb" );
+}
+
+TEST_CASE("Test select where 02", "[command]")
+{
+    commands::command* cmd = parse_command("select cpu where cpu >= 12.5 and host is not null or (mem is null or mem<>3)");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select* select = dynamic_cast<commands::select*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse 'select' command
+    REQUIRE( select->colnames().size()==1 );
+
+    helpers::condition_ptr cond = select->where();
+    REQUIRE( cond!=nullptr );
+    REQUIRE( cond->type==cyclic::predicate::OR ); // 'and' has precedence over 'or'
+    REQUIRE( cond->left->type==cyclic::predicate::AND );
+    REQUIRE( cond->left->left->op==cyclic::predicate::GREATER_EQUAL );
+    REQUIRE( cond->left->left->value==12.5 );
+    REQUIRE( cond->left->right->type==cyclic::predicate::IS_NOT_NULL );
+    REQUIRE( cond->left->right->column=="host" );
+    REQUIRE( cond->right->type==cyclic::predicate::OR );
+    REQUIRE( cond->right->left->type==cyclic::predicate::IS_NULL );
+    REQUIRE( cond->right->right->op==cyclic::predicate::NOT_EQUAL );
+
+    select = dynamic_cast<commands::select*>(parse_command("select cpu"));
+    REQUIRE( select!=nullptr );
+    REQUIRE( select->where()==nullptr ); // No condition
+}
+
+TEST_CASE("Test select aggregate 01", "[command]")
+{
+    commands::command* cmd = parse_command("select avg(cpu), MAX(cpu), count(mem) start 2 end 25");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_aggregate* select = dynamic_cast<commands::select_aggregate*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse aggregating 'select' command
+
+    REQUIRE( select->items().size()==3 ); // Have 3 aggregates
+    REQUIRE( select->items()[0].op==cyclic::AGGREGATE_AVG );
+    REQUIRE( select->items()[0].column=="cpu" );
+    REQUIRE( select->items()[1].op==cyclic::AGGREGATE_MAX );
+    REQUIRE( select->items()[2].op==cyclic::AGGREGATE_COUNT );
+    REQUIRE( select->items()[2].column=="mem" );
+    REQUIRE( select->start().index()==2 ); // Have correct start index
+    REQUIRE( select->end().index()==25 ); // Have correct end index
+}
+
+TEST_CASE("Test select aggregate group by 01", "[command]")
+{
+    commands::command* cmd = parse_command("select avg(cpu) start time 1000 group by 5m");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_aggregate* select = dynamic_cast<commands::select_aggregate*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse aggregating 'select' command
+    REQUIRE( select->start().time()==1000 );
+    REQUIRE( select->group().state()==helpers::position::TIME ); // Group by time interval
+    REQUIRE( select->group().time()==300 );
+}
+
+TEST_CASE("Test select aggregate group by 02", "[command]")
+{
+    commands::command* cmd = parse_command("select max(cpu) group by 12");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_aggregate* select = dynamic_cast<commands::select_aggregate*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse aggregating 'select' command
+    REQUIRE( select->group().state()==helpers::position::INDEX ); // Group by number of records
+    REQUIRE( select->group().index()==12 );
+
+    select = dynamic_cast<commands::select_aggregate*>(parse_command("select max(cpu)"));
+    REQUIRE( select!=nullptr );
+    REQUIRE( select->group().state()==helpers::position::NONE ); // Not grouped
+}
+
+TEST_CASE("Test select aggregate 02", "[command]")
+{
+    commands::command* cmd = parse_command("select count, max");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select* select = dynamic_cast<commands::select*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse plain 'select' command on columns named like aggregates
+    REQUIRE( select->colnames().size()==2 );
+}
+
+TEST_CASE("Test select top", "[command]")
+{
+    commands::command* cmd = parse_command("select top(cpu, 10) start time 1000");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_top* select = dynamic_cast<commands::select_top*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse 'select top' command
+    REQUIRE( select->largest() );
+    REQUIRE( select->column()=="cpu" );
+    REQUIRE( select->count()==10 );
+    REQUIRE( select->start().time()==1000 );
+
+    select = dynamic_cast<commands::select_top*>(parse_command("SELECT BOTTOM(mem, 3) end 25"));
+    REQUIRE( select!=nullptr );
+    REQUIRE_FALSE( select->largest() ); // Smallest values
+    REQUIRE( select->end().index()==25 );
+
+    REQUIRE( dynamic_cast<commands::select*>(parse_command("select top, bottom"))!=nullptr ); // Columns named like orders
+}
+
+TEST_CASE("Test select crossings", "[command]")
+{
+    commands::command* cmd = parse_command("select crossings(cpu, 90.5) start 2 end 25");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_crossings* select = dynamic_cast<commands::select_crossings*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse 'select crossings' command
+    REQUIRE( select->column()=="cpu" );
+    REQUIRE( select->threshold()==90.5 );
+    REQUIRE( select->start().index()==2 );
+    REQUIRE( select->end().index()==25 );
+}
+
+TEST_CASE("Test select aggregate counters", "[command]")
+{
+    commands::command* cmd = parse_command("select rate(bytes), increase(bytes), max(bytes) group by 5m");
+    REQUIRE( cmd!=nullptr ); // Parse command
+
+    commands::select_aggregate* select = dynamic_cast<commands::select_aggregate*>(cmd);
+    REQUIRE( select!=nullptr ); // Parse aggregating 'select' command with counter operations
+    REQUIRE( select->items().size()==3 );
+    REQUIRE( select->items()[0].op==cyclic::AGGREGATE_RATE );
+    REQUIRE( select->items()[1].op==cyclic::AGGREGATE_INCREASE );
+    REQUIRE( select->items()[1].column=="bytes" );
+    REQUIRE( select->group().time()==300 );
+}